@@ -0,0 +1,741 @@
+// std::wstring_convert is only used as the baseline of the utf benchmark
+#define _SILENCE_CXX17_CODECVT_HEADER_DEPRECATION_WARNING
+#include "SimulatedBackend.hpp"
+#include "FadeScheduler.hpp"
+#include "AudioAPI.hpp"
+#include "Output.hpp"
+#include "Arguments.hpp"
+#include "Utf.hpp"
+
+#include <opt3.hpp>
+
+#include <codecvt>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <locale>
+#include <sstream>
+
+#ifndef OS_WIN
+#include <ctime>
+#include <unistd.h>
+#endif
+
+struct PrintHelp {
+	friend std::ostream& operator<<(std::ostream& os, const PrintHelp& h)
+	{
+		return os
+			<< "vccli_bench" << '\n'
+			<< "  Benchmarks vccli components against a simulated audio system." << '\n'
+			<< '\n'
+			<< "USAGE:\n"
+			<< "  vccli_bench <BENCHMARK...> [OPTIONS]" << '\n'
+			<< '\n'
+			<< "BENCHMARKS:\n"
+			<< "  all                          Runs the snapshot, resolve, match, list, render, args & utf benchmarks." << '\n'
+			<< "  snapshot                     Captures a snapshot of every device & session.  (Startup cost)" << '\n'
+			<< "  resolve                      Resolves exact, fuzzy, PID & device targets with AudioAPI::getObjects, & compares" << '\n'
+			<< "                                ranked fuzzy lookups with plain substring lookups." << '\n'
+			<< "  match                        Matches every process & device name against a target, with vccli::match & with the" << '\n'
+			<< "                                str::tolower baseline." << '\n'
+			<< "  list                         Builds & sorts the session & device lists." << '\n'
+			<< "  render                       Renders the session list in the text & quiet output formats, & times the first row" << '\n'
+			<< "                                of the sorted & streamed ('--stream') lists." << '\n'
+			<< "  args                         Parses a typical commandline." << '\n'
+			<< "  utf                          Converts endpoint IDs & names between UTF-16 & UTF-8, with vccli::utf & with the" << '\n'
+			<< "                                std::wstring_convert baseline.  Each sample converts 1000 strings." << '\n'
+			<< "  fade                         Runs many concurrent fades on one FadeScheduler & reports tick jitter & CPU cost." << '\n'
+			<< "  soak                         Repeatedly captures a snapshot, reads every property & activates volume objects, then" << '\n'
+			<< "                                fails if any backend object was leaked or memory usage grew." << '\n'
+			<< "  scaling                      Captures a snapshot & builds the session list on 1, 2, 4 ... N threads, against a" << '\n'
+			<< "                                backend with a simulated latency in every call." << '\n'
+			<< '\n'
+			<< "OPTIONS:\n"
+			<< "  -h, --help                   Shows this help display, then exits." << '\n'
+			<< "      --topology <DxS,...>     The simulated topologies to run against; D devices with S sessions each." << '\n'
+			<< "                                Defaults to '1x5,5x50,20x500,50x2000'." << '\n'
+			<< "      --samples <N>            The maximum number of samples per benchmark.  Defaults to 100." << '\n'
+			<< "      --max-time <DURATION>    Stops sampling a benchmark after this long, once it has at least 5 samples." << '\n'
+			<< "                                Defaults to 1s." << '\n'
+			<< "      --json <FILE|->          Writes the results to FILE (or STDOUT when '-' is specified) as JSON." << '\n'
+			<< '\n'
+			<< "OPTIONS - fade:\n"
+			<< "      --fades <N>              The number of concurrent fades.  Defaults to 500." << '\n'
+			<< "      --interval <DURATION>    The scheduler tick interval.  Defaults to 10ms." << '\n'
+			<< "      --over <DURATION>        The length of each fade.  Defaults to 2s." << '\n'
+			<< "      --latency <US>           The simulated latency of each backend call, in microseconds.  Defaults to 0." << '\n'
+			<< "      --threads <N>            The maximum number of pool threads used to split large ticks.  0 disables the pool." << '\n'
+			<< "                                Defaults to 32." << '\n'
+			<< '\n'
+			<< "OPTIONS - soak:\n"
+			<< "      --iterations <N>         The number of enumerations.  Defaults to 100000." << '\n'
+			<< "                                The first topology given with '--topology' is used; it defaults to '5x50'." << '\n'
+			<< '\n'
+			<< "OPTIONS - scaling:\n"
+			<< "      --latency <US>           The simulated latency of each backend call, in microseconds.  Defaults to 20." << '\n'
+			<< "      --threads <N>            The largest thread count to measure.  Defaults to 32." << '\n'
+			<< "                                '--topology' defaults to '16x20'." << '\n'
+			;
+	}
+};
+
+/// @brief	Gets the amount of CPU time used by this process so far.
+inline std::chrono::nanoseconds getProcessCpuTime()
+{
+#ifdef OS_WIN
+	FILETIME creation, exit, kernel, user;
+	GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+	const auto& toNs{ [](const FILETIME& ft) { return ((static_cast<uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime) * 100ull; } };
+	return std::chrono::nanoseconds{ toNs(kernel) + toNs(user) };
+#else
+	timespec ts{};
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return std::chrono::seconds{ ts.tv_sec } + std::chrono::nanoseconds{ ts.tv_nsec };
+#endif
+}
+
+/// @brief	Gets the amount of memory used by this process, in bytes; or 0 when it can't be determined.
+inline size_t getProcessMemoryUsage()
+{
+#ifdef OS_WIN
+	PROCESS_MEMORY_COUNTERS_EX counters{};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters)))
+		return 0;
+	return counters.PrivateUsage;
+#else
+	size_t size{ 0 }, resident{ 0 };
+	if (std::ifstream statm{ "/proc/self/statm" }; !(statm >> size >> resident))
+		return 0;
+	return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+/// @brief	Converts a duration to fractional microseconds for printing.
+template<typename Rep, typename Period>
+inline double toMicroseconds(const std::chrono::duration<Rep, Period>& d)
+{
+	return std::chrono::duration<double, std::micro>(d).count();
+}
+
+/**
+ * @struct	Topology
+ * @brief	The shape of a simulated audio system; a number of devices with the same number of sessions each.
+ */
+struct Topology {
+	size_t devices, sessions;
+
+	std::string str() const { return std::to_string(devices) + 'x' + std::to_string(sessions); }
+
+	/// @brief	Parses a comma-separated list of 'DxS' topologies.
+	static std::vector<Topology> parse(std::string const& s)
+	{
+		std::vector<Topology> vec;
+		std::stringstream ss{ s };
+		for (std::string item; std::getline(ss, item, ','); ) {
+			item = str::trim(item);
+			const auto pos{ item.find('x') };
+			if (pos == std::string::npos || pos == 0 || pos + 1 == item.size()
+				|| !std::all_of(item.begin(), item.begin() + pos, str::stdpred::isdigit)
+				|| !std::all_of(item.begin() + pos + 1, item.end(), str::stdpred::isdigit))
+				throw make_exception("Invalid topology '", item, "'!  Expected 'DxS'.");
+			vec.emplace_back(Topology{ str::stoul(item.substr(0, pos)), str::stoul(item.substr(pos + 1)) });
+		}
+		return vec;
+	}
+};
+
+/**
+ * @struct	Result
+ * @brief	The timing samples of one benchmark case.
+ */
+struct Result {
+	std::string benchmark, name, topology;
+	/// @brief	The duration of each sample, sorted from fastest to slowest.
+	std::vector<std::chrono::nanoseconds> samples;
+
+	/// @brief	Gets the given percentile (0 - 100) of the samples, using the nearest-rank method.
+	std::chrono::nanoseconds percentile(const double p) const
+	{
+		if (samples.empty()) return{};
+		const auto rank{ static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(samples.size()))) };
+		return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+	}
+	std::chrono::nanoseconds mean() const
+	{
+		if (samples.empty()) return{};
+		std::chrono::nanoseconds total{};
+		for (const auto& sample : samples)
+			total += sample;
+		return total / static_cast<std::chrono::nanoseconds::rep>(samples.size());
+	}
+};
+
+/**
+ * @class	Sampler
+ * @brief	Times repeated calls of a benchmark case & collects the results.
+ */
+class Sampler {
+	using clock = std::chrono::steady_clock;
+
+	/// @brief	The minimum number of samples that are taken, regardless of the time limit.
+	static constexpr size_t MIN_SAMPLES{ 5 };
+
+	size_t maxSamples;
+	clock::duration maxTime;
+
+public:
+	std::vector<Result> results;
+
+	Sampler(const size_t maxSamples, const clock::duration maxTime) : maxSamples{ std::max(maxSamples, MIN_SAMPLES) }, maxTime{ maxTime } {}
+
+	/**
+	 * @brief			Times calls of func until there are enough samples, after one untimed warm-up call.
+	 * @param benchmark	The name of the benchmark.
+	 * @param name		The name of the case within the benchmark.
+	 * @param topology	The topology that the case was run against.
+	 * @param func		The code to time.
+	 * @param setup		Untimed code that is called before each call of func.
+	 */
+	template<std::invocable F, std::invocable S = void(*)()>
+	Result& run(std::string const& benchmark, std::string const& name, std::string const& topology, F&& func, S&& setup = [] {})
+	{
+		Result result{ benchmark, name, topology };
+		result.samples.reserve(maxSamples);
+
+		setup();
+		func();
+
+		const auto& begin{ clock::now() };
+		while (result.samples.size() < maxSamples && (result.samples.size() < MIN_SAMPLES || clock::now() - begin < maxTime)) {
+			setup();
+			const auto& t0{ clock::now() };
+			func();
+			result.samples.emplace_back(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t0));
+		}
+
+		std::sort(result.samples.begin(), result.samples.end());
+		return results.emplace_back(std::move(result));
+	}
+
+	/// @brief	Prints the results as a table, in microseconds.
+	void printTable(std::ostream& os) const
+	{
+		os
+			<< std::left << std::setw(10) << "BENCHMARK" << std::setw(22) << "CASE" << std::setw(10) << "TOPOLOGY"
+			<< std::right << std::setw(8) << "SAMPLES" << std::setw(12) << "MIN(us)" << std::setw(12) << "P50(us)"
+			<< std::setw(12) << "P90(us)" << std::setw(12) << "P99(us)" << std::setw(12) << "MAX(us)" << '\n'
+			<< std::fixed << std::setprecision(2);
+		for (const auto& r : results) {
+			os
+				<< std::left << std::setw(10) << r.benchmark << std::setw(22) << r.name << std::setw(10) << r.topology
+				<< std::right << std::setw(8) << r.samples.size()
+				<< std::setw(12) << toMicroseconds(r.samples.front())
+				<< std::setw(12) << toMicroseconds(r.percentile(50))
+				<< std::setw(12) << toMicroseconds(r.percentile(90))
+				<< std::setw(12) << toMicroseconds(r.percentile(99))
+				<< std::setw(12) << toMicroseconds(r.samples.back())
+				<< '\n';
+		}
+		os << std::defaultfloat << std::setprecision(6);
+	}
+	/// @brief	Writes the results as a JSON document, in microseconds.
+	void writeJSON(std::ostream& os) const
+	{
+		os << "{\"unit\":\"us\",\"results\":[";
+		bool first{ true };
+		for (const auto& r : results) {
+			if (first) first = false;
+			else os << ',';
+			os
+				<< "\n{\"benchmark\":\"" << r.benchmark << "\",\"case\":\"" << r.name << "\",\"topology\":\"" << r.topology << '"'
+				<< ",\"samples\":" << r.samples.size()
+				<< ",\"min\":" << toMicroseconds(r.samples.front())
+				<< ",\"mean\":" << toMicroseconds(r.mean())
+				<< ",\"p50\":" << toMicroseconds(r.percentile(50))
+				<< ",\"p90\":" << toMicroseconds(r.percentile(90))
+				<< ",\"p99\":" << toMicroseconds(r.percentile(99))
+				<< ",\"max\":" << toMicroseconds(r.samples.back())
+				<< '}';
+		}
+		os << "\n]}\n";
+	}
+};
+
+/// @brief	Written to by doNotOptimize.
+inline const void* volatile optimizationSink{ nullptr };
+/// @brief	Prevents the compiler from optimizing away the result of a benchmarked call.
+template<typename T>
+inline void doNotOptimize(T const& value)
+{
+	optimizationSink = &value;
+}
+
+/// @brief	Times capturing a snapshot of the whole simulated system, & what it costs to read its properties afterwards.
+inline void benchSnapshot(Sampler& sampler, vccli::SimulatedBackend& backend, std::string const& topology)
+{
+	sampler.run("snapshot", "capture", topology, [&]() {
+		const vccli::AudioSnapshot snapshot{ backend };
+		doNotOptimize(snapshot);
+	});
+	// properties are fetched on first access, so resolving a PID only reads process IDs
+	sampler.run("snapshot", "capture+pid", topology, [&]() {
+		const vccli::AudioSnapshot snapshot{ backend };
+		doNotOptimize(snapshot.findSessionsByPID(1008));
+	});
+	// what every capture cost when all of the properties were fetched eagerly
+	sampler.run("snapshot", "capture+all", topology, [&]() {
+		const vccli::AudioSnapshot snapshot{ backend };
+		for (const auto& device : snapshot.getDevices())
+			doNotOptimize(device.isDefault() && device.flow() == EDataFlow::eAll && device.name().empty());
+		for (const auto& session : snapshot.getSessions())
+			doNotOptimize(session.pname().has_value() && session.sguid().size() > session.suid().size());
+	});
+
+	// listing devices, with & without a warm DeviceCache
+	const auto& readDeviceNames{ [](vccli::AudioSnapshot const& snapshot) {
+		for (const auto& device : snapshot.getDevices())
+			doNotOptimize(device.name().empty() && device.flow() == EDataFlow::eAll);
+	} };
+	sampler.run("snapshot", "capture+names", topology, [&]() { readDeviceNames(vccli::AudioSnapshot{ backend }); });
+	const auto& cachePath{ std::filesystem::temp_directory_path() / "vccli-bench-devices.cache" };
+	{
+		vccli::DeviceCache cache{ cachePath };
+		readDeviceNames(vccli::AudioSnapshot{ backend, &cache }); //< builds the cache
+		sampler.run("snapshot", "capture+names-cached", topology, [&]() { readDeviceNames(vccli::AudioSnapshot{ backend, &cache }); });
+	}
+	std::filesystem::remove(cachePath);
+}
+
+/// @brief	Times resolving each kind of target.
+inline void benchResolve(Sampler& sampler, vccli::AudioSnapshot const& snapshot, std::string const& topology)
+{
+	using namespace vccli;
+
+	const auto& resolve{ [&](std::string const& name, std::string const& target, const bool fuzzy, const size_t fuzzyLimit = AudioAPI::DEFAULT_FUZZY_LIMIT) {
+		sampler.run("resolve", name, topology, [&]() { doNotOptimize(AudioAPI::getObjects(snapshot, target, fuzzy, EDataFlow::eAll, true, fuzzyLimit)); });
+	} };
+	// see SimulatedBackend::generate for the names & PIDs
+	resolve("exact", "Spotify", false);
+	resolve("fuzzy", "spot", true);
+	resolve("fuzzy-typo", "spotfy", true);
+	resolve("fuzzy-all", "spot", true, 0);
+	resolve("pid", "1008", false);
+	resolve("device", "Speakers (Simulated Audio Device 0)", false);
+
+	// the lookups alone: substring containment through the trigram index vs. edit distance ranking of every name
+	const auto& deviceIndex{ snapshot.getDeviceNameIndex() };
+	const auto& sessionIndex{ snapshot.getSessionNameIndex() };
+	sampler.run("resolve", "lookup-substring", topology, [&]() {
+		const auto& needle{ match::fold("spot") };
+		doNotOptimize(deviceIndex.findSubstring(needle));
+		doNotOptimize(sessionIndex.findSubstring(needle));
+	});
+	sampler.run("resolve", "lookup-ranked", topology, [&]() {
+		const match::FuzzyPattern pattern{ "spot" };
+		doNotOptimize(deviceIndex.rank(pattern, pattern.maxDistance()));
+		doNotOptimize(sessionIndex.rank(pattern, pattern.maxDistance()));
+	});
+}
+
+/// @brief	Times matching every process & device name in the snapshot against exact & fuzzy targets.
+inline void benchMatch(Sampler& sampler, vccli::AudioSnapshot const& snapshot, std::string const& topology)
+{
+	using namespace vccli;
+
+	std::vector<std::string_view> candidates;
+	for (const auto& session : snapshot.getSessions())
+		candidates.emplace_back(session.pname().value_or(std::string_view{}));
+	for (const auto& device : snapshot.getDevices())
+		candidates.emplace_back(device.name());
+
+	const auto& match{ [&](std::string const& name, std::string const& target, const bool fuzzy) {
+		// baseline: fold every candidate into a new string, like the matcher that TargetIndex replaced
+		sampler.run("match", "tolower-" + name, topology, [&]() {
+			const auto& needle{ str::tolower(str::trim(target)) };
+			size_t count{ 0 };
+			for (const auto& candidate : candidates) {
+				const auto& folded{ str::tolower(str::trim(std::string{ candidate })) };
+				count += fuzzy ? folded.find(needle) != std::string::npos : folded == needle;
+			}
+			doNotOptimize(count);
+		});
+		sampler.run("match", name, topology, [&]() {
+			const match::TargetMatcher matcher{ target, fuzzy };
+			doNotOptimize(static_cast<size_t>(std::count_if(candidates.begin(), candidates.end(), matcher)));
+		});
+	} };
+	match("exact", "Spotify", false);
+	match("fuzzy", "spot", true);
+	match("fuzzy-device", "audio device 1", true);
+}
+
+/// @brief	Times building & sorting the session & device lists.
+inline void benchList(Sampler& sampler, vccli::AudioSnapshot const& snapshot, std::string const& topology)
+{
+	using namespace vccli;
+
+	sampler.run("list", "sessions", topology, [&]() { doNotOptimize(AudioAPI::GetAllAudioProcessesSorted(snapshot)); });
+	sampler.run("list", "devices", topology, [&]() { doNotOptimize(AudioAPI::GetAllAudioDevicesSorted(snapshot)); });
+	const auto& keys{ ParseSortKeys("name,device,-pid") };
+	sampler.run("list", "sessions-multikey", topology, [&]() { doNotOptimize(AudioAPI::GetAllAudioProcessesSorted(snapshot, keys)); });
+	const Filter filter{ "flow==out && pid>=100 && pname~'1'" };
+	sampler.run("list", "sessions-where", topology, [&]() { doNotOptimize(AudioAPI::GetAllAudioProcessesSorted(snapshot, AudioAPI::DEFAULT_SESSION_SORT, EDataFlow::eAll, true, &filter)); });
+}
+
+/**
+ * @brief	Times rendering the session list in the text & quiet output formats, & compares the time to the first row of the
+ *			 sorted list (which has to capture a snapshot & read every session first) with that of the streamed list.
+ */
+inline void benchRender(Sampler& sampler, vccli::SimulatedBackend& backend, vccli::AudioSnapshot const& snapshot, std::string const& topology)
+{
+	using namespace vccli;
+	using namespace vccli_operators;
+
+	const auto& processes{ AudioAPI::GetAllAudioProcessesSorted(snapshot) };
+	std::vector<ProcessInfo> copy;
+	std::ostringstream ss;
+
+	const auto& render{ [&](std::string const& name, const bool isQuiet) {
+		quiet = isQuiet;
+		colors.setActive(!isQuiet);
+		sampler.run("render", name, topology, [&]() {
+			ss << make_printable_list(std::move(copy));
+		}, [&]() {
+			copy = processes;
+			ss.str({});
+		});
+	} };
+	render("text", false);
+	render("quiet", true);
+
+	sampler.run("render", "first-row-sorted", topology, [&]() {
+		const AudioSnapshot fresh{ backend };
+		const auto& sorted{ AudioAPI::GetAllAudioProcessesSorted(fresh) };
+		if (!sorted.empty())
+			ss << sorted.front() << '\n';
+	}, [&]() { ss.str({}); });
+	sampler.run("render", "first-row-stream", topology, [&]() {
+		AudioAPI::StreamAudioProcesses(backend, EDataFlow::eAll, false, nullptr, [&](ProcessInfo const& info) {
+			ss << info << '\n';
+			return false;
+		});
+	}, [&]() { ss.str({}); });
+	sampler.run("render", "text-stream", topology, [&]() { streamSessionList(ss, backend, EDataFlow::eAll); }, [&]() { ss.str({}); });
+
+	quiet = false;
+	colors.setActive(true);
+}
+
+/// @brief	Times parsing a typical commandline.
+inline void benchArgs(Sampler& sampler)
+{
+	const std::vector<std::string> argStrings{ "chrome", "-d", "o", "--fuzzy", "-v", "50", "-m", "true", "--fade", "25", "--over", "2s", "--format", "ndjson" };
+	sampler.run("args", "parse", "-", [&]() { doNotOptimize(parseArgs(argStrings)); });
+}
+
+/// @brief	Times converting realistic endpoint IDs, session IDs & device names between UTF-16 & UTF-8.
+inline void benchUtf(Sampler& sampler)
+{
+	using namespace vccli;
+
+	const std::vector<std::u16string> strings16{
+		u"{0.0.0.00000000}.{e220a839-7b1d-cdaf-6e78-9e6aa1b965f4}",
+		u"{0.0.1.00000000}.{4d3b7a1f-5c2e-4f60-9a8b-0c1d2e3f4a5b}",
+		u"{0.0.0.00000000}.{e220a839-7b1d-cdaf-6e78-9e6aa1b965f4}|\\Device\\HarddiskVolume3\\Program Files\\Google\\Chrome\\Application\\chrome.exe%b{00000000-0000-0000-0000-000000000000}|1%b12345",
+		u"Speakers (Realtek(R) Audio)",
+		u"Lautsprecher (Realtek® High Definition Audio)",
+		u"Casque (Périphérique audio USB)",
+		u"ヘッドホン (USB Audio Device)",
+		u"Microphone (Yeti Stereo Microphone)",
+	};
+	std::vector<std::string> strings8;
+	for (const auto& s : strings16)
+		strings8.emplace_back(utf::toUtf8(s));
+
+	static constexpr size_t REPEAT{ 125 }; //< 8 strings * 125 = 1000 conversions per sample
+	std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t> converter;
+	std::string buf8;
+	std::u16string buf16;
+
+	sampler.run("utf", "codecvt8", "-", [&]() {
+		for (size_t i{ 0 }; i < REPEAT; ++i)
+			for (const auto& s : strings16)
+				doNotOptimize(converter.to_bytes(s));
+	});
+	sampler.run("utf", "utf8", "-", [&]() {
+		for (size_t i{ 0 }; i < REPEAT; ++i)
+			for (const auto& s : strings16)
+				doNotOptimize(utf::toUtf8(s));
+	});
+	sampler.run("utf", "utf8buf", "-", [&]() {
+		for (size_t i{ 0 }; i < REPEAT; ++i) {
+			for (const auto& s : strings16) {
+				utf::toUtf8(s, buf8);
+				doNotOptimize(buf8);
+			}
+		}
+	});
+	sampler.run("utf", "codecvt16", "-", [&]() {
+		for (size_t i{ 0 }; i < REPEAT; ++i)
+			for (const auto& s : strings8)
+				doNotOptimize(converter.from_bytes(s));
+	});
+	sampler.run("utf", "utf16buf", "-", [&]() {
+		for (size_t i{ 0 }; i < REPEAT; ++i) {
+			for (const auto& s : strings8) {
+				utf::toUtf16(s, buf16);
+				doNotOptimize(buf16);
+			}
+		}
+	});
+}
+
+/**
+ * @brief		Times capturing a snapshot & reading what '-l' lists on 1, 2, 4 ... N threads, against a backend that sleeps
+ *				 in every call.  One thread is the sequential path; otherwise devices are spread across a ThreadPool.
+ * @param args	The parsed commandline arguments.
+ */
+inline void benchScaling(Sampler& sampler, const opt3::ArgManager& args)
+{
+	using namespace vccli;
+
+	const std::chrono::microseconds latency{ str::stoul(args.getv_any<opt3::Option>("latency").value_or("20")) };
+	const size_t maxThreads{ std::max<size_t>(str::stoul(args.getv_any<opt3::Option>("threads").value_or("32")), 1) };
+
+	for (const auto& topology : Topology::parse(args.getv_any<opt3::Option>("topology").value_or("16x20"))) {
+		const auto& name{ topology.str() };
+		const auto& backend{ SimulatedBackend::generate(topology.devices, topology.sessions, latency) };
+
+		const auto& list{ [&backend](ThreadPool* pool) {
+			const AudioSnapshot snapshot{ *backend, nullptr, pool };
+			if (pool != nullptr)
+				snapshot.prefetch(*pool);
+			doNotOptimize(AudioAPI::GetAllAudioProcessesSorted(snapshot, EDataFlow::eAll, false));
+		} };
+
+		sampler.run("scaling", "threads-1", name, [&]() { list(nullptr); });
+		for (size_t threads{ 2 }; threads <= maxThreads; threads *= 2) {
+			// the calling thread takes part, so N threads is N - 1 workers
+			ThreadPool pool{ threads - 1 };
+			sampler.run("scaling", "threads-" + std::to_string(threads), name, [&]() { list(&pool); });
+		}
+	}
+}
+
+/**
+ * @brief		Runs many concurrent fades on one FadeScheduler & prints the tick jitter & CPU cost.
+ * @param args	The parsed commandline arguments.
+ */
+inline void benchFade(const opt3::ArgManager& args)
+{
+	using namespace vccli;
+
+	const size_t fadeCount{ str::stoul(args.getv_any<opt3::Option>("fades").value_or("500")) };
+	const auto& interval{ ParseDuration(args.getv_any<opt3::Option>("interval").value_or("10ms")) };
+	const auto& duration{ ParseDuration(args.getv_any<opt3::Option>("over").value_or("2s")) };
+	const std::chrono::microseconds latency{ str::stoul(args.getv_any<opt3::Option>("latency").value_or("0")) };
+
+	// one device with one session per fade
+	const auto& backend{ SimulatedBackend::generate(1, fadeCount, latency) };
+	std::vector<std::unique_ptr<ApplicationVolume>> targets;
+	targets.reserve(fadeCount);
+	for (const auto& session : backend->getDevices(EDataFlow::eAll).front()->getSessions())
+		targets.emplace_back(session->activateVolume("", EDataFlow::eRender, "", "", ""));
+
+	const size_t threadCount{ str::stoul(args.getv_any<opt3::Option>("threads").value_or("32")) };
+	std::unique_ptr<ThreadPool> pool{ threadCount > 0 ? std::make_unique<ThreadPool>(threadCount) : nullptr };
+	FadeScheduler scheduler{ interval, pool.get() };
+	std::vector<std::future<void>> fades;
+	fades.reserve(fadeCount);
+
+	const auto& cpuBegin{ getProcessCpuTime() };
+	const auto& wallBegin{ std::chrono::steady_clock::now() };
+
+	for (size_t i{ 0 }; i < targets.size(); ++i)
+		fades.emplace_back(scheduler.fade(targets[i].get(), 0.0f, duration, static_cast<FadeCurve>(i % 3)));
+	for (auto& fade : fades)
+		fade.wait();
+
+	const auto& wall{ std::chrono::steady_clock::now() - wallBegin };
+	const auto& cpu{ getProcessCpuTime() - cpuBegin };
+	const auto& stats{ scheduler.getStats() };
+
+	std::cout
+		<< std::fixed << std::setprecision(1)
+		<< "fades:           " << fadeCount << '\n'
+		<< "interval:        " << toMicroseconds(interval) << " us" << '\n'
+		<< "duration:        " << toMicroseconds(duration) << " us" << '\n'
+		<< "latency:         " << toMicroseconds(latency) << " us" << '\n'
+		<< "threads:         " << threadCount << '\n'
+		<< "ticks:           " << stats.ticks << '\n'
+		<< "setVolume calls: " << stats.calls << '\n'
+		<< "jitter (mean):   " << toMicroseconds(stats.meanJitter()) << " us" << '\n'
+		<< "jitter (max):    " << toMicroseconds(stats.maxJitter) << " us" << '\n'
+		<< "work per tick:   " << (stats.ticks == 0 ? 0.0 : toMicroseconds(stats.totalWork) / stats.ticks) << " us" << '\n'
+		<< "wall time:       " << toMicroseconds(wall) / 1000.0 << " ms" << '\n'
+		<< "CPU time:        " << toMicroseconds(cpu) / 1000.0 << " ms" << '\n'
+		<< "CPU usage:       " << 100.0 * cpu.count() / std::chrono::duration_cast<std::chrono::nanoseconds>(wall).count() << " %" << '\n'
+		<< std::defaultfloat << std::setprecision(6)
+		;
+}
+
+/**
+ * @brief		Enumerates the simulated system many times & checks that nothing leaks.
+ *\n			Every object that the SimulatedBackend returns is reference-counted like the COM interface it stands in for,
+ *			 so a missing release shows up in its live object count right away; memory usage is checked at the end.
+ * @param args	The parsed commandline arguments.
+ */
+inline void benchSoak(const opt3::ArgManager& args)
+{
+	using namespace vccli;
+
+	/// @brief	How much memory usage may grow after the warm-up iterations, to allow for allocator & trace buffer noise.
+	static constexpr size_t MEMORY_TOLERANCE{ 1024 * 1024 };
+
+	const size_t iterations{ str::stoul(args.getv_any<opt3::Option>("iterations").value_or("100000")) };
+	const auto& topology{ Topology::parse(args.getv_any<opt3::Option>("topology").value_or("5x50")).front() };
+	const auto& backend{ SimulatedBackend::generate(topology.devices, topology.sessions) };
+
+	const auto& enumerate{ [&backend]() {
+		const AudioSnapshot snapshot{ *backend };
+		for (const auto& device : snapshot.getDevices())
+			doNotOptimize(device.isDefault() && device.flow() == EDataFlow::eAll && device.name().empty());
+		for (const auto& session : snapshot.getSessions())
+			doNotOptimize(session.pname().has_value() && session.sguid().size() > session.suid().size());
+		doNotOptimize(AudioAPI::getObjects(snapshot, "chrome", false, EDataFlow::eAll));
+		doNotOptimize(AudioAPI::getObjects(snapshot, "", false, EDataFlow::eRender));
+	} };
+
+	const size_t baseline{ backend->getLiveObjectCount() };
+	const auto& check{ [&](const size_t iteration) {
+		if (const auto live{ backend->getLiveObjectCount() }; live != baseline)
+			throw make_exception("Iteration ", iteration, " leaked ", live - baseline, " backend objects!");
+	} };
+
+	// the first iterations fill the allocator's free lists & the process name cache
+	const size_t warmup{ std::max<size_t>(iterations / 10, 1) };
+	for (size_t i{ 0 }; i < warmup; ++i) {
+		enumerate();
+		check(i);
+	}
+
+	const auto& memoryBegin{ getProcessMemoryUsage() };
+	const auto& wallBegin{ std::chrono::steady_clock::now() };
+	for (size_t i{ 0 }; i < iterations; ++i) {
+		enumerate();
+		check(warmup + i);
+	}
+	const auto& wall{ std::chrono::steady_clock::now() - wallBegin };
+	const auto& memoryEnd{ getProcessMemoryUsage() };
+	const auto& growth{ static_cast<std::ptrdiff_t>(memoryEnd) - static_cast<std::ptrdiff_t>(memoryBegin) };
+
+	std::cout
+		<< std::fixed << std::setprecision(1)
+		<< "topology:        " << topology.str() << '\n'
+		<< "iterations:      " << iterations << " (+" << warmup << " warm-up)" << '\n'
+		<< "leaked objects:  0" << '\n'
+		<< "memory (begin):  " << memoryBegin / 1024 << " KiB" << '\n'
+		<< "memory (end):    " << memoryEnd / 1024 << " KiB" << '\n'
+		<< "memory growth:   " << growth / 1024 << " KiB" << '\n'
+		<< "per iteration:   " << (iterations == 0 ? 0.0 : toMicroseconds(wall) / iterations) << " us" << '\n'
+		<< std::defaultfloat << std::setprecision(6)
+		;
+
+	if (growth > static_cast<std::ptrdiff_t>(MEMORY_TOLERANCE))
+		throw make_exception("Memory usage grew by ", growth / 1024, " KiB over ", iterations, " iterations!");
+}
+
+int main(const int argc, char** argv)
+{
+	try {
+		opt3::ArgManager args{ argc, argv,
+			opt3::make_template(opt3::CaptureStyle::Required, "topology"),
+			opt3::make_template(opt3::CaptureStyle::Required, "samples"),
+			opt3::make_template(opt3::CaptureStyle::Required, "max-time"),
+			opt3::make_template(opt3::CaptureStyle::Required, "json"),
+			opt3::make_template(opt3::CaptureStyle::Required, "fades"),
+			opt3::make_template(opt3::CaptureStyle::Required, "interval"),
+			opt3::make_template(opt3::CaptureStyle::Required, "over"),
+			opt3::make_template(opt3::CaptureStyle::Required, "latency"),
+			opt3::make_template(opt3::CaptureStyle::Required, "threads"),
+			opt3::make_template(opt3::CaptureStyle::Required, "iterations"),
+		};
+
+		const auto& params{ args.getv_all<opt3::Parameter>() };
+		if (params.empty() || args.check_any<opt3::Flag, opt3::Option>('h', "help")) {
+			std::cout << PrintHelp{};
+			return 0;
+		}
+
+		const auto& isSelected{ [&params](std::string const& name) {
+			return std::any_of(params.begin(), params.end(), [&name](auto&& p) { return p == name || (p == "all" && name != "fade" && name != "soak" && name != "scaling"); });
+		} };
+		for (const auto& benchmark : params)
+			if (!str::equalsAny<false>(benchmark, "all", "snapshot", "resolve", "match", "list", "render", "args", "utf", "fade", "soak", "scaling"))
+				throw make_exception("Unknown benchmark '", benchmark, "'!");
+
+		Sampler sampler{
+			str::stoul(args.getv_any<opt3::Option>("samples").value_or("100")),
+			vccli::ParseDuration(args.getv_any<opt3::Option>("max-time").value_or("1s"))
+		};
+
+		if (isSelected("args"))
+			benchArgs(sampler);
+		if (isSelected("utf"))
+			benchUtf(sampler);
+
+		if (isSelected("snapshot") || isSelected("resolve") || isSelected("match") || isSelected("list") || isSelected("render")) {
+			for (const auto& topology : Topology::parse(args.getv_any<opt3::Option>("topology").value_or("1x5,5x50,20x500,50x2000"))) {
+				const auto& name{ topology.str() };
+				const auto& backend{ vccli::SimulatedBackend::generate(topology.devices, topology.sessions) };
+				if (isSelected("snapshot"))
+					benchSnapshot(sampler, *backend, name);
+
+				const vccli::AudioSnapshot snapshot{ *backend };
+				if (isSelected("resolve"))
+					benchResolve(sampler, snapshot, name);
+				if (isSelected("match"))
+					benchMatch(sampler, snapshot, name);
+				if (isSelected("list"))
+					benchList(sampler, snapshot, name);
+				if (isSelected("render"))
+					benchRender(sampler, *backend, snapshot, name);
+			}
+		}
+		if (isSelected("scaling"))
+			benchScaling(sampler, args);
+
+		const auto& json{ args.getv_any<opt3::Option>("json") };
+		if (!sampler.results.empty()) {
+			if (json.has_value() && json.value() == "-")
+				sampler.writeJSON(std::cout);
+			else {
+				sampler.printTable(std::cout);
+				if (json.has_value()) {
+					std::ofstream ofs{ json.value() };
+					if (!ofs)
+						throw make_exception("Couldn't open '", json.value(), "'!");
+					sampler.writeJSON(ofs);
+				}
+			}
+		}
+
+		if (isSelected("fade")) {
+			if (!sampler.results.empty())
+				std::cout << '\n';
+			benchFade(args);
+		}
+		if (isSelected("soak")) {
+			if (!sampler.results.empty() || isSelected("fade"))
+				std::cout << '\n';
+			benchSoak(args);
+		}
+
+		return 0;
+	} catch (const std::exception& ex) {
+		std::cerr << "FATAL: " << ex.what() << '\n';
+	} catch (...) {
+		std::cerr << "FATAL: An undefined exception occurred!" << '\n';
+	}
+	return 1;
+}
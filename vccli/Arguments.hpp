@@ -0,0 +1,40 @@
+#pragma once
+#include <opt3.hpp>
+
+#include <string>
+#include <vector>
+
+/// @brief	Parses the given commandline arguments.
+inline opt3::ArgManager parseArgs(const int argc, char** argv)
+{
+	return{ argc, argv,
+		opt3::make_template(opt3::CaptureStyle::Optional, 'v', "volume"),
+		opt3::make_template(opt3::CaptureStyle::Optional, 'm', "mute", "muted", "is-muted"),
+		opt3::make_template(opt3::CaptureStyle::Required, 'I', "increment"),
+		opt3::make_template(opt3::CaptureStyle::Required, 'D', "decrement"),
+		opt3::make_template(opt3::CaptureStyle::Required, 'd', "dev"),
+		opt3::make_template(opt3::CaptureStyle::Required, "simulate"),
+		opt3::make_template(opt3::CaptureStyle::Required, "ipc"),
+		opt3::make_template(opt3::CaptureStyle::Required, "batch"),
+		opt3::make_template(opt3::CaptureStyle::Required, "fade"),
+		opt3::make_template(opt3::CaptureStyle::Required, "over"),
+		opt3::make_template(opt3::CaptureStyle::Required, "curve"),
+		opt3::make_template(opt3::CaptureStyle::Required, "format"),
+		opt3::make_template(opt3::CaptureStyle::Required, "trace"),
+		opt3::make_template(opt3::CaptureStyle::Required, "fuzzy-limit"),
+		opt3::make_template(opt3::CaptureStyle::Required, "cache-file"),
+		opt3::make_template(opt3::CaptureStyle::Required, "sort"),
+		opt3::make_template(opt3::CaptureStyle::Required, "where"),
+	};
+}
+/// @brief	Parses the given list of arguments, which doesn't include the program name.
+inline opt3::ArgManager parseArgs(std::vector<std::string> argStrings)
+{
+	argStrings.insert(argStrings.begin(), "vccli");
+	std::vector<char*> argv;
+	argv.reserve(argStrings.size() + 1);
+	for (auto& arg : argStrings)
+		argv.emplace_back(arg.data());
+	argv.emplace_back(nullptr);
+	return parseArgs(static_cast<int>(argStrings.size()), argv.data());
+}
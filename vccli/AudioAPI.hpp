@@ -1,33 +1,46 @@
 #pragma once
 #include "util.hpp"
 #include "Volume.hpp"
+#include "AudioBackend.hpp"
+#include "AudioSnapshot.hpp"
+#include "SessionStream.hpp"
+#include "SimulatedBackend.hpp"
+#include "QueryPlanner.hpp"
+#include "Sort.hpp"
+#include "Filter.hpp"
 
 #include <make_exception.hpp>
 #include <math.hpp>
 
-#define $release(var) var->Release(); var = nullptr;
-
 namespace vccli {
 	struct basic_info {
 		virtual ~basic_info() = default;
 		friend std::ostream& operator<<(std::ostream& os, const basic_info&) { return os; }
 	};
 
+	/**
+	 * @struct	DeviceInfo
+	 * @brief	Describes one device in an AudioSnapshot.  The strings are views of the snapshot's strings, so this must not outlive the snapshot.
+	 */
 	struct DeviceInfo : basic_info {
-		std::string dname, dguid;
+		std::string_view dname, dguid;
 		EDataFlow flow;
 		bool isDefault;
 
-		constexpr DeviceInfo(std::string const& DNAME, std::string const& DGUID, const EDataFlow flow, const bool isDefault) : dname{ DNAME }, dguid{ DGUID }, flow{ flow }, isDefault{ isDefault } {}
+		constexpr DeviceInfo(const std::string_view DNAME, const std::string_view DGUID, const EDataFlow flow, const bool isDefault) : dname{ DNAME }, dguid{ DGUID }, flow{ flow }, isDefault{ isDefault } {}
 
 		std::optional<std::string> type_name() const { return "Device"; }
 	};
+	/**
+	 * @struct	ProcessInfo
+	 * @brief	Describes one session in an AudioSnapshot.  The strings are views of the snapshot's strings, so this must not outlive the snapshot.
+	 */
 	struct ProcessInfo : DeviceInfo {
 		DWORD pid;
-		std::string pname, suid, sguid;
+		std::string_view pname, suid, sguid;
 
-		constexpr ProcessInfo(std::string const& PNAME, const DWORD PID, const EDataFlow flow, std::string const& SUID, std::string const& SGUID, std::string const& DGUID, std::string const& DNAME, const bool isDefaultDevice)
-			: DeviceInfo(DNAME, DGUID, flow, false), pid{ PID }, pname{ PNAME }, suid{ SUID }, sguid{ SGUID }
+		constexpr ProcessInfo(const std::string_view PNAME, const DWORD PID, const EDataFlow flow, const std::string_view SUID, const std::string_view SGUID, const std::string_view DGUID, const std::string_view DNAME, const bool isDefaultDevice)
+			: DeviceInfo(DNAME, DGUID, flow, isDefaultDevice), pid{ PID }, pname{ PNAME }, suid{ SUID }, sguid{ SGUID }
 		{
 		}
 
@@ -41,12 +54,17 @@ namespace vccli {
 		constexpr ProcessInfoLookup(pInfo_list_t&& vec) : vec{ std::move(vec) } {}
 		constexpr ProcessInfoLookup(pInfo_list_t const& vec) : vec{ vec } {}
 
-		constexpr std::optional<pInfo_t> operator()(std::string pName, const bool ignoreCase = true) const
+		std::optional<pInfo_t> operator()(std::string const& pName, const bool ignoreCase = true) const
 		{
-			if (ignoreCase)
-				pName = str::tolower(pName);
+			if (!ignoreCase) {
+				for (const auto& it : vec)
+					if (it.second == pName)
+						return it;
+				return std::nullopt;
+			}
+			const auto& folded{ match::fold(pName) };
 			for (const auto& it : vec)
-				if ((!ignoreCase && it.second == pName) || (ignoreCase && str::tolower(it.second) == pName))
+				if (match::equalsFolded(it.second, folded))
 					return it;
 			return std::nullopt;
 		}
@@ -59,292 +77,376 @@ namespace vccli {
 		}
 	};
 
-	class AudioAPI {
-	#pragma region Internal
-		static IMMDeviceEnumerator* getDeviceEnumerator()
+	/**
+	 * @class	BasicFilterRow
+	 * @brief	Reads the fields of one device or session for a Filter, fetching each one only when it's tested.
+	 *\n		The volume object is activated the first time the volume or mute state is tested, & can be reused afterwards.
+	 * @tparam	TDevice		The device record type; AudioSnapshot::DeviceRecord or SessionStream::DeviceRow.
+	 * @tparam	TSession	The session record type; AudioSnapshot::SessionRecord or SessionStream::SessionRow.
+	 */
+	template<typename TDevice, typename TSession>
+	class BasicFilterRow {
+		TDevice const& dev;
+		TSession const* session;
+		std::unique_ptr<Volume> volume;
+
+	public:
+		BasicFilterRow(TDevice const& dev, TSession const* session = nullptr) : dev{ dev }, session{ session } {}
+
+		/// @brief	Gets the volume object of the row, activating it on the first call.  The names & session IDs of the object are left blank.
+		Volume* getVolume()
 		{
-			IMMDeviceEnumerator* deviceEnumerator{};
-			if (const auto& hr{ CoCreateInstance(__uuidof(MMDeviceEnumerator), NULL, CLSCTX_INPROC_SERVER, __uuidof(IMMDeviceEnumerator), (void**)&deviceEnumerator) }; hr != S_OK)
-				throw make_exception(GetErrorMessageFrom(hr), " (code ", hr, ')');
-			return{ deviceEnumerator };
+			if (!volume) {
+				if (session)
+					volume = session->handle->activateVolume({}, dev.flow(), {}, {}, {});
+				else volume = dev.handle->activateVolume({}, dev.flow(), false);
+			}
+			return volume.get();
 		}
-	#pragma endregion Internal
 
-		static ProcessInfoLookup::pInfo_list_t GetAudioProcessLookup(EDataFlow flow = EDataFlow::eAll, ERole role = ERole::eMultimedia)
+		FilterValue operator()(const FilterField field)
 		{
-			ProcessInfoLookup::pInfo_list_t vec;
-
-			auto deviceEnumerator{ getDeviceEnumerator() };
-
-			IMMDeviceCollection* devices;
-			deviceEnumerator->EnumAudioEndpoints(flow, role, &devices);
-
-			UINT count;
-			devices->GetCount(&count);
-
-			static constexpr IID iid_IAudioSessionManager2{ __uuidof(IAudioSessionManager2) };
-
-			IMMDevice* dev;
-			IAudioSessionManager2* devManager{};
-			IAudioSessionEnumerator* sessionEnumerator{};
-			IAudioSessionControl* sessionControl{};
-			IAudioSessionControl2* sessionControl2{};
-
-			for (UINT i{ 0u }; i < count; ++i) {
-				devices->Item(i, &dev);
-
-				dev->Activate(iid_IAudioSessionManager2, 0, NULL, (void**)&devManager);
-				devManager->GetSessionEnumerator(&sessionEnumerator);
-
-				int sessionCount;
-				sessionEnumerator->GetCount(&sessionCount);
-
-				vec.reserve(vec.size() + sessionCount);
-
-				for (int i{ 0 }; i < sessionCount; ++i) {
-					sessionEnumerator->GetSession(i, &sessionControl);
+			switch (field) {
+			case FilterField::TYPE:
+				return session ? 1.0 : 0.0;
+			case FilterField::PID:
+				return session ? FilterValue{ static_cast<double>(session->pid()) } : FilterValue{};
+			case FilterField::PNAME:
+				if (session)
+					if (const auto& pname{ session->pname() }; pname.has_value())
+						return pname.value();
+				return{};
+			case FilterField::DNAME:
+				return dev.name();
+			case FilterField::DGUID:
+				return dev.id();
+			case FilterField::SUID:
+				return session ? FilterValue{ session->suid() } : FilterValue{};
+			case FilterField::SGUID:
+				return session ? FilterValue{ session->sguid() } : FilterValue{};
+			case FilterField::FLOW:
+				return static_cast<double>(dev.flow());
+			case FilterField::DEFAULT:
+				return dev.isDefault() ? 1.0 : 0.0;
+			case FilterField::VOLUME:
+				return static_cast<double>(getVolume()->getVolumeScaled());
+			case FilterField::MUTED:
+				return getVolume()->getMuted() ? 1.0 : 0.0;
+			default:
+				return{};
+			}
+		}
 
-					sessionControl->QueryInterface<IAudioSessionControl2>(&sessionControl2);
+		/// @brief	Checks whether the row matches the given filter.
+		bool matches(Filter const& filter) { return filter.evaluate(*this); }
+	};
+	/// @brief	Reads the fields of a device or session in an AudioSnapshot for a Filter.
+	using FilterRow = BasicFilterRow<AudioSnapshot::DeviceRecord, AudioSnapshot::SessionRecord>;
+	/// @brief	Reads the fields of a device or session in a SessionStream for a Filter.
+	using StreamFilterRow = BasicFilterRow<SessionStream::DeviceRow, SessionStream::SessionRow>;
 
-					DWORD pid;
-					sessionControl2->GetProcessId(&pid);
+	class AudioAPI {
+		inline static std::shared_ptr<AudioBackend> backend{ nullptr };
 
-					if (std::any_of(vec.begin(), vec.end(), [&pid](auto&& pair) -> bool { return pair.first == pid; }))
-						continue;
+		static ProcessInfoLookup::pInfo_list_t GetAudioProcessLookup(AudioSnapshot const& snapshot, EDataFlow flow = EDataFlow::eAll)
+		{
+			ProcessInfoLookup::pInfo_list_t vec;
 
-					if (const auto& pName{ GetProcessNameFrom(pid) }; pName.has_value())
-						vec.emplace_back(std::make_pair(pid, pName.value()));
+			for (const auto& session : snapshot.getSessions()) {
+				if (flow != EDataFlow::eAll && snapshot.getDeviceOf(session).flow() != flow)
+					continue;
 
-					sessionControl->Release();
-					sessionControl2->Release();
-				}
+				if (std::any_of(vec.begin(), vec.end(), [&session](auto&& pair) -> bool { return pair.first == session.pid(); }))
+					continue;
 
-				sessionEnumerator->Release();
-				devManager->Release();
-				dev->Release();
+				if (const auto& pname{ session.pname() }; pname.has_value())
+					vec.emplace_back(std::make_pair(session.pid(), std::string{ pname.value() }));
 			}
 
-			devices->Release();
-			deviceEnumerator->Release();
-
 			vec.shrink_to_fit();
 			return vec;
 		}
-		static ProcessInfoLookup::pInfo_list_t GetAudioProcessLookupSorted(const std::function<bool(std::pair<DWORD, std::string>, std::pair<DWORD, std::string>)>& sorting_predicate, EDataFlow flow = EDataFlow::eAll, ERole role = ERole::eMultimedia)
+		static ProcessInfoLookup::pInfo_list_t GetAudioProcessLookupSorted(AudioSnapshot const& snapshot, const std::function<bool(std::pair<DWORD, std::string>, std::pair<DWORD, std::string>)>& sorting_predicate, EDataFlow flow = EDataFlow::eAll)
 		{
-			std::vector<std::pair<DWORD, std::string>> vec{ GetAudioProcessLookup(flow, role) };
+			std::vector<std::pair<DWORD, std::string>> vec{ GetAudioProcessLookup(snapshot, flow) };
 			std::sort(vec.begin(), vec.end(), sorting_predicate);
 			return vec;
 		}
-		static ProcessInfoLookup::pInfo_list_t GetAudioProcessLookupSorted(EDataFlow flow = EDataFlow::eAll, ERole role = ERole::eMultimedia)
+		static ProcessInfoLookup::pInfo_list_t GetAudioProcessLookupSorted(AudioSnapshot const& snapshot, EDataFlow flow = EDataFlow::eAll)
 		{
-			return GetAudioProcessLookupSorted(std::less<std::pair<DWORD, std::string>>{}, flow, role);
+			return GetAudioProcessLookupSorted(snapshot, std::less<std::pair<DWORD, std::string>>{}, flow);
 		}
 
-	public:
-		static IMMDevice* getDevice(const std::string& device_id)
+		/**
+		 * @brief			Gets the value of a numeric sort field for a row of a session or device list.
+		 * @param field		The field to get.
+		 * @param dev		The device of the row.
+		 * @param pid		The process ID of the row; 0 for devices.
+		 * @param volume	The volume object of the row; this may only be nullptr when the field isn't a volume field.
+		 */
+		static uint64_t getSortValue(const SortField field, AudioSnapshot::DeviceRecord const& dev, const DWORD pid, Volume const* volume)
 		{
-			const auto& deviceEnumerator{ getDeviceEnumerator() };
-
-			IMMDevice* dev;
-			IMMDeviceCollection* devices;
-			deviceEnumerator->EnumAudioEndpoints(EDataFlow::eRender, ERole::eMultimedia, &devices);
-
-			UINT count;
-			devices->GetCount(&count);
-
-			LPWSTR sbuf{};
-
-			for (UINT i{ 0u }; i < count; ++i) {
-				devices->Item(i, &dev);
-
-				if (dev->GetId(&sbuf) == S_OK && w_converter.to_bytes(sbuf) == device_id) {
-					devices->Release();
-					deviceEnumerator->Release();
-
-					return dev;
-				}
+			switch (field) {
+			case SortField::PID:
+				return pid;
+			case SortField::IO:
+				return static_cast<uint64_t>(dev.flow());
+			case SortField::DEFAULT:
+				return dev.isDefault();
+			case SortField::VOLUME:
+				return volumeSortKey(volume->getVolume());
+			case SortField::MUTED:
+				return volume->getMuted();
+			default:
+				return 0;
 			}
+		}
 
-			devices->Release();
-			deviceEnumerator->Release();
-
-			return nullptr;
+	public:
+		/**
+		 * @brief			Sets the backend that all AudioAPI functions use to access audio devices & sessions.
+		 * @param newBackend	The backend to use.
+		 */
+		static void setBackend(std::shared_ptr<AudioBackend> const& newBackend)
+		{
+			backend = newBackend;
+		}
+		/**
+		 * @brief		Gets the backend that all AudioAPI functions use to access audio devices & sessions.
+		 * @returns		A reference to the current backend.
+		 */
+		static AudioBackend& getBackend()
+		{
+			if (!backend)
+				throw make_exception("No audio backend was selected!");
+			return *backend;
 		}
-		static IMMDevice* getDefaultDevice()
+		/**
+		 * @brief		Enumerates all of the devices & sessions exposed by the current backend in a single pass.
+		 * @returns		An AudioSnapshot that can be passed to the other AudioAPI functions.
+		 */
+		static AudioSnapshot getSnapshot()
 		{
-			auto* deviceEnumerator{ getDeviceEnumerator() };
-
-			IMMDevice* dev;
-			deviceEnumerator->GetDefaultAudioEndpoint(EDataFlow::eRender, ERole::eMultimedia, &dev);
-
-			deviceEnumerator->Release();
-
-			return dev;
+			return AudioSnapshot{ getBackend() };
 		}
-		static std::string getDeviceName(std::string const& devID)
+
+		static std::string getDeviceName(AudioSnapshot const& snapshot, std::string const& devID)
 		{
-			auto* deviceEnumerator{ getDeviceEnumerator() };
-			IMMDevice* dev;
-			deviceEnumerator->GetDevice(w_converter.from_bytes(devID).c_str(), &dev);
-			$release(deviceEnumerator);
-			std::string name{ getDeviceFriendlyName(dev) };
-			$release(dev);
-			return name;
+			if (const auto* dev{ snapshot.findDevice(devID) })
+				return std::string{ dev->name() };
+			return{};
 		}
 
-		static std::vector<ProcessInfo> GetAllAudioProcesses(EDataFlow flow = EDataFlow::eAll, ERole role = ERole::eMultimedia)
+		/**
+		 * @brief				Gets information about every session in the snapshot.
+		 * @param snapshot		The snapshot to read.
+		 * @param flow			Only sessions on devices with this data flow are included.
+		 * @param withSessionIDs	When false, the session identifiers (SUID & SGUID) are left blank so that they aren't fetched.
+		 */
+		static std::vector<ProcessInfo> GetAllAudioProcesses(AudioSnapshot const& snapshot, EDataFlow flow = EDataFlow::eAll, const bool withSessionIDs = true)
 		{
 			std::vector<ProcessInfo> vec;
+			vec.reserve(snapshot.getSessions().size());
 
-			auto deviceEnumerator{ getDeviceEnumerator() };
-			IMMDevice* dev;
-
-			std::string defDevIDIn{}, defDevIDOut{};
-			deviceEnumerator->GetDefaultAudioEndpoint(EDataFlow::eRender, ERole::eMultimedia, &dev);
-			defDevIDOut = getDeviceID(dev);
-			$release(dev);
-			deviceEnumerator->GetDefaultAudioEndpoint(EDataFlow::eCapture, ERole::eMultimedia, &dev);
-			defDevIDIn = getDeviceID(dev);
-			$release(dev);
-
-			IMMDeviceCollection* devices;
-			deviceEnumerator->EnumAudioEndpoints(flow, role, &devices);
-
-			UINT count;
-			devices->GetCount(&count);
-
-			static constexpr IID iid_IAudioSessionManager2{ __uuidof(IAudioSessionManager2) };
-
-			IAudioSessionManager2* devManager{};
-			IAudioSessionEnumerator* sessionEnumerator{};
-			IAudioSessionControl* sessionControl{};
-			IAudioSessionControl2* sessionControl2{};
-
-			for (UINT i{ 0u }; i < count; ++i) {
-				devices->Item(i, &dev);
-
-				dev->Activate(iid_IAudioSessionManager2, 0, NULL, (void**)&devManager);
-				devManager->GetSessionEnumerator(&sessionEnumerator);
-
-				int sessionCount;
-				sessionEnumerator->GetCount(&sessionCount);
-
-				vec.reserve(vec.size() + sessionCount);
-				const auto& devName{ getDeviceFriendlyName(dev) };
-				const auto& devID{ getDeviceID(dev) };
-				const auto& devFlow{ getDeviceDataFlow(dev) };
-
-				for (int i{ 0 }; i < sessionCount; ++i) {
-					sessionEnumerator->GetSession(i, &sessionControl);
-
-					sessionControl->QueryInterface<IAudioSessionControl2>(&sessionControl2);
+			for (const auto& session : snapshot.getSessions()) {
+				const auto& dev{ snapshot.getDeviceOf(session) };
+				if (flow != EDataFlow::eAll && dev.flow() != flow)
+					continue;
 
-					DWORD pid;
-					sessionControl2->GetProcessId(&pid);
-
-					if (const auto& pName{ GetProcessNameFrom(pid) }; pName.has_value())
-						vec.emplace_back(ProcessInfo{ pName.value(), pid, devFlow, getSessionIdentifier(sessionControl2), getSessionInstanceIdentifier(sessionControl2), devID, devName, devID == defDevIDIn || devID == defDevIDOut });
-
-					sessionControl->Release();
-					sessionControl2->Release();
-				}
-
-				sessionEnumerator->Release();
-				devManager->Release();
-				dev->Release();
+				if (const auto& pname{ session.pname() }; pname.has_value())
+					vec.emplace_back(ProcessInfo{ pname.value(), session.pid(), dev.flow(), withSessionIDs ? session.suid() : std::string_view{}, withSessionIDs ? session.sguid() : std::string_view{}, dev.id(), dev.name(), dev.isDefault() });
 			}
 
-			devices->Release();
-			deviceEnumerator->Release();
-
 			vec.shrink_to_fit();
 			return vec;
 		}
-		static std::vector<ProcessInfo> GetAllAudioProcessesSorted(const std::function<bool(ProcessInfo, ProcessInfo)>& sorting_predicate, EDataFlow flow = EDataFlow::eAll, ERole role = ERole::eMultimedia)
+		/// @brief	The order that sessions are listed in by default; by data flow, then by process ID.
+		inline static const std::vector<SortKey> DEFAULT_SESSION_SORT{ { SortField::IO }, { SortField::PID } };
+		/// @brief	The order that devices are listed in by default; by data flow, then by name.
+		inline static const std::vector<SortKey> DEFAULT_DEVICE_SORT{ { SortField::IO }, { SortField::NAME } };
+
+		/**
+		 * @brief				Gets information about every session in the snapshot, sorted by the given keys.
+		 * @param snapshot		The snapshot to read.
+		 * @param keys			The sort keys, in order of precedence.  Sessions that compare equal keep their enumeration order.
+		 * @param flow			Only sessions on devices with this data flow are included.
+		 * @param withSessionIDs	When false, the session identifiers (SUID & SGUID) are left blank so that they aren't fetched.
+		 * @param filter		When not nullptr, only sessions that match the filter are included.  The filter is evaluated
+		 *						 before any fields that it doesn't test are fetched.
+		 */
+		static std::vector<ProcessInfo> GetAllAudioProcessesSorted(AudioSnapshot const& snapshot, std::vector<SortKey> const& keys, EDataFlow flow = EDataFlow::eAll, const bool withSessionIDs = true, Filter const* filter = nullptr)
 		{
-			auto vec{ GetAllAudioProcesses(flow, role) };
-			std::sort(vec.begin(), vec.end(), sorting_predicate);
-			return vec;
+			$trace("AudioAPI::GetAllAudioProcessesSorted");
+			std::vector<ProcessInfo> vec;
+			vec.reserve(snapshot.getSessions().size());
+			RowSorter sorter{ keys, snapshot.getSessions().size() };
+			const bool needsVolume{ sorter.needsVolume() };
+
+			for (const auto& session : snapshot.getSessions()) {
+				const auto& dev{ snapshot.getDeviceOf(session) };
+				if (flow != EDataFlow::eAll && dev.flow() != flow)
+					continue;
+
+				FilterRow row{ dev, &session };
+				if (filter && !row.matches(*filter))
+					continue;
+
+				const auto& pname{ session.pname() };
+				if (!pname.has_value())
+					continue;
+
+				Volume const* volume{ needsVolume ? row.getVolume() : nullptr };
+				sorter.addRow(
+					[&](const SortField field) { return getSortValue(field, dev, session.pid(), volume); },
+					[&](const SortField field) { return field == SortField::NAME ? pname.value() : dev.name(); });
+				vec.emplace_back(ProcessInfo{ pname.value(), session.pid(), dev.flow(), withSessionIDs ? session.suid() : std::string_view{}, withSessionIDs ? session.sguid() : std::string_view{}, dev.id(), dev.name(), dev.isDefault() });
+			}
+
+			return sorter.sort(std::move(vec));
 		}
-		static std::vector<ProcessInfo> GetAllAudioProcessesSorted(EDataFlow flow = EDataFlow::eAll, ERole role = ERole::eMultimedia)
+		static std::vector<ProcessInfo> GetAllAudioProcessesSorted(AudioSnapshot const& snapshot, EDataFlow flow = EDataFlow::eAll, const bool withSessionIDs = true)
 		{
-			const auto& nSorter{ std::less<DWORD>() };
-			return GetAllAudioProcessesSorted([&nSorter](ProcessInfo const& l, ProcessInfo const& r) -> bool { return static_cast<int>(l.flow) < static_cast<int>(r.flow) && nSorter(l.pid, r.pid); }, flow, role);
+			return GetAllAudioProcessesSorted(snapshot, DEFAULT_SESSION_SORT, flow, withSessionIDs);
 		}
 
-		static std::vector<DeviceInfo> GetAllAudioDevices(EDataFlow flow = EDataFlow::eAll, ERole role = ERole::eMultimedia)
+		static std::vector<DeviceInfo> GetAllAudioDevices(AudioSnapshot const& snapshot, EDataFlow flow = EDataFlow::eAll)
 		{
-			IMMDeviceEnumerator* deviceEnumerator{ getDeviceEnumerator() };
-			IMMDevice* dev;
-
-			std::wstring defaultOutputDevID, defaultInputDevID;
-			LPWSTR sbuf;
-
-			// Get default output device id
-			deviceEnumerator->GetDefaultAudioEndpoint(EDataFlow::eRender, role, &dev);
-			dev->GetId(&sbuf);
-			defaultOutputDevID = sbuf;
-			dev->Release();
-			// Get default input device id
-			deviceEnumerator->GetDefaultAudioEndpoint(EDataFlow::eCapture, role, &dev);
-			dev->GetId(&sbuf);
-			defaultInputDevID = sbuf;
-			dev->Release();
-
-			IMMDeviceCollection* devices;
-			deviceEnumerator->EnumAudioEndpoints(flow, role, &devices);
-			deviceEnumerator->Release();
-
-			UINT count;
-			devices->GetCount(&count);
-
 			std::vector<DeviceInfo> vec;
-			vec.reserve(count);
-
-			for (UINT i{ 0 }; i < count; ++i) {
-				devices->Item(i, &dev);
-
-				dev->GetId(&sbuf);
-				const std::wstring devID{ sbuf };
+			vec.reserve(snapshot.getDevices().size());
 
-				vec.emplace_back(DeviceInfo{ getDeviceFriendlyName(dev), w_converter.to_bytes(devID), getDeviceDataFlow(dev), devID == defaultInputDevID || devID == defaultOutputDevID });
+			for (const auto& dev : snapshot.getDevices())
+				if (flow == EDataFlow::eAll || dev.flow() == flow)
+					vec.emplace_back(DeviceInfo{ dev.name(), dev.id(), dev.flow(), dev.isDefault() });
 
-				dev->Release();
+			return vec;
+		}
+		/**
+		 * @brief			Gets information about every device in the snapshot, sorted by the given keys.
+		 * @param snapshot	The snapshot to read.
+		 * @param keys		The sort keys, in order of precedence.  Devices that compare equal keep their enumeration order.
+		 * @param flow		Only devices with this data flow are included.
+		 * @param filter	When not nullptr, only devices that match the filter are included.
+		 */
+		static std::vector<DeviceInfo> GetAllAudioDevicesSorted(AudioSnapshot const& snapshot, std::vector<SortKey> const& keys, EDataFlow flow = EDataFlow::eAll, Filter const* filter = nullptr)
+		{
+			$trace("AudioAPI::GetAllAudioDevicesSorted");
+			std::vector<DeviceInfo> vec;
+			vec.reserve(snapshot.getDevices().size());
+			RowSorter sorter{ keys, snapshot.getDevices().size() };
+			const bool needsVolume{ sorter.needsVolume() };
+
+			for (const auto& dev : snapshot.getDevices()) {
+				if (flow != EDataFlow::eAll && dev.flow() != flow)
+					continue;
+
+				FilterRow row{ dev };
+				if (filter && !row.matches(*filter))
+					continue;
+
+				Volume const* volume{ needsVolume ? row.getVolume() : nullptr };
+				sorter.addRow(
+					[&](const SortField field) { return getSortValue(field, dev, 0, volume); },
+					[&](const SortField) { return dev.name(); });
+				vec.emplace_back(DeviceInfo{ dev.name(), dev.id(), dev.flow(), dev.isDefault() });
 			}
 
-			devices->Release();
-
-			vec.shrink_to_fit();
-			return vec;
+			return sorter.sort(std::move(vec));
 		}
-		static std::vector<DeviceInfo> GetAllAudioDevicesSorted(const std::function<bool(DeviceInfo, DeviceInfo)>& sorting_predicate, EDataFlow flow = EDataFlow::eAll, ERole role = ERole::eMultimedia)
+		static std::vector<DeviceInfo> GetAllAudioDevicesSorted(AudioSnapshot const& snapshot, EDataFlow flow = EDataFlow::eAll)
 		{
-			auto devices{ GetAllAudioDevices(flow, role) };
-			std::sort(devices.begin(), devices.end(), sorting_predicate);
-			return devices;
+			return GetAllAudioDevicesSorted(snapshot, DEFAULT_DEVICE_SORT, flow);
 		}
-		static std::vector<DeviceInfo> GetAllAudioDevicesSorted(EDataFlow flow = EDataFlow::eAll, ERole role = ERole::eMultimedia)
+
+		/**
+		 * @brief				Streams information about every session straight from the backend, in enumeration order, without
+		 *						 capturing a snapshot.  Each session is passed to emit as soon as it has been read, so the first row
+		 *						 doesn't wait for the others, & memory use doesn't grow with the number of sessions.  (See SessionStream)
+		 * @param backend		The backend to enumerate.
+		 * @param flow			Only sessions on devices with this data flow are included.
+		 * @param withSessionIDs	When false, the session identifiers (SUID & SGUID) are left blank so that they aren't fetched.
+		 * @param filter		When not nullptr, only sessions that match the filter are included.
+		 * @param emit			Called with each session.  The ProcessInfo's strings are only valid until it returns.  When it returns
+		 *						 a bool, returning false stops the stream.
+		 */
+		template<typename F>
+		static void StreamAudioProcesses(AudioBackend& backend, const EDataFlow flow, const bool withSessionIDs, Filter const* filter, F&& emit)
+		{
+			$trace("AudioAPI::StreamAudioProcesses");
+			SessionStream stream{ backend };
+			stream.forEachSession(flow, [&](SessionStream::DeviceRow const& dev, SessionStream::SessionRow const& session) {
+				if (filter && !StreamFilterRow{ dev, &session }.matches(*filter))
+					return true;
+				const auto& pname{ session.pname() };
+				if (!pname.has_value())
+					return true;
+				const ProcessInfo info{ pname.value(), session.pid(), dev.flow(), withSessionIDs ? session.suid() : std::string_view{}, withSessionIDs ? session.sguid() : std::string_view{}, dev.id(), dev.name(), dev.isDefault() };
+				if constexpr (std::same_as<std::invoke_result_t<F&, ProcessInfo const&>, bool>)
+					return emit(info);
+				else {
+					emit(info);
+					return true;
+				}
+			});
+		}
+		/**
+		 * @brief			Streams information about every device straight from the backend, in enumeration order, without
+		 *					 capturing a snapshot.  See StreamAudioProcesses.
+		 */
+		template<typename F>
+		static void StreamAudioDevices(AudioBackend& backend, const EDataFlow flow, Filter const* filter, F&& emit)
 		{
-			const auto& sSorter{ std::less<std::string>() };
-			return GetAllAudioDevicesSorted([&sSorter](DeviceInfo const& l, DeviceInfo const& r) -> bool { return static_cast<int>(l.flow) < static_cast<int>(r.flow) && sSorter(l.dname, r.dname); }, flow, role);
+			$trace("AudioAPI::StreamAudioDevices");
+			SessionStream stream{ backend };
+			stream.forEachDevice(flow, [&](SessionStream::DeviceRow const& dev) {
+				if (filter && !StreamFilterRow{ dev }.matches(*filter))
+					return true;
+				const DeviceInfo info{ dev.name(), dev.id(), dev.flow(), dev.isDefault() };
+				if constexpr (std::same_as<std::invoke_result_t<F&, DeviceInfo const&>, bool>)
+					return emit(info);
+				else {
+					emit(info);
+					return true;
+				}
+			});
 		}
 
+		/// @brief	The default number of distinct names that a fuzzy search selects.
+		static constexpr size_t DEFAULT_FUZZY_LIMIT{ 1 };
+
 		/// @brief	Gets the appropriate volume control object for the given string.
-		static std::unique_ptr<Volume> getObject(const std::string& target_id, const bool fuzzy, EDataFlow const& deviceFlowFilter, const bool defaultDevIsOutput = true)
+		static std::unique_ptr<Volume> getObject(AudioSnapshot const& snapshot, const std::string& target_id, const bool fuzzy, EDataFlow const& deviceFlowFilter, const bool defaultDevIsOutput = true, const size_t fuzzyLimit = DEFAULT_FUZZY_LIMIT)
 		{
-			auto target_id_lower{ str::tolower(target_id) };
-			if (fuzzy)
-				target_id_lower = str::trim(target_id_lower);
-
-			const auto& compare_target_id_to{ [&target_id_lower, &fuzzy](std::string const& s) -> bool {
-				return (target_id_lower == (fuzzy ? str::trim(s) : s)) || (fuzzy && s.find(str::trim(target_id_lower)) != std::string::npos);
-			} };
+			$trace("AudioAPI::getObject");
+			auto objects{ getObjects(snapshot, target_id, fuzzy, deviceFlowFilter, defaultDevIsOutput, fuzzyLimit) };
+			if (objects.empty())
+				return nullptr;
+			return std::move(objects.front());
+		}
+		/**
+		 * @struct	Selection
+		 * @brief	A device or session in a snapshot that was selected by a target.
+		 */
+		struct Selection {
+			/// @brief	The index of the selected device, or of the device that owns the selected session.
+			size_t device;
+			/// @brief	The index of the selected session; or std::nullopt when the device itself was selected.
+			std::optional<size_t> session;
 
-			std::unique_ptr<Volume> object{ nullptr };
+			/// @brief	Orders selections by device in enumeration order, with each device before its sessions.
+			auto operator<=>(Selection const&) const = default;
+		};
 
-			IMMDeviceEnumerator* deviceEnumerator{ getDeviceEnumerator() };
-			IMMDevice* dev;
+		/**
+		 * @brief					Selects all devices & sessions that match the given target string, without activating them.
+		 *\n						See getObjects for a description of the other parameters.
+		 * @param filter			When not nullptr, devices & sessions that don't match the filter are skipped while they're chosen;
+		 *							 so when the first matching session on a device is rejected, a later one can still be selected.
+		 * @returns					Every matching device, & the first matching session on each device that didn't match, in enumeration order.
+		 */
+		static std::vector<Selection> select(AudioSnapshot const& snapshot, const std::string& target_id, const bool fuzzy, EDataFlow const& deviceFlowFilter, const bool defaultDevIsOutput = true, const size_t fuzzyLimit = DEFAULT_FUZZY_LIMIT, Filter const* filter = nullptr)
+		{
+			$trace("AudioAPI::select");
+			std::vector<Selection> selections;
 
 			if (target_id.empty()) {
 				// DEFAULT DEVICE:
@@ -352,236 +454,224 @@ namespace vccli {
 				if (defaultDevFlow == EDataFlow::eAll) //< we can't request a default 'eAll' device; select input or output
 					defaultDevFlow = (defaultDevIsOutput ? EDataFlow::eRender : EDataFlow::eCapture);
 
-				deviceEnumerator->GetDefaultAudioEndpoint(defaultDevFlow, ERole::eMultimedia, &dev);
-				$release(deviceEnumerator);
-				IAudioEndpointVolume* endpoint{};
-				dev->Activate(__uuidof(IAudioEndpointVolume), CLSCTX_INPROC_SERVER, NULL, (void**)&endpoint);
-				const auto& devName{ getDeviceFriendlyName(dev) };
-				const auto& deviceID{ getDeviceID(dev) };
-				$release(dev);
-
-				return std::make_unique<EndpointVolume>(endpoint, devName, deviceID, defaultDevFlow, true);
+				if (const auto* dev{ snapshot.findDevice(snapshot.getDefaultDeviceID(defaultDevFlow)) }) {
+					const Selection selection{ static_cast<size_t>(dev - snapshot.getDevices().data()), std::nullopt };
+					if (!filter || matches(snapshot, selection, *filter))
+						selections.emplace_back(selection);
+				}
+				return selections;
 			} // Else we have an actual target ID to find
 
+			const auto& devices{ snapshot.getDevices() };
+			const auto& sessions{ snapshot.getSessions() };
+
+			const auto& isSelectableDevice{ [&](const size_t i) { return deviceFlowFilter == EDataFlow::eAll || devices[i].flow() == deviceFlowFilter; } };
+
 			// Check if we have a valid PID
 			std::optional<DWORD> target_pid;
 			if (std::all_of(target_id.begin(), target_id.end(), str::stdpred::isdigit))
 				target_pid = str::stoul(target_id);
 
-			// Enumerate all devices of the specified I/O type(s):
-			IMMDeviceCollection* devices;
-			deviceEnumerator->EnumAudioEndpoints(deviceFlowFilter, ERole::eMultimedia, &devices);
-			$release(deviceEnumerator)
-
-				UINT count;
-			devices->GetCount(&count);
-
-			for (UINT i{ 0u }; object == nullptr && i < count; ++i) {
-				devices->Item(i, &dev);
+			std::vector<TargetIndex::value_t> matchingDevices, matchingSessions;
+			if (fuzzy) {
+				// Rank the names & IDs in every index together & take the best ones that have something selectable
+				const match::FuzzyPattern pattern{ target_id };
+				const std::array<std::pair<TargetIndex const*, bool>, 4> indexes{ { //< second is true for device indexes
+					{ target_pid.has_value() ? nullptr : &snapshot.getDeviceNameIndex(), true }, //< devices can't be selected by PID
+					{ target_pid.has_value() ? nullptr : &snapshot.getDeviceIDIndex(), true },
+					{ &snapshot.getSessionNameIndex(), false },
+					{ &snapshot.getSessionIDIndex(), false },
+				} };
+
+				std::vector<std::pair<TargetIndex::RankedKey, size_t>> ranked; //< second is the position of the key's index in indexes
+				for (size_t i{ 0 }; i < indexes.size(); ++i)
+					if (indexes[i].first != nullptr)
+						for (const auto& key : indexes[i].first->rank(pattern, pattern.maxDistance()))
+							ranked.emplace_back(key, i);
+				std::stable_sort(ranked.begin(), ranked.end(), [](auto&& l, auto&& r) { return l.first.score < r.first.score; });
+
+				size_t selectedKeys{ 0 };
+				for (const auto& [key, i] : ranked) {
+					if (fuzzyLimit != 0 && selectedKeys == fuzzyLimit)
+						break;
+					const auto& [index, isDevice] { indexes[i] };
+					auto& matching{ isDevice ? matchingDevices : matchingSessions };
+					const auto sizeBefore{ matching.size() };
+					for (const auto& value : index->getValues(key.keyID))
+						if (isSelectableDevice(isDevice ? value : sessions[value].device))
+							matching.emplace_back(value);
+					if (matching.size() != sizeBefore)
+						++selectedKeys;
+				}
+				for (auto* matching : { &matchingDevices, &matchingSessions }) {
+					std::sort(matching->begin(), matching->end());
+					matching->erase(std::unique(matching->begin(), matching->end()), matching->end());
+				}
+			}
+			else if (!target_pid.has_value()) { //< PIDs only select sessions by process ID, so nothing else has to be fetched
+				const auto& target_id_trimmed{ match::trimWhitespace(target_id) };
+				const auto& target_id_lower{ match::fold(target_id_trimmed) };
+				// Only search the IDs when the target looks like one, so plain names never fetch any IDs
+				if (QueryPlan::classify(target_id_trimmed) != QueryPlan::TargetKind::Name) {
+					matchingDevices = snapshot.getDeviceIDIndex().findExact(target_id_lower);
+					matchingSessions = snapshot.getSessionIDIndex().findExact(target_id_lower);
+				}
+				if (matchingDevices.empty() && matchingSessions.empty()) {
+					matchingDevices = snapshot.getDeviceNameIndex().findExact(target_id_lower);
+					matchingSessions = snapshot.getSessionNameIndex().findExact(target_id_lower);
+				}
+			}
 
-				LPWSTR sbuf;
-				dev->GetId(&sbuf);
-				std::string deviceID{ w_converter.to_bytes(sbuf) };
+			if (target_pid.has_value()) {
+				for (const auto& i : snapshot.findSessionsByPID(target_pid.value()))
+					matchingSessions.emplace_back(static_cast<TargetIndex::value_t>(i));
+				std::sort(matchingSessions.begin(), matchingSessions.end());
+			}
 
-				const auto& deviceName{ getDeviceFriendlyName(dev) };
-				const auto& deviceFlow{ getDeviceDataFlow(dev) };
+			for (size_t i{ 0 }; i < devices.size(); ++i) {
+				const auto& dev{ devices[i] };
+				if (!isSelectableDevice(i))
+					continue;
 
 				// Check if this device is a match
-				if (!target_pid.has_value() && (compare_target_id_to(str::tolower(deviceID)) || compare_target_id_to(str::tolower(deviceName)))) {
-					IAudioEndpointVolume* endpointVolume{};
-					dev->Activate(__uuidof(IAudioEndpointVolume), CLSCTX_INPROC_SERVER, NULL, (void**)&endpointVolume);
-					object = std::make_unique<EndpointVolume>(endpointVolume, deviceName, deviceID, deviceFlow, isDefaultDevice(dev));
+				if (std::binary_search(matchingDevices.begin(), matchingDevices.end(), static_cast<TargetIndex::value_t>(i))
+					&& (!filter || matches(snapshot, Selection{ i, std::nullopt }, *filter))) {
+					selections.emplace_back(Selection{ i, std::nullopt });
+					continue;
 				}
-				else { // Check for matching sessions on this device:
-					IAudioSessionManager2* mgr{};
-					dev->Activate(__uuidof(IAudioSessionManager2), 0, NULL, (void**)&mgr);
-
-					IAudioSessionEnumerator* sessionEnumerator;
-					mgr->GetSessionEnumerator(&sessionEnumerator);
-					$release(mgr);
-
-					IAudioSessionControl* sessionControl;
-					IAudioSessionControl2* sessionControl2;
-					ISimpleAudioVolume* sessionVolumeControl;
-
-					// Enumerate all audio sessions on this device:
-					int sessionCount;
-					sessionEnumerator->GetCount(&sessionCount);
-
-					for (int j{ 0 }; j < sessionCount; ++j) {
-						sessionEnumerator->GetSession(j, &sessionControl);
-
-						sessionControl->QueryInterface<IAudioSessionControl2>(&sessionControl2);
-						$release(sessionControl);
-
-						DWORD pid;
-						sessionControl2->GetProcessId(&pid);
-
-						const auto& pname{ GetProcessNameFrom(pid) };
-						const auto& suid{ getSessionIdentifier(sessionControl2) }, & sguid{ getSessionInstanceIdentifier(sessionControl2) };
-
-						// Check if this session is a match:
-						if ((pname.has_value() && compare_target_id_to(str::tolower(pname.value()))) || (target_pid.has_value() && target_pid.value() == pid) || compare_target_id_to(suid) || compare_target_id_to(sguid)) {
-							sessionControl2->QueryInterface<ISimpleAudioVolume>(&sessionVolumeControl);
-							$release(sessionControl2);
-							object = std::make_unique<ApplicationVolume>(sessionVolumeControl, pname.value(), pid, deviceFlow, deviceID, suid, sguid);
-							break; //< break from session enumeration loop
-						}
-						$release(sessionControl2);
-					} //< end session enumeration loop
-					$release(sessionEnumerator)
+				// Else select the first matching session on this device
+				for (auto it{ std::lower_bound(matchingSessions.begin(), matchingSessions.end(), static_cast<TargetIndex::value_t>(dev.sessionsBegin)) }; it != matchingSessions.end() && *it < dev.sessionsEnd; ++it) {
+					const Selection selection{ i, static_cast<size_t>(*it) };
+					if (!filter || matches(snapshot, selection, *filter)) {
+						selections.emplace_back(selection);
+						break;
+					}
 				}
-				$release(dev);
 			}
-			$release(devices);
 
-			return object;
+			return selections;
 		}
-		static std::vector<std::unique_ptr<Volume>> getObjects(const std::string& target_id, const bool fuzzy, EDataFlow const& deviceFlowFilter, const bool defaultDevIsOutput = true)
+		/// @brief	Activates a volume control object for each of the given selections, in the same order.
+		static std::vector<std::unique_ptr<Volume>> activate(AudioSnapshot const& snapshot, std::vector<Selection> const& selections)
 		{
-			auto target_id_lower{ str::tolower(target_id) };
-			if (fuzzy)
-				target_id_lower = str::trim(target_id_lower);
-
-			const auto& compare_target_id_to{ [&target_id_lower, &fuzzy](std::string const& s) -> bool {
-				return (target_id_lower == (fuzzy ? str::trim(s) : s)) || (fuzzy && s.find(str::trim(target_id_lower)) != std::string::npos);
-			} };
-
 			std::vector<std::unique_ptr<Volume>> objects;
-			objects.reserve(1);
-
-			IMMDeviceEnumerator* deviceEnumerator{ getDeviceEnumerator() };
-			IMMDevice* dev;
-
-			if (target_id.empty()) {
-				// DEFAULT DEVICE:
-				EDataFlow defaultDevFlow{ deviceFlowFilter };
-				if (defaultDevFlow == EDataFlow::eAll) //< we can't request a default 'eAll' device; select input or output
-					defaultDevFlow = (defaultDevIsOutput ? EDataFlow::eRender : EDataFlow::eCapture);
-
-				deviceEnumerator->GetDefaultAudioEndpoint(defaultDevFlow, ERole::eMultimedia, &dev);
-				$release(deviceEnumerator);
-				IAudioEndpointVolume* endpoint{};
-				dev->Activate(__uuidof(IAudioEndpointVolume), CLSCTX_INPROC_SERVER, NULL, (void**)&endpoint);
-				const auto& devName{ getDeviceFriendlyName(dev) };
-				const auto& deviceID{ getDeviceID(dev) };
-				$release(dev);
-
-				objects.emplace_back(std::make_unique<EndpointVolume>(endpoint, devName, deviceID, defaultDevFlow, true));
-				return objects;
-			} // Else we have an actual target ID to find
-
-			// Check if we have a valid PID
-			std::optional<DWORD> target_pid;
-			if (std::all_of(target_id.begin(), target_id.end(), str::stdpred::isdigit))
-				target_pid = str::stoul(target_id);
-
-			// Enumerate all devices of the specified I/O type(s):
-			IMMDeviceCollection* devices;
-			deviceEnumerator->EnumAudioEndpoints(deviceFlowFilter, ERole::eMultimedia, &devices);
-			$release(deviceEnumerator)
-
-			UINT count;
-			devices->GetCount(&count);
-
-			objects.reserve(count);
-
-			for (UINT i{ 0u }; i < count; ++i) {
-				devices->Item(i, &dev);
-
-				LPWSTR sbuf;
-				dev->GetId(&sbuf);
-				std::string deviceID{ w_converter.to_bytes(sbuf) };
+			objects.reserve(selections.size());
+			for (const auto& selection : selections) {
+				if (selection.session.has_value())
+					objects.emplace_back(snapshot.activate(snapshot.getSessions()[selection.session.value()]));
+				else
+					objects.emplace_back(snapshot.activate(snapshot.getDevices()[selection.device]));
+			}
+			return objects;
+		}
 
-				const auto& deviceName{ getDeviceFriendlyName(dev) };
-				const auto& deviceFlow{ getDeviceDataFlow(dev) };
+		/**
+		 * @brief					Gets the volume control objects for all devices & sessions that match the given target string.
+		 *\n						Targets are resolved through the snapshot's TargetIndexes, so the cost doesn't depend on the number of sessions.
+		 * @param snapshot			The snapshot to search.
+		 * @param target_id			A DNAME, DGUID, PID, PNAME, SUID, or SGUID; or a blank string to select the default device.
+		 * @param fuzzy				When true, names are ranked by edit distance from the target (see TargetIndex::rank) & only the best
+		 *							 matching names are selected; otherwise names must be equal to the target, ignoring case.
+		 * @param deviceFlowFilter	Only devices (and sessions on devices) with this data flow are selected.
+		 * @param defaultDevIsOutput	When the target is blank & the flow filter is eAll, selects the default output device when true; otherwise the default input device.
+		 * @param fuzzyLimit		The number of distinct names (or IDs) that a fuzzy search selects, best match first; or 0 to select every match.
+		 * @returns					Volume objects for every matching device, & for the first matching session on each device that didn't match.
+		 */
+		static std::vector<std::unique_ptr<Volume>> getObjects(AudioSnapshot const& snapshot, const std::string& target_id, const bool fuzzy, EDataFlow const& deviceFlowFilter, const bool defaultDevIsOutput = true, const size_t fuzzyLimit = DEFAULT_FUZZY_LIMIT)
+		{
+			$trace("AudioAPI::getObjects");
+			return activate(snapshot, select(snapshot, target_id, fuzzy, deviceFlowFilter, defaultDevIsOutput, fuzzyLimit));
+		}
 
-				// Check if this device is a match
-				if (!target_pid.has_value() && (compare_target_id_to(str::tolower(deviceID)) || compare_target_id_to(str::tolower(deviceName)))) {
-					IAudioEndpointVolume* endpointVolume{};
-					dev->Activate(__uuidof(IAudioEndpointVolume), CLSCTX_INPROC_SERVER, NULL, (void**)&endpointVolume);
-					objects.emplace_back(std::make_unique<EndpointVolume>(endpointVolume, deviceName, deviceID, deviceFlow, isDefaultDevice(dev)));
-				}
-				else { // Check for matching sessions on this device:
-					IAudioSessionManager2* mgr{};
-					dev->Activate(__uuidof(IAudioSessionManager2), 0, NULL, (void**)&mgr);
-
-					IAudioSessionEnumerator* sessionEnumerator;
-					mgr->GetSessionEnumerator(&sessionEnumerator);
-					$release(mgr);
-
-					IAudioSessionControl* sessionControl;
-					IAudioSessionControl2* sessionControl2;
-					ISimpleAudioVolume* sessionVolumeControl;
-
-					// Enumerate all audio sessions on this device:
-					int sessionCount;
-					sessionEnumerator->GetCount(&sessionCount);
-
-					for (int j{ 0 }; j < sessionCount; ++j) {
-						sessionEnumerator->GetSession(j, &sessionControl);
-
-						sessionControl->QueryInterface<IAudioSessionControl2>(&sessionControl2);
-						$release(sessionControl);
-
-						DWORD pid;
-						sessionControl2->GetProcessId(&pid);
-
-						const auto& pname{ GetProcessNameFrom(pid) };
-						const auto& suid{ getSessionIdentifier(sessionControl2) }, & sguid{ getSessionInstanceIdentifier(sessionControl2) };
-
-						// Check if this session is a match:
-						if ((pname.has_value() && compare_target_id_to(str::tolower(pname.value()))) || (target_pid.has_value() && target_pid.value() == pid) || compare_target_id_to(suid) || compare_target_id_to(sguid)) {
-							sessionControl2->QueryInterface<ISimpleAudioVolume>(&sessionVolumeControl);
-							$release(sessionControl2);
-							objects.emplace_back(std::make_unique<ApplicationVolume>(sessionVolumeControl, pname.value(), pid, deviceFlow, deviceID, suid, sguid));
-							break; //< break from session enumeration loop
-						}
-						$release(sessionControl2);
-					} //< end session enumeration loop
-					$release(sessionEnumerator)
-				}
-				$release(dev);
+		/**
+		 * @struct	TargetSetObjects
+		 * @brief	The result of resolving several targets at once.  (See getObjectsForTargets)
+		 */
+		struct TargetSetObjects {
+			/// @brief	Volume objects for everything that any of the targets selected, in enumeration order & without duplicates.
+			std::vector<std::unique_ptr<Volume>> objects;
+			/// @brief	The targets that didn't select anything, in the order they were given.
+			std::vector<std::string> unmatched;
+		};
+		/**
+		 * @brief					Gets the volume control objects for all devices & sessions that match any of the given targets.
+		 *\n						Every target is resolved against the same snapshot, so N targets cost one enumeration; a device or
+		 *						 session that is selected by more than one target is only activated once.
+		 * @param targets			The targets to resolve; see getObjects for the accepted formats.
+		 * @param filter			When not nullptr, only the devices & sessions that match the filter are selected; a target whose
+		 *							 matches were all rejected by the filter counts as a target that didn't select anything.
+		 * @returns					The union of the objects selected by each target, & the targets that didn't select anything.
+		 */
+		static TargetSetObjects getObjectsForTargets(AudioSnapshot const& snapshot, std::vector<std::string> const& targets, const bool fuzzy, EDataFlow const& deviceFlowFilter, const bool defaultDevIsOutput = true, const size_t fuzzyLimit = DEFAULT_FUZZY_LIMIT, Filter const* filter = nullptr)
+		{
+			$trace("AudioAPI::getObjectsForTargets");
+			TargetSetObjects result;
+			std::vector<Selection> selections;
+			for (const auto& target : targets) {
+				const auto& selected{ select(snapshot, target, fuzzy, deviceFlowFilter, defaultDevIsOutput, fuzzyLimit, filter) };
+				if (selected.empty())
+					result.unmatched.emplace_back(target);
+				else selections.insert(selections.end(), selected.begin(), selected.end());
 			}
-			$release(devices);
-
-			objects.shrink_to_fit();
-			return objects;
+			std::sort(selections.begin(), selections.end());
+			selections.erase(std::unique(selections.begin(), selections.end()), selections.end());
+			result.objects = activate(snapshot, selections);
+			return result;
 		}
 
-		static bool isDefaultDevice(IMMDevice* dev)
+		/// @brief	Checks whether the given selection matches a filter.
+		static bool matches(AudioSnapshot const& snapshot, Selection const& selection, Filter const& filter)
 		{
-			const auto& devID{ getDeviceID(dev) };
-			IMMDeviceEnumerator* deviceEnumerator{ getDeviceEnumerator() };
-			bool isDefault{ false };
-			IMMDevice* tmp;
-			std::string tmpID{};
-			deviceEnumerator->GetDefaultAudioEndpoint(EDataFlow::eRender, ERole::eMultimedia, &tmp);
-			tmpID = getDeviceID(tmp);
-			tmp->Release();
-			if (tmpID == devID)
-				isDefault = true;
-			else {
-				deviceEnumerator->GetDefaultAudioEndpoint(EDataFlow::eCapture, ERole::eMultimedia, &tmp);
-				tmpID = getDeviceID(tmp);
-				tmp->Release();
-				if (tmpID == devID)
-					isDefault = true;
+			const auto& dev{ snapshot.getDevices()[selection.device] };
+			return FilterRow{ dev, selection.session.has_value() ? &snapshot.getSessions()[selection.session.value()] : nullptr }.matches(filter);
+		}
+		/**
+		 * @brief					Selects every device & session in the snapshot that matches the given filter, without activating them.
+		 * @param filter			The filter to evaluate against each device & session.
+		 * @param deviceFlowFilter	Only devices (and sessions on devices) with this data flow are selected.  This is checked before
+		 *							 the filter, so it's cheaper than testing the flow in the filter.
+		 * @returns					Every matching device & session, in enumeration order.
+		 */
+		static std::vector<Selection> selectWhere(AudioSnapshot const& snapshot, Filter const& filter, EDataFlow const& deviceFlowFilter)
+		{
+			$trace("AudioAPI::selectWhere");
+			std::vector<Selection> selections;
+			const auto& devices{ snapshot.getDevices() };
+			const auto& sessions{ snapshot.getSessions() };
+			for (size_t i{ 0 }; i < devices.size(); ++i) {
+				const auto& dev{ devices[i] };
+				if (deviceFlowFilter != EDataFlow::eAll && dev.flow() != deviceFlowFilter)
+					continue;
+				if (FilterRow{ dev }.matches(filter))
+					selections.emplace_back(Selection{ i, std::nullopt });
+				for (size_t j{ dev.sessionsBegin }; j < dev.sessionsEnd; ++j)
+					if (FilterRow{ dev, &sessions[j] }.matches(filter))
+						selections.emplace_back(Selection{ i, j });
 			}
-			deviceEnumerator->Release();
-			return isDefault;
+			return selections;
+		}
+		/// @brief	Gets the volume control objects for every device & session in the snapshot that matches the given filter.  (See selectWhere)
+		static std::vector<std::unique_ptr<Volume>> getObjectsWhere(AudioSnapshot const& snapshot, Filter const& filter, EDataFlow const& deviceFlowFilter)
+		{
+			$trace("AudioAPI::getObjectsWhere");
+			return activate(snapshot, selectWhere(snapshot, filter, deviceFlowFilter));
+		}
+
+		static bool isDefaultDevice(AudioSnapshot const& snapshot, std::string const& devID)
+		{
+			return snapshot.isDefaultDevice(devID);
 		}
 		/**
 		 * @brief				Resolves the given identifier to a process ID by searching for it in a snapshot.
 		 * @param identifier	A process name or process ID.
 		 * @returns				The process ID of the target process; or 0 if the process doesn't exist. If the process WAS found in the snapshot but is NOT still active, returns 0.
 		 */
-		static std::optional<DWORD> ResolveProcessIdentifier(const std::string& identifier, const std::function<bool(std::string, std::string)>& comp = CompareProcessName, EDataFlow flow = EDataFlow::eRender, ERole role = ERole::eMultimedia)
+		static std::optional<DWORD> ResolveProcessIdentifier(AudioSnapshot const& snapshot, const std::string& identifier, const std::function<bool(std::string, std::string)>& comp = CompareProcessName, EDataFlow flow = EDataFlow::eRender)
 		{
 			if (std::all_of(identifier.begin(), identifier.end(), str::stdpred::isdigit))
 				return str::stoul(identifier); //< return ID casted to a number
 			else {
-				ProcessInfoLookup lookup{ GetAudioProcessLookup(flow, role) };
+				ProcessInfoLookup lookup{ GetAudioProcessLookup(snapshot, flow) };
 				if (const auto& pInfo{ lookup(identifier, true) }; pInfo.has_value()) {
 					return pInfo.value().first;
 				}
@@ -589,4 +679,91 @@ namespace vccli {
 			return std::nullopt;
 		}
 	};
+
+	TEST_CASE("AudioAPI::getObjects")
+	{
+		auto sim{ std::make_shared<SimulatedBackend>() };
+		auto& speakers{ sim->addDevice("Speakers (USB Audio Codec )", EDataFlow::eRender) };
+		auto& mic{ sim->addDevice("Microphone", EDataFlow::eCapture) };
+		sim->addSession(speakers, 100, "chrome");
+		sim->addSession(speakers, 200, "Discord");
+		sim->addSession(mic, 200, "Discord");
+		AudioAPI::setBackend(sim);
+
+		const auto& snapshot{ AudioAPI::getSnapshot() };
+		sim->resetCallCount();
+
+		CHECK(AudioAPI::getObjects(snapshot, "chrome", false, EDataFlow::eAll).size() == 1);
+		CHECK(AudioAPI::getObjects(snapshot, "discord", false, EDataFlow::eAll).size() == 2);
+		CHECK(AudioAPI::getObjects(snapshot, "discord", false, EDataFlow::eCapture).size() == 1);
+		CHECK(AudioAPI::getObjects(snapshot, "200", false, EDataFlow::eAll).size() == 2);
+		CHECK(AudioAPI::getObjects(snapshot, "usb audio codec", false, EDataFlow::eAll).empty());
+		CHECK(AudioAPI::getObjects(snapshot, "usb audio codec", true, EDataFlow::eAll).size() == 1);
+		CHECK(AudioAPI::getObjects(snapshot, "", false, EDataFlow::eCapture).front()->resolved_name == "Microphone");
+		CHECK(AudioAPI::getObjects(snapshot, "CORD", true, EDataFlow::eAll).size() == 2);
+		CHECK(AudioAPI::GetAllAudioProcesses(snapshot).size() == 3);
+		CHECK(AudioAPI::GetAllAudioDevices(snapshot, EDataFlow::eRender).size() == 1);
+
+		// Nothing was enumerated again; besides the 10 activated volume objects, each property was fetched once on first
+		//  access (3 per device & per session), along with the process table & the 2 default devices
+		CHECK(sim->getCallCount() == 10 + 3 * 2 + 3 * 3 + 1 + 2 * 2);
+		sim->resetCallCount();
+		CHECK(AudioAPI::getObjects(snapshot, "chrome", false, EDataFlow::eAll).size() == 1);
+		CHECK(sim->getCallCount() == 1);
+
+		// Fuzzy searches tolerate typos & only select the best matching name
+		CHECK(AudioAPI::getObjects(snapshot, "discrd", true, EDataFlow::eAll).size() == 2);
+		CHECK(AudioAPI::getObjects(snapshot, "discrd", false, EDataFlow::eAll).empty());
+
+		// Several targets are resolved against the same snapshot; overlapping matches are only activated once
+		sim->resetCallCount();
+		const auto& set{ AudioAPI::getObjectsForTargets(snapshot, { "chrome", "discord", "200", "spotify" }, false, EDataFlow::eAll) };
+		CHECK(set.objects.size() == 3);
+		CHECK(set.unmatched == std::vector<std::string>{ "spotify" });
+		CHECK(sim->getCallCount() == 3);
+
+		// Lists are sorted by several keys at once, & rows that compare equal keep their enumeration order
+		const auto& byFlow{ AudioAPI::GetAllAudioProcessesSorted(snapshot) };
+		CHECK((byFlow[0].pid == 100 && byFlow[1].pid == 200 && byFlow[2].flow == EDataFlow::eCapture));
+		AudioAPI::getObjects(snapshot, "chrome", false, EDataFlow::eAll).front()->setVolume(0.5f);
+		const auto& byVolume{ AudioAPI::GetAllAudioProcessesSorted(snapshot, ParseSortKeys("-volume,-pid")) };
+		CHECK((byVolume[0].flow == EDataFlow::eRender && byVolume[1].flow == EDataFlow::eCapture && byVolume[2].pid == 100));
+		const auto& byDevice{ AudioAPI::GetAllAudioProcessesSorted(snapshot, ParseSortKeys("device,name")) };
+		CHECK((byDevice[0].dname == "Microphone" && byDevice[1].pname == "chrome" && byDevice[2].pname == "Discord"));
+
+		// Filters select devices & sessions by any field, & are evaluated before the fields they don't test are fetched
+		const Filter quiet{ "type==session && volume < 75" };
+		CHECK(AudioAPI::getObjectsWhere(snapshot, quiet, EDataFlow::eAll).size() == 1);
+		CHECK(AudioAPI::getObjectsWhere(snapshot, Filter{ "flow==in || pid==100" }, EDataFlow::eAll).size() == 3);
+		CHECK(AudioAPI::getObjectsWhere(snapshot, Filter{ "dname~speakers" }, EDataFlow::eCapture).empty());
+		const auto& filtered{ AudioAPI::getObjectsForTargets(snapshot, { "discord", "chrome" }, false, EDataFlow::eAll, true, AudioAPI::DEFAULT_FUZZY_LIMIT, &quiet) };
+		CHECK(filtered.objects.size() == 1);
+		CHECK(filtered.unmatched == std::vector<std::string>{ "discord" });
+		const Filter discord{ "pname==discord && default" };
+		const auto& listed{ AudioAPI::GetAllAudioProcessesSorted(snapshot, AudioAPI::DEFAULT_SESSION_SORT, EDataFlow::eAll, true, &discord) };
+		CHECK((listed.size() == 2 && listed[0].pname == "Discord"));
+		sim->resetCallCount();
+		CHECK(AudioAPI::GetAllAudioDevicesSorted(snapshot, AudioAPI::DEFAULT_DEVICE_SORT, EDataFlow::eAll, &quiet).empty());
+		CHECK(sim->getCallCount() == 0);
+
+		// Streamed lists hold the same rows as the snapshot's, in enumeration order
+		std::vector<DWORD> streamed;
+		AudioAPI::StreamAudioProcesses(*sim, EDataFlow::eAll, false, &discord, [&](ProcessInfo const& info) { streamed.emplace_back(info.pid); });
+		CHECK(streamed == std::vector<DWORD>{ 200, 200 });
+		size_t streamedDevices{ 0 };
+		AudioAPI::StreamAudioDevices(*sim, EDataFlow::eCapture, nullptr, [&](DeviceInfo const& info) { streamedDevices += info.dname == "Microphone"; });
+		CHECK(streamedDevices == 1);
+
+		// The filter applies while each device's session is chosen, so a later session with the same PID can be selected
+		auto& headphones{ sim->addDevice("Headphones", EDataFlow::eRender) };
+		sim->addSession(headphones, 300, "vlc");
+		sim->setVolume(sim->addSession(headphones, 300, "vlc"), 0.2f, false);
+		const auto& withHeadphones{ AudioAPI::getSnapshot() };
+		const auto& vlc{ AudioAPI::getObjectsForTargets(withHeadphones, { "vlc", "300" }, false, EDataFlow::eAll, true, AudioAPI::DEFAULT_FUZZY_LIMIT, &quiet) };
+		REQUIRE(vlc.objects.size() == 1);
+		CHECK(vlc.objects.front()->getVolume() == doctest::Approx(0.2f));
+		CHECK(vlc.unmatched.empty());
+
+		AudioAPI::setBackend(nullptr);
+	}
 }
@@ -0,0 +1,143 @@
+#pragma once
+#include "Volume.hpp"
+#include "ProcessNameResolver.hpp"
+
+#include <memory>
+
+namespace vccli {
+	struct AudioSession;
+
+	/**
+	 * @interface	AudioEventSink
+	 * @brief		Receives change notifications from the objects that it was subscribed to.
+	 *\n			Notifications can arrive on any thread, including several at once, so implementations must be thread-safe.
+	 *\n			Each notification carries the key that was passed when subscribing, which identifies the object that changed.
+	 */
+	struct AudioEventSink {
+		virtual ~AudioEventSink() = default;
+
+		/**
+		 * @brief		Called when the volume level or mute state of a device or session changes.
+		 * @param key	The subscription key of the device or session.
+		 * @param level	The new volume level, in the range 0.0 - 1.0.
+		 * @param muted	The new mute state.
+		 */
+		virtual void onVolumeChanged(std::string const& key, float level, bool muted) = 0;
+		/**
+		 * @brief			Called when a new audio session is created on a device.
+		 * @param key		The subscription key of the device.
+		 * @param session	The new session.
+		 */
+		virtual void onSessionCreated(std::string const& key, std::unique_ptr<AudioSession> session) = 0;
+		/**
+		 * @brief		Called when an audio session expires or is disconnected.
+		 * @param key	The subscription key of the session.
+		 */
+		virtual void onSessionExpired(std::string const& key) = 0;
+	};
+
+	/**
+	 * @interface	AudioEventSubscription
+	 * @brief		Keeps an AudioEventSink subscribed to an object. Destroying it unsubscribes the sink;
+	 *				 once the destructor returns the sink doesn't receive any more notifications from that object.
+	 */
+	struct AudioEventSubscription {
+		virtual ~AudioEventSubscription() = default;
+	};
+
+	/**
+	 * @interface	AudioSession
+	 * @brief		A single audio session that belongs to an AudioDevice.
+	 */
+	struct AudioSession {
+		virtual ~AudioSession() = default;
+
+		virtual DWORD getProcessId() const = 0;
+		virtual std::string getSessionIdentifier() const = 0;
+		virtual std::string getSessionInstanceIdentifier() const = 0;
+
+		/**
+		 * @brief					Activates a volume control object for this session.
+		 * @param resolved_name		The process name to attach to the returned object.
+		 * @param flow				The data flow of the device that owns this session.
+		 * @param deviceID			The ID of the device that owns this session.
+		 * @param suid				The session identifier of this session.
+		 * @param sguid				The session instance identifier of this session.
+		 * @returns					A valid ApplicationVolume object that controls this session.
+		 */
+		virtual std::unique_ptr<ApplicationVolume> activateVolume(std::string const& resolved_name, EDataFlow flow, std::string const& deviceID, std::string const& suid, std::string const& sguid) const = 0;
+
+		/**
+		 * @brief		Subscribes the given sink to volume, mute & expiry notifications from this session.
+		 * @param sink	The sink to notify. This must outlive the returned subscription.
+		 * @param key	The key to pass to the sink with each notification.
+		 * @returns		The subscription.
+		 */
+		virtual std::unique_ptr<AudioEventSubscription> subscribe(AudioEventSink& sink, std::string const& key) const = 0;
+	};
+
+	/**
+	 * @interface	AudioDevice
+	 * @brief		A single audio endpoint device.
+	 */
+	struct AudioDevice {
+		virtual ~AudioDevice() = default;
+
+		virtual std::string getID() const = 0;
+		virtual std::string getFriendlyName() const = 0;
+		virtual EDataFlow getDataFlow() const = 0;
+
+		/// @brief	Enumerates all of the audio sessions that currently exist on this device.
+		virtual std::vector<std::unique_ptr<AudioSession>> getSessions() const = 0;
+
+		/**
+		 * @brief					Activates a volume control object for this device.
+		 * @param resolved_name		The device name to attach to the returned object.
+		 * @param flow				The data flow of this device.
+		 * @param isDefault			Whether this device is a default device or not.
+		 * @returns					A valid EndpointVolume object that controls this device.
+		 */
+		virtual std::unique_ptr<EndpointVolume> activateVolume(std::string const& resolved_name, EDataFlow flow, const bool isDefault) const = 0;
+
+		/**
+		 * @brief		Subscribes the given sink to volume, mute & session creation notifications from this device.
+		 * @param sink	The sink to notify. This must outlive the returned subscription.
+		 * @param key	The key to pass to the sink with each notification.
+		 * @returns		The subscription.
+		 */
+		virtual std::unique_ptr<AudioEventSubscription> subscribe(AudioEventSink& sink, std::string const& key) const = 0;
+	};
+
+	/**
+	 * @interface	AudioBackend
+	 * @brief		Provides access to the audio devices & sessions on the system.
+	 *\n			All of the enumeration, resolution & apply paths in AudioAPI go through this interface,
+	 *				 which allows them to run against something other than the Windows Core Audio API.
+	 *\n			Backends also provide the process table that is used to resolve process names.
+	 */
+	struct AudioBackend : ProcessTableSource {
+		virtual ~AudioBackend() = default;
+
+		/**
+		 * @brief		Enumerates all active audio devices.
+		 * @param flow	Only devices with this data flow are returned; eAll returns all devices.
+		 * @returns		A vector of devices, in enumeration order.
+		 */
+		virtual std::vector<std::unique_ptr<AudioDevice>> getDevices(EDataFlow flow) = 0;
+		/**
+		 * @brief		Gets the default multimedia device for the given data flow.
+		 * @param flow	eRender or eCapture.
+		 * @returns		The default device when one exists; otherwise nullptr.
+		 */
+		virtual std::unique_ptr<AudioDevice> getDefaultDevice(EDataFlow flow) = 0;
+		/**
+		 * @brief			Gets the device with the given device ID.
+		 * @param deviceID	The ID of the device to retrieve.
+		 * @returns			The device when it exists; otherwise nullptr.
+		 */
+		virtual std::unique_ptr<AudioDevice> getDevice(std::string const& deviceID) = 0;
+
+		/// @brief	Gets the number of calls that were made through this backend so far, including calls made on the objects it returned.
+		virtual size_t getCallCount() const = 0;
+	};
+}
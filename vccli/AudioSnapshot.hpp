@@ -0,0 +1,545 @@
+#pragma once
+#include "AudioBackend.hpp"
+#include "TargetIndex.hpp"
+#include "StringArena.hpp"
+#include "DeviceCache.hpp"
+#include "SimulatedBackend.hpp"
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace vccli {
+	/**
+	 * @class	AudioSnapshot
+	 * @brief	View of all of the audio devices & sessions on the system, captured in a single enumeration pass.
+	 *\n		Every query made during one invocation reads from the same snapshot instead of enumerating the devices again.
+	 *\n		Capturing a snapshot only enumerates the device & session objects; each of their properties is fetched from the
+	 *			 backend the first time that it's read & memoised, so a query only pays for the properties that it looks at.
+	 *			 i.e. resolving a PID never reads session identifiers, & listing sessions never resolves them unless they're shown.
+	 *\n		All of the strings in the snapshot's records are views of strings interned in the snapshot's StringArena, so
+	 *			 they're valid for as long as the snapshot is, & values that are shared by many records are only stored once.
+	 *\n		When a DeviceCache is given & it's valid for the devices that were enumerated, device names & data flows are
+	 *			 read from it instead of the backend.
+	 *\n		The backend (& the DeviceCache, if there is one) that the snapshot was captured from must outlive it.
+	 */
+	class AudioSnapshot {
+		/// @brief	State shared by all of the records in one snapshot, which they use to fetch their properties.
+		struct Context {
+			AudioBackend& backend;
+			/// @brief	Guards the strings, & the properties of every record while they're being stored.
+			std::mutex mutex;
+			/// @brief	Owns the strings that the records & lookup indexes refer to.
+			StringArena strings;
+			ProcessNameResolver processNames;
+			/// @brief	Device names & data flows are read from this instead of the backend when it isn't nullptr.
+			DeviceCache const* deviceCache{ nullptr };
+
+			std::once_flag defaultIDsFlag;
+			std::string_view defaultRenderID, defaultCaptureID;
+
+			Context(AudioBackend& backend) : backend{ backend }, processNames{ backend } {}
+
+			/// @brief	Gets the IDs of the default input & output devices, fetching them on the first call.
+			std::pair<std::string_view, std::string_view> getDefaultIDs()
+			{
+				std::call_once(defaultIDsFlag, [this]() {
+					$trace("AudioSnapshot::getDefaultIDs");
+					const auto& render{ backend.getDefaultDevice(EDataFlow::eRender) }, & capture{ backend.getDefaultDevice(EDataFlow::eCapture) };
+					const auto& renderID{ render ? render->getID() : std::string{} }, & captureID{ capture ? capture->getID() : std::string{} };
+					std::scoped_lock lock(mutex);
+					defaultRenderID = strings.intern(renderID);
+					defaultCaptureID = strings.intern(captureID);
+				});
+				return{ defaultRenderID, defaultCaptureID };
+			}
+
+			/**
+			 * @brief			Gets a property of a record, fetching & storing it if it wasn't fetched yet.
+			 *\n				The backend is called without holding the lock, so properties of different records can be fetched at
+			 *					 the same time; when two threads fetch the same property at once, the first value to be stored wins.
+			 * @param fetched	The bitmask of the properties that the record has fetched.
+			 * @param bit		The bit that belongs to the property.
+			 * @param value		The storage of the property.
+			 * @param get		A function that fetches the property from the backend.
+			 * @returns			A reference to the stored value.
+			 */
+			template<typename T, std::invocable F>
+			T const& fetch(std::atomic<uint8_t>& fetched, const uint8_t bit, T& value, F&& get)
+			{
+				if ((fetched.load(std::memory_order_acquire) & bit) == 0) {
+					auto result{ get() };
+					std::scoped_lock lock(mutex);
+					if ((fetched.load(std::memory_order_relaxed) & bit) == 0) {
+						if constexpr (std::same_as<T, std::string_view>)
+							value = strings.intern(result);
+						else if constexpr (std::same_as<T, std::optional<std::string_view>>) {
+							if (result.has_value())
+								value = strings.intern(result.value());
+						}
+						else value = std::move(result);
+						fetched.fetch_or(bit, std::memory_order_release);
+					}
+				}
+				return value;
+			}
+		};
+
+		/// @brief	Bitmask of the properties that a record has fetched.  This is copyable so that records can be stored in a std::vector.
+		struct FetchedBits : std::atomic<uint8_t> {
+			FetchedBits() : std::atomic<uint8_t>{ 0 } {}
+			FetchedBits(FetchedBits const& o) : std::atomic<uint8_t>{ o.load() } {}
+		};
+
+	public:
+		/**
+		 * @class	DeviceRecord
+		 * @brief	One device in a snapshot.  Each property is fetched from the backend the first time that it's read.
+		 */
+		class DeviceRecord {
+			friend class AudioSnapshot;
+
+			enum : uint8_t { ID = 1, NAME = 2, FLOW = 4 };
+
+			Context* context;
+			mutable FetchedBits fetched;
+			mutable std::string_view id_, name_;
+			mutable EDataFlow flow_{};
+
+			std::optional<DeviceCache::Device> findCached() const
+			{
+				if (context->deviceCache == nullptr)
+					return std::nullopt;
+				return context->deviceCache->find(id());
+			}
+
+			DeviceRecord(Context& context, std::unique_ptr<AudioDevice>&& handle, const size_t sessionsBegin, const size_t sessionsEnd) : context{ &context }, handle{ std::move(handle) }, sessionsBegin{ sessionsBegin }, sessionsEnd{ sessionsEnd } {}
+
+		public:
+			std::unique_ptr<AudioDevice> handle;
+			/// @brief	The index of the first session on this device.
+			size_t sessionsBegin;
+			/// @brief	One past the index of the last session on this device.
+			size_t sessionsEnd;
+
+			/// @brief	Gets the device ID.  (DGUID)
+			std::string_view id() const { return context->fetch(fetched, ID, id_, [this]() { return handle->getID(); }); }
+			/// @brief	Gets the friendly name of the device.  (DNAME)
+			std::string_view name() const
+			{
+				return context->fetch(fetched, NAME, name_, [this]() {
+					if (const auto& cached{ findCached() }; cached.has_value())
+						return std::string{ cached->name };
+					return handle->getFriendlyName();
+				});
+			}
+			/// @brief	Gets the data flow of the device.
+			EDataFlow flow() const
+			{
+				return context->fetch(fetched, FLOW, flow_, [this]() {
+					if (const auto& cached{ findCached() }; cached.has_value())
+						return cached->flow;
+					return handle->getDataFlow();
+				});
+			}
+			/// @brief	Checks if this is the default input or output device.
+			bool isDefault() const
+			{
+				const auto& [renderID, captureID] { context->getDefaultIDs() };
+				const auto& deviceID{ id() };
+				return !deviceID.empty() && (deviceID == renderID || deviceID == captureID);
+			}
+		};
+		/**
+		 * @class	SessionRecord
+		 * @brief	One session in a snapshot.  Each property is fetched from the backend the first time that it's read.
+		 */
+		class SessionRecord {
+			friend class AudioSnapshot;
+
+			enum : uint8_t { PID = 1, PNAME = 2, SUID = 4, SGUID = 8 };
+
+			Context* context;
+			mutable FetchedBits fetched;
+			mutable DWORD pid_{};
+			mutable std::optional<std::string_view> pname_;
+			mutable std::string_view suid_, sguid_;
+
+			SessionRecord(Context& context, std::unique_ptr<AudioSession>&& handle, const size_t device) : context{ &context }, handle{ std::move(handle) }, device{ device } {}
+
+		public:
+			std::unique_ptr<AudioSession> handle;
+			/// @brief	The index of the device that this session belongs to.
+			size_t device;
+
+			/// @brief	Gets the ID of the process that owns this session.  (PID)
+			DWORD pid() const { return context->fetch(fetched, PID, pid_, [this]() { return handle->getProcessId(); }); }
+			/// @brief	Gets the name of the process that owns this session, if it could be resolved.  (PNAME)
+			std::optional<std::string_view> pname() const { return context->fetch(fetched, PNAME, pname_, [this]() { return context->processNames.resolve(pid()); }); }
+			/// @brief	Gets the session identifier.  (SUID)
+			std::string_view suid() const { return context->fetch(fetched, SUID, suid_, [this]() { return handle->getSessionIdentifier(); }); }
+			/// @brief	Gets the session instance identifier.  (SGUID)
+			std::string_view sguid() const { return context->fetch(fetched, SGUID, sguid_, [this]() { return handle->getSessionInstanceIdentifier(); }); }
+		};
+
+	private:
+		std::unique_ptr<Context> context;
+		std::vector<DeviceRecord> devices;
+		std::vector<SessionRecord> sessions;
+
+		// Lookup indexes; each one is built the first time that it's used, so it only fetches the properties that it needs.
+		mutable std::once_flag deviceIndexByIDFlag, sessionIndexesByPIDFlag, sessionIndexesByIDFlag;
+		mutable std::unordered_map<std::string_view, size_t> deviceIndexByID;
+		mutable std::unordered_map<DWORD, std::vector<size_t>> sessionIndexesByPID;
+		mutable std::unordered_map<std::string_view, std::vector<size_t>> sessionIndexesBySUID;
+		mutable std::unordered_map<std::string_view, size_t> sessionIndexBySGUID;
+
+		struct TargetIndexes {
+			/// @brief	DNAME -> device index
+			TargetIndex deviceNames;
+			/// @brief	PNAME -> session index
+			TargetIndex sessionNames;
+			/// @brief	DGUID -> device index
+			TargetIndex deviceIDs;
+			/// @brief	SUID & SGUID -> session index
+			TargetIndex sessionIDs;
+		};
+		mutable std::once_flag nameIndexesFlag, idIndexesFlag;
+		mutable TargetIndexes targetIndexes;
+
+		static const std::vector<size_t>& emptyIndexes()
+		{
+			static const std::vector<size_t> empty;
+			return empty;
+		}
+
+		void buildNameIndexes() const
+		{
+			$trace("AudioSnapshot::buildNameIndexes");
+			for (size_t i{ 0 }; i < devices.size(); ++i)
+				targetIndexes.deviceNames.add(devices[i].name(), static_cast<TargetIndex::value_t>(i));
+			for (size_t i{ 0 }; i < sessions.size(); ++i)
+				if (const auto& pname{ sessions[i].pname() }; pname.has_value())
+					targetIndexes.sessionNames.add(pname.value(), static_cast<TargetIndex::value_t>(i));
+		}
+		void buildIDIndexes() const
+		{
+			$trace("AudioSnapshot::buildIDIndexes");
+			for (size_t i{ 0 }; i < devices.size(); ++i)
+				targetIndexes.deviceIDs.add(devices[i].id(), static_cast<TargetIndex::value_t>(i), false);
+			for (size_t i{ 0 }; i < sessions.size(); ++i) {
+				const auto value{ static_cast<TargetIndex::value_t>(i) };
+				targetIndexes.sessionIDs.add(sessions[i].suid(), value, false);
+				targetIndexes.sessionIDs.add(sessions[i].sguid(), value, false);
+			}
+		}
+
+	public:
+		/**
+		 * @brief			Captures a new snapshot of all of the devices & sessions exposed by the given backend.
+		 * @param backend		The backend to enumerate.  This must outlive the snapshot.
+		 * @param deviceCache	An optional cache of device names & data flows, which is validated against the IDs of the
+		 *						 enumerated devices & rebuilt when it doesn't match.  This must outlive the snapshot.
+		 * @param pool			When not nullptr, the sessions of each device are enumerated on the pool's threads at the same time.
+		 *						 The results are merged in device order, so the snapshot is the same either way.
+		 */
+		AudioSnapshot(AudioBackend& backend, DeviceCache* deviceCache = nullptr, ThreadPool* pool = nullptr) : context{ std::make_unique<Context>(backend) }
+		{
+			$trace("AudioSnapshot::AudioSnapshot");
+			auto deviceHandles{ backend.getDevices(EDataFlow::eAll) };
+			devices.reserve(deviceHandles.size());
+
+			std::vector<std::vector<std::unique_ptr<AudioSession>>> sessionHandles(deviceHandles.size());
+			const auto& enumerate{ [&](const size_t i) { sessionHandles[i] = deviceHandles[i]->getSessions(); } };
+			if (pool != nullptr && deviceHandles.size() > 1)
+				pool->parallelFor(deviceHandles.size(), enumerate);
+			else for (size_t i{ 0 }; i < deviceHandles.size(); ++i)
+				enumerate(i);
+
+			size_t sessionCount{ 0 };
+			for (const auto& handles : sessionHandles)
+				sessionCount += handles.size();
+			sessions.reserve(sessionCount);
+
+			for (size_t i{ 0 }; i < deviceHandles.size(); ++i) {
+				const size_t sessionsBegin{ sessions.size() };
+				for (auto& session : sessionHandles[i])
+					sessions.emplace_back(SessionRecord{ *context, std::move(session), i });
+				devices.emplace_back(DeviceRecord{ *context, std::move(deviceHandles[i]), sessionsBegin, sessions.size() });
+			}
+
+			if (deviceCache != nullptr) {
+				std::vector<std::string_view> ids;
+				ids.reserve(devices.size());
+				for (const auto& dev : devices)
+					ids.emplace_back(dev.id());
+				if (deviceCache->isValidFor(ids))
+					context->deviceCache = deviceCache;
+				else {
+					std::vector<DeviceCache::Device> entries;
+					entries.reserve(devices.size());
+					for (const auto& dev : devices)
+						entries.emplace_back(DeviceCache::Device{ dev.id(), dev.name(), dev.flow() });
+					deviceCache->rebuild(std::move(entries));
+				}
+			}
+		}
+		AudioSnapshot(AudioSnapshot const&) = delete;
+
+		/// @brief	Gets all of the devices in the snapshot, in enumeration order.
+		const std::vector<DeviceRecord>& getDevices() const { return devices; }
+		/// @brief	Gets all of the sessions in the snapshot, grouped by device in enumeration order.
+		const std::vector<SessionRecord>& getSessions() const { return sessions; }
+
+		/**
+		 * @brief					Fetches the properties of the devices & sessions that a list reads, one device per task on the given pool.
+		 *\n						Properties that were already fetched aren't fetched again, & reading them afterwards doesn't call the backend.
+		 * @param pool				The pool to fetch the properties on.
+		 * @param flow				Only devices with this data flow (& their sessions) are fetched.
+		 * @param withSessionIDs	When true, the session identifiers (SUID & SGUID) are fetched too.
+		 */
+		void prefetch(ThreadPool& pool, const EDataFlow flow = EDataFlow::eAll, const bool withSessionIDs = false) const
+		{
+			$trace("AudioSnapshot::prefetch");
+			context->getDefaultIDs();
+			pool.parallelFor(devices.size(), [&](const size_t i) {
+				const auto& dev{ devices[i] };
+				dev.id();
+				dev.name();
+				if (const auto devFlow{ dev.flow() }; flow != EDataFlow::eAll && devFlow != flow)
+					return;
+				for (size_t j{ dev.sessionsBegin }; j < dev.sessionsEnd; ++j) {
+					const auto& session{ sessions[j] };
+					session.pname();
+					if (withSessionIDs) {
+						session.suid();
+						session.sguid();
+					}
+				}
+			});
+		}
+
+		/// @brief	Gets the device that owns the given session.
+		const DeviceRecord& getDeviceOf(SessionRecord const& session) const { return devices[session.device]; }
+
+		/**
+		 * @brief		Gets the ID of the default device for the given data flow.
+		 * @param flow	eRender or eCapture.
+		 * @returns		The device ID of the default device; or an empty string when there isn't one.
+		 */
+		std::string_view getDefaultDeviceID(const EDataFlow flow) const
+		{
+			const auto& [renderID, captureID] { context->getDefaultIDs() };
+			return flow == EDataFlow::eCapture ? captureID : renderID;
+		}
+		/// @brief	Checks if the given device ID belongs to a default input or output device.
+		bool isDefaultDevice(const std::string_view deviceID) const
+		{
+			const auto& [renderID, captureID] { context->getDefaultIDs() };
+			return !deviceID.empty() && (deviceID == renderID || deviceID == captureID);
+		}
+
+		/// @brief	Gets the device with the given device ID, or nullptr if it doesn't exist.
+		const DeviceRecord* findDevice(const std::string_view deviceID) const
+		{
+			std::call_once(deviceIndexByIDFlag, [this]() {
+				deviceIndexByID.reserve(devices.size());
+				for (size_t i{ 0 }; i < devices.size(); ++i)
+					deviceIndexByID.emplace(devices[i].id(), i);
+			});
+			if (const auto& it{ deviceIndexByID.find(deviceID) }; it != deviceIndexByID.end())
+				return &devices[it->second];
+			return nullptr;
+		}
+		/// @brief	Gets the indexes of all sessions that belong to the given process ID.
+		const std::vector<size_t>& findSessionsByPID(const DWORD pid) const
+		{
+			std::call_once(sessionIndexesByPIDFlag, [this]() {
+				for (size_t i{ 0 }; i < sessions.size(); ++i)
+					sessionIndexesByPID[sessions[i].pid()].emplace_back(i);
+			});
+			if (const auto& it{ sessionIndexesByPID.find(pid) }; it != sessionIndexesByPID.end())
+				return it->second;
+			return emptyIndexes();
+		}
+	private:
+		void buildSessionIndexesByID() const
+		{
+			sessionIndexBySGUID.reserve(sessions.size());
+			for (size_t i{ 0 }; i < sessions.size(); ++i) {
+				sessionIndexesBySUID[sessions[i].suid()].emplace_back(i);
+				sessionIndexBySGUID.emplace(sessions[i].sguid(), i);
+			}
+		}
+	public:
+		/// @brief	Gets the indexes of all sessions with the given session identifier.
+		const std::vector<size_t>& findSessionsBySUID(const std::string_view suid) const
+		{
+			std::call_once(sessionIndexesByIDFlag, &AudioSnapshot::buildSessionIndexesByID, this);
+			if (const auto& it{ sessionIndexesBySUID.find(suid) }; it != sessionIndexesBySUID.end())
+				return it->second;
+			return emptyIndexes();
+		}
+		/// @brief	Gets the session with the given session instance identifier, or nullptr if it doesn't exist.
+		const SessionRecord* findSessionBySGUID(const std::string_view sguid) const
+		{
+			std::call_once(sessionIndexesByIDFlag, &AudioSnapshot::buildSessionIndexesByID, this);
+			if (const auto& it{ sessionIndexBySGUID.find(sguid) }; it != sessionIndexBySGUID.end())
+				return &sessions[it->second];
+			return nullptr;
+		}
+
+		/// @brief	Gets the TargetIndex of all device names in this snapshot, building it on the first call.
+		const TargetIndex& getDeviceNameIndex() const
+		{
+			std::call_once(nameIndexesFlag, &AudioSnapshot::buildNameIndexes, this);
+			return targetIndexes.deviceNames;
+		}
+		/// @brief	Gets the TargetIndex of all process names in this snapshot, building it on the first call.
+		const TargetIndex& getSessionNameIndex() const
+		{
+			std::call_once(nameIndexesFlag, &AudioSnapshot::buildNameIndexes, this);
+			return targetIndexes.sessionNames;
+		}
+		/// @brief	Gets the TargetIndex of all device IDs in this snapshot, building it on the first call.
+		const TargetIndex& getDeviceIDIndex() const
+		{
+			std::call_once(idIndexesFlag, &AudioSnapshot::buildIDIndexes, this);
+			return targetIndexes.deviceIDs;
+		}
+		/// @brief	Gets the TargetIndex of all session identifiers & session instance identifiers in this snapshot, building it on the first call.
+		const TargetIndex& getSessionIDIndex() const
+		{
+			std::call_once(idIndexesFlag, &AudioSnapshot::buildIDIndexes, this);
+			return targetIndexes.sessionIDs;
+		}
+
+		/// @brief	Activates a volume control object for the given device.
+		std::unique_ptr<EndpointVolume> activate(DeviceRecord const& device) const
+		{
+			return device.handle->activateVolume(std::string{ device.name() }, device.flow(), device.isDefault());
+		}
+		/// @brief	Activates a volume control object for the given session.
+		std::unique_ptr<ApplicationVolume> activate(SessionRecord const& session) const
+		{
+			const auto& device{ getDeviceOf(session) };
+			return session.handle->activateVolume(std::string{ session.pname().value_or("") }, device.flow(), std::string{ device.id() }, std::string{ session.suid() }, std::string{ session.sguid() });
+		}
+	};
+
+	TEST_CASE("AudioSnapshot")
+	{
+		SimulatedBackend sim;
+		auto& speakers{ sim.addDevice("Speakers", EDataFlow::eRender) };
+		auto& mic{ sim.addDevice("Microphone", EDataFlow::eCapture) };
+		for (DWORD pid{ 100 }; pid < 103; ++pid) {
+			sim.addSession(speakers, pid, "app" + std::to_string(pid));
+			sim.addSession(mic, pid, "app" + std::to_string(pid));
+		}
+
+		// Only the devices & sessions are enumerated
+		const AudioSnapshot snapshot{ sim };
+		CHECK(sim.getCallCount() == 3);
+
+		// Resolving a PID only reads process IDs
+		sim.resetCallCount();
+		CHECK(snapshot.findSessionsByPID(101).size() == 2);
+		CHECK(sim.getCallCount() == 6);
+		CHECK(snapshot.getSessions()[1].pid() == 101);
+		CHECK(sim.getCallCount() == 6);
+
+		// Names are resolved from one process table, & session identifiers still aren't read
+		sim.resetCallCount();
+		CHECK(snapshot.getSessionNameIndex().findExact("app102").size() == 2);
+		CHECK(snapshot.getSessions()[5].pname() == "app102");
+		CHECK(sim.getCallCount() == 1 + 2);
+
+		sim.resetCallCount();
+		CHECK(snapshot.findSessionBySGUID(snapshot.getSessions()[3].sguid()) == &snapshot.getSessions()[3]);
+		CHECK(sim.getCallCount() == 6 * 2);
+
+		sim.resetCallCount();
+		CHECK(snapshot.getDevices()[0].isDefault());
+		CHECK(snapshot.getDevices()[1].isDefault());
+		CHECK(snapshot.getDefaultDeviceID(EDataFlow::eCapture) == mic.id);
+
+		// The snapshot holds the 2 devices & 6 sessions it enumerated, & releases them when it's destroyed
+		const auto liveObjects{ sim.getLiveObjectCount() };
+		{
+			const AudioSnapshot other{ sim };
+			CHECK(sim.getLiveObjectCount() == liveObjects + 2 + 6);
+			CHECK(other.getDevices()[0].handle->activateVolume("", EDataFlow::eRender, false) != nullptr);
+		}
+		CHECK(sim.getLiveObjectCount() == liveObjects);
+	}
+
+	TEST_CASE("AudioSnapshot on a ThreadPool")
+	{
+		const auto& sim{ SimulatedBackend::generate(8, 10) };
+		ThreadPool pool{ 4 };
+		const AudioSnapshot sequential{ *sim }, parallel{ *sim, nullptr, &pool };
+
+		// devices & sessions are merged in enumeration order, whichever thread enumerated them
+		REQUIRE(parallel.getSessions().size() == sequential.getSessions().size());
+		for (size_t i{ 0 }; i < parallel.getSessions().size(); ++i) {
+			CHECK(parallel.getSessions()[i].sguid() == sequential.getSessions()[i].sguid());
+			CHECK(parallel.getSessions()[i].device == sequential.getSessions()[i].device);
+		}
+
+		// prefetched properties are read without calling the backend again
+		const AudioSnapshot prefetched{ *sim, nullptr, &pool };
+		prefetched.prefetch(pool, EDataFlow::eAll, true);
+		sim->resetCallCount();
+		for (const auto& session : prefetched.getSessions()) {
+			const auto& dev{ prefetched.getDeviceOf(session) };
+			CHECK(!dev.name().empty());
+			CHECK(session.pname().has_value());
+			CHECK(!session.suid().empty());
+			CHECK(dev.flow() != EDataFlow::eAll);
+			dev.isDefault();
+		}
+		CHECK(sim->getCallCount() == 0);
+	}
+
+	TEST_CASE("AudioSnapshot with a DeviceCache")
+	{
+	#ifdef OS_WIN
+		const auto& path{ std::filesystem::temp_directory_path() / ("vccli-snapshot-test-" + std::to_string(GetCurrentProcessId()) + ".cache") };
+	#else
+		const auto& path{ std::filesystem::temp_directory_path() / ("vccli-snapshot-test-" + std::to_string(getpid()) + ".cache") };
+	#endif
+		std::filesystem::remove(path);
+
+		const auto& sim{ SimulatedBackend::generate(4, 2) };
+		const auto& readDevices{ [](AudioSnapshot const& snapshot) {
+			std::string s;
+			for (const auto& device : snapshot.getDevices())
+				s += std::string{ device.name() } + DataFlowToString(device.flow()) + '\n';
+			return s;
+		} };
+
+		std::string expected;
+		{ // The first run builds the cache
+			DeviceCache cache{ path };
+			const AudioSnapshot snapshot{ *sim, &cache };
+			expected = readDevices(snapshot);
+			CHECK(cache.isValidFor({ snapshot.getDevices()[0].id(), snapshot.getDevices()[1].id(), snapshot.getDevices()[2].id(), snapshot.getDevices()[3].id() }));
+		}
+		{ // Later runs only read the device IDs
+			DeviceCache cache{ path };
+			sim->resetCallCount();
+			const AudioSnapshot snapshot{ *sim, &cache };
+			CHECK(readDevices(snapshot) == expected);
+			CHECK(sim->getCallCount() == 1 + 4 + 4);
+		}
+		{ // Adding a device invalidates the cache
+			sim->addDevice("Headphones", EDataFlow::eRender);
+			DeviceCache cache{ path };
+			const AudioSnapshot snapshot{ *sim, &cache };
+			CHECK(snapshot.getDevices().back().name() == "Headphones");
+			CHECK(cache.find(snapshot.getDevices().back().id()).has_value());
+		}
+		std::filesystem::remove(path);
+	}
+}
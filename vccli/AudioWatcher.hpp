@@ -0,0 +1,304 @@
+#pragma once
+#include "AudioSnapshot.hpp"
+#include "SimulatedBackend.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+
+namespace vccli {
+	/**
+	 * @struct	WatchRecord
+	 * @brief	Describes one change reported by an AudioWatcher.
+	 */
+	struct WatchRecord {
+		enum class Event {
+			/// @brief	The initial state of an object, reported once for each object when the watcher starts.
+			State,
+			/// @brief	The volume level or mute state of an object changed.
+			Volume,
+			/// @brief	A new session was created.
+			Created,
+			/// @brief	A session expired or was disconnected.
+			Expired,
+		};
+
+		Event event{ Event::State };
+		bool isSession{ false };
+		DWORD pid{ 0 };
+		std::string pname{}, dname{}, dguid{}, suid{}, sguid{};
+		EDataFlow flow{ EDataFlow::eAll };
+		bool isDefault{ false };
+		float level{ 0.0f };
+		bool muted{ false };
+
+		/// @brief	Gets the name of the given event in the quiet output format.
+		static constexpr std::string_view getEventName(const Event event)
+		{
+			switch (event) {
+			case Event::State:
+				return "STATE";
+			case Event::Volume:
+				return "VOLUME";
+			case Event::Created:
+				return "CREATED";
+			case Event::Expired:
+				return "EXPIRED";
+			default:
+				return "UNKNOWN";
+			}
+		}
+	};
+
+	/**
+	 * @class	AudioWatcher
+	 * @brief	Subscribes to change notifications from the devices & sessions in a snapshot, and turns them into WatchRecords.
+	 *\n		Notifications are queued by whichever thread delivers them, then processed by the thread that calls wait();
+	 *			 that thread sleeps on a condition variable while nothing is happening, so watching is free while idle.
+	 *\n		Sessions that are created while watching are subscribed to automatically.
+	 */
+	class AudioWatcher : AudioEventSink {
+	public:
+		/// @brief	Predicate that selects which devices & sessions are reported.  It receives the initial record of each object.
+		using filter_t = std::function<bool(WatchRecord const&)>;
+
+	private:
+		struct Notification {
+			WatchRecord::Event event;
+			std::string key;
+			float level{ 0.0f };
+			bool muted{ false };
+			std::unique_ptr<AudioSession> session{};
+		};
+		struct Watched {
+			WatchRecord record;
+			std::unique_ptr<AudioEventSubscription> subscription;
+			/// @brief	When false, changes to this object aren't reported.  (Devices are subscribed to for new sessions regardless.)
+			bool reported{ true };
+		};
+
+		AudioSnapshot const& snapshot;
+		ProcessNameResolver processNames;
+		filter_t filter;
+
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::deque<Notification> queue;
+		bool stopping{ false };
+
+		/// @brief	Subscription key -> watched device or session.  Devices are keyed by DGUID, sessions by SGUID.
+		std::unordered_map<std::string, Watched> watched;
+		std::deque<WatchRecord> pending;
+
+		void push(Notification&& n)
+		{
+			{
+				std::scoped_lock lock(mutex);
+				queue.emplace_back(std::move(n));
+			}
+			cv.notify_one();
+		}
+
+		void onVolumeChanged(std::string const& key, float level, bool muted) override
+		{
+			push({ WatchRecord::Event::Volume, key, level, muted, nullptr });
+		}
+		void onSessionCreated(std::string const& key, std::unique_ptr<AudioSession> session) override
+		{
+			push({ WatchRecord::Event::Created, key, 0.0f, false, std::move(session) });
+		}
+		void onSessionExpired(std::string const& key) override
+		{
+			push({ WatchRecord::Event::Expired, key, 0.0f, false, nullptr });
+		}
+
+		/// @brief	Subscribes to a session that was created on the given watched device, & queues its CREATED record.
+		void addSession(WatchRecord const& device, AudioSession& session)
+		{
+			WatchRecord record{ WatchRecord::Event::Created, true };
+			record.pid = session.getProcessId();
+			record.pname = processNames.resolve(record.pid).value_or("");
+			record.suid = session.getSessionIdentifier();
+			record.sguid = session.getSessionInstanceIdentifier();
+			record.dname = device.dname;
+			record.dguid = device.dguid;
+			record.flow = device.flow;
+			record.isDefault = device.isDefault;
+			if (filter && !filter(record))
+				return;
+
+			// subscribe before reading the initial state, so a change in between is still reported
+			auto subscription{ session.subscribe(*this, record.sguid) };
+			const auto& volume{ session.activateVolume(record.pname, record.flow, record.dguid, record.suid, record.sguid) };
+			record.level = volume->getVolume();
+			record.muted = volume->getMuted();
+			pending.emplace_back(record);
+			auto key{ record.sguid };
+			watched.insert_or_assign(std::move(key), Watched{ std::move(record), std::move(subscription), true });
+		}
+
+		/// @brief	Applies a queued notification to the watched objects, & queues the resulting record (if any).
+		void process(Notification& n)
+		{
+			const auto& it{ watched.find(n.key) };
+			if (it == watched.end())
+				return; //< unsubscribed before the notification was processed
+			auto& record{ it->second.record };
+
+			switch (n.event) {
+			case WatchRecord::Event::Volume:
+				if (!it->second.reported || (record.level == n.level && record.muted == n.muted))
+					return;
+				record.event = WatchRecord::Event::Volume;
+				record.level = n.level;
+				record.muted = n.muted;
+				pending.emplace_back(record);
+				break;
+			case WatchRecord::Event::Created:
+				if (n.session)
+					addSession(record, *n.session);
+				break;
+			case WatchRecord::Event::Expired:
+				record.event = WatchRecord::Event::Expired;
+				pending.emplace_back(record);
+				watched.erase(it);
+				break;
+			default:
+				break;
+			}
+		}
+
+	public:
+		/**
+		 * @brief					Creates a new watcher for the devices & sessions in the given snapshot.
+		 * @param snapshot			The snapshot to watch.  This must outlive the watcher.
+		 * @param backend			The backend that the snapshot was captured from; used to resolve the names of new sessions.
+		 * @param flow				Only devices with this data flow (& their sessions) are watched; eAll watches all devices.
+		 * @param filter			Selects which devices & sessions are reported; when empty everything is reported.
+		 */
+		AudioWatcher(AudioSnapshot const& snapshot, AudioBackend& backend, const EDataFlow flow, filter_t filter = {}) : snapshot{ snapshot }, processNames{ backend }, filter{ std::move(filter) }
+		{
+			for (const auto& device : snapshot.getDevices()) {
+				if (flow != EDataFlow::eAll && device.flow() != flow)
+					continue;
+
+				WatchRecord deviceRecord{ WatchRecord::Event::State, false };
+				deviceRecord.dname = device.name();
+				deviceRecord.dguid = device.id();
+				deviceRecord.flow = device.flow();
+				deviceRecord.isDefault = device.isDefault();
+
+				// devices are always subscribed to, since they report new sessions
+				auto subscription{ device.handle->subscribe(*this, deviceRecord.dguid) };
+				const bool reportDevice{ !this->filter || this->filter(deviceRecord) };
+				if (reportDevice) {
+					const auto& volume{ snapshot.activate(device) };
+					deviceRecord.level = volume->getVolume();
+					deviceRecord.muted = volume->getMuted();
+					pending.emplace_back(deviceRecord);
+				}
+
+				for (size_t i{ device.sessionsBegin }; i < device.sessionsEnd; ++i) {
+					const auto& session{ snapshot.getSessions()[i] };
+					WatchRecord record{ WatchRecord::Event::State, true, session.pid(), std::string{ session.pname().value_or("") }, std::string{ device.name() }, std::string{ device.id() }, std::string{ session.suid() }, std::string{ session.sguid() }, device.flow(), device.isDefault() };
+					if (this->filter && !this->filter(record))
+						continue;
+
+					auto sessionSubscription{ session.handle->subscribe(*this, record.sguid) };
+					const auto& volume{ snapshot.activate(session) };
+					record.level = volume->getVolume();
+					record.muted = volume->getMuted();
+					pending.emplace_back(record);
+					auto key{ record.sguid };
+					watched.insert_or_assign(std::move(key), Watched{ std::move(record), std::move(sessionSubscription), true });
+				}
+
+				watched.insert_or_assign(std::string{ device.id() }, Watched{ std::move(deviceRecord), std::move(subscription), reportDevice });
+			}
+		}
+		AudioWatcher(AudioWatcher const&) = delete;
+		~AudioWatcher()
+		{
+			// unsubscribe before the queue is destroyed
+			watched.clear();
+		}
+
+		/**
+		 * @brief		Blocks until the next record is available, or until stop() is called.
+		 * @returns		The next record; or std::nullopt once the watcher was stopped.
+		 */
+		std::optional<WatchRecord> wait()
+		{
+			while (pending.empty()) {
+				Notification n;
+				{
+					std::unique_lock lock(mutex);
+					cv.wait(lock, [this]() { return stopping || !queue.empty(); });
+					if (stopping)
+						return std::nullopt;
+					n = std::move(queue.front());
+					queue.pop_front();
+				}
+				process(n);
+			}
+
+			WatchRecord record{ std::move(pending.front()) };
+			pending.pop_front();
+			return record;
+		}
+
+		/// @brief	Wakes up the thread that is waiting & makes wait() return std::nullopt.  This is safe to call from any thread.
+		void stop()
+		{
+			{
+				std::scoped_lock lock(mutex);
+				stopping = true;
+			}
+			cv.notify_all();
+		}
+	};
+
+	TEST_CASE("AudioWatcher")
+	{
+		SimulatedBackend sim;
+		auto& speakers{ sim.addDevice("Speakers", EDataFlow::eRender) };
+		auto& chrome{ sim.addSession(speakers, 100, "chrome") };
+
+		const AudioSnapshot snapshot{ sim };
+		AudioWatcher watcher{ snapshot, sim, EDataFlow::eAll };
+
+		// initial state
+		auto record{ watcher.wait() };
+		REQUIRE(record.has_value());
+		CHECK(record->event == WatchRecord::Event::State);
+		CHECK(!record->isSession);
+		record = watcher.wait();
+		REQUIRE(record.has_value());
+		CHECK((record->event == WatchRecord::Event::State && record->pname == "chrome"));
+
+		// changes made by another thread
+		std::thread driver{ [&]() {
+			sim.setVolume(chrome, 0.5f, true);
+			sim.addSession(speakers, 200, "Discord");
+			sim.setVolume(speakers, 0.25f, false);
+			sim.removeSession(speakers, chrome);
+		} };
+
+		record = watcher.wait();
+		REQUIRE(record.has_value());
+		CHECK((record->event == WatchRecord::Event::Volume && record->pname == "chrome" && record->level == 0.5f && record->muted));
+		record = watcher.wait();
+		REQUIRE(record.has_value());
+		CHECK((record->event == WatchRecord::Event::Created && record->pname == "Discord" && record->pid == 200));
+		record = watcher.wait();
+		REQUIRE(record.has_value());
+		CHECK((record->event == WatchRecord::Event::Volume && !record->isSession && record->level == 0.25f));
+		record = watcher.wait();
+		REQUIRE(record.has_value());
+		CHECK((record->event == WatchRecord::Event::Expired && record->pname == "chrome"));
+
+		driver.join();
+		watcher.stop();
+		CHECK(!watcher.wait().has_value());
+	}
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include "util.hpp"
+
+#include <istream>
+#include <sstream>
+
+namespace vccli {
+	/**
+	 * @brief		Splits one line of a batch script into arguments.
+	 *\n			Arguments are separated by whitespace; single or double quotes group whitespace into one argument, and
+	 *			 a backslash escapes the next character outside of single quotes. Everything after an unquoted '#' is a comment.
+	 * @param line	The line to split.
+	 * @returns		The arguments on the line; or an empty vector if the line is blank or only contains a comment.
+	 */
+	inline std::vector<std::string> splitCommandLine(std::string_view line)
+	{
+		std::vector<std::string> args;
+		std::string current;
+		bool inArg{ false };
+		char quote{ '\0' };
+
+		for (size_t i{ 0 }; i < line.size(); ++i) {
+			const char c{ line[i] };
+
+			if (quote != '\0') {
+				if (c == quote)
+					quote = '\0';
+				else if (c == '\\' && quote == '"' && i + 1 < line.size())
+					current += line[++i];
+				else current += c;
+			}
+			else if (c == '"' || c == '\'') {
+				quote = c;
+				inArg = true;
+			}
+			else if (c == '\\' && i + 1 < line.size()) {
+				current += line[++i];
+				inArg = true;
+			}
+			else if (c == '#' && !inArg)
+				break;
+			else if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+				if (inArg) {
+					args.emplace_back(std::move(current));
+					current.clear();
+					inArg = false;
+				}
+			}
+			else {
+				current += c;
+				inArg = true;
+			}
+		}
+
+		if (quote != '\0')
+			throw make_exception("Unterminated quote in line:  ", line);
+		if (inArg)
+			args.emplace_back(std::move(current));
+
+		return args;
+	}
+
+	/**
+	 * @struct	BatchCommand
+	 * @brief	One command read from a batch script.
+	 */
+	struct BatchCommand {
+		/// @brief	The 1-based line number that the command was read from.
+		size_t line;
+		std::vector<std::string> args;
+		/// @brief	The reason the line couldn't be split into arguments; or an empty string if it was.
+		std::string error;
+	};
+
+	/**
+	 * @brief		Reads all of the commands from a batch script.
+	 * @param is	The stream to read the script from.
+	 * @returns		The commands in the script, in order. Blank lines & comments are skipped.
+	 *\n			A line that can't be split into arguments is returned with an error instead, so the lines around it still run.
+	 */
+	inline std::vector<BatchCommand> readBatchCommands(std::istream& is)
+	{
+		std::vector<BatchCommand> commands;
+		size_t lineNumber{ 0 };
+		for (std::string line; std::getline(is, line); ) {
+			++lineNumber;
+			try {
+				if (auto args{ splitCommandLine(line) }; !args.empty())
+					commands.emplace_back(BatchCommand{ lineNumber, std::move(args), {} });
+			} catch (const std::exception& ex) {
+				commands.emplace_back(BatchCommand{ lineNumber, {}, ex.what() });
+			}
+		}
+		return commands;
+	}
+
+	TEST_CASE("splitCommandLine")
+	{
+		CHECK(splitCommandLine("").empty());
+		CHECK(splitCommandLine("   # comment").empty());
+		CHECK(splitCommandLine("chrome -v 50") == std::vector<std::string>{ "chrome", "-v", "50" });
+		CHECK(splitCommandLine("\"USB Audio Codec \" -d o -M # mute") == std::vector<std::string>{ "USB Audio Codec ", "-d", "o", "-M" });
+		CHECK(splitCommandLine(R"('C:\Program Files' a\ b "x\"y" a#b)") == std::vector<std::string>{ R"(C:\Program Files)", "a b", "x\"y", "a#b" });
+		CHECK_THROWS(splitCommandLine("\"unterminated"));
+	}
+
+	TEST_CASE("readBatchCommands")
+	{
+		std::stringstream ss{ "chrome -v 50\n\n\"discord -v 25\nspotify -m\n" };
+		const auto& commands{ readBatchCommands(ss) };
+		REQUIRE(commands.size() == 3);
+		CHECK(commands[0].line == 1);
+		CHECK(commands[0].error.empty());
+		CHECK(commands[1].line == 3);
+		CHECK(commands[1].args.empty());
+		CHECK(commands[1].error.starts_with("Unterminated quote"));
+		CHECK(commands[2].line == 4);
+		CHECK(commands[2].args == std::vector<std::string>{ "spotify", "-m" });
+	}
+}
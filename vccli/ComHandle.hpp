@@ -0,0 +1,247 @@
+#pragma once
+#include <sysarch.h>
+
+#include "Utf.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <concepts>
+#include <utility>
+
+#include <doctest/doctest.h>
+
+#ifdef OS_WIN
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#include <propidl.h>
+#endif
+
+namespace vccli {
+	/// @brief	Requires a reference-counted type with the AddRef & Release member functions of IUnknown.
+	template<typename T>
+	concept ReferenceCounted = requires(T* p) {
+		p->AddRef();
+		p->Release();
+	};
+
+	/**
+	 * @class	ComPtr
+	 * @brief	Move-only owner of one reference to a reference-counted object, such as a COM interface.
+	 *\n		The reference is released when the ComPtr is destroyed, reset, or reused as an out parameter.
+	 * @tparam	T	The interface type.
+	 */
+	template<ReferenceCounted T>
+	class ComPtr {
+		T* p{ nullptr };
+
+	public:
+		ComPtr() = default;
+		/// @brief	Takes ownership of a reference that the caller already holds.  This doesn't call AddRef.
+		explicit ComPtr(T* p) noexcept : p{ p } {}
+		ComPtr(ComPtr const&) = delete;
+		ComPtr(ComPtr&& o) noexcept : p{ std::exchange(o.p, nullptr) } {}
+		~ComPtr() { reset(); }
+
+		ComPtr& operator=(ComPtr const&) = delete;
+		ComPtr& operator=(ComPtr&& o) noexcept
+		{
+			if (this != &o) {
+				reset();
+				p = std::exchange(o.p, nullptr);
+			}
+			return *this;
+		}
+
+		/**
+		 * @brief		Creates a new ComPtr that holds its own reference to the given object.
+		 * @param p		A pointer that is owned by something else, such as a COM method parameter.
+		 * @returns		ComPtr<T>
+		 */
+		static ComPtr share(T* p) noexcept
+		{
+			if (p) p->AddRef();
+			return ComPtr{ p };
+		}
+
+		/// @brief	Releases the held reference, if there is one.
+		void reset() noexcept
+		{
+			if (p) std::exchange(p, nullptr)->Release();
+		}
+		/// @brief	Releases the held reference & returns the address of the empty pointer, for methods that return a new reference through an out parameter.
+		T** put() noexcept
+		{
+			reset();
+			return &p;
+		}
+		/// @brief	Same as put(), for methods that take a `void**` out parameter like IMMDevice::Activate.
+		void** putVoid() noexcept { return reinterpret_cast<void**>(put()); }
+		/// @brief	Gives up ownership of the held reference without releasing it.
+		[[nodiscard]] T* detach() noexcept { return std::exchange(p, nullptr); }
+
+		T* get() const noexcept { return p; }
+		T* operator->() const noexcept { return p; }
+		explicit operator bool() const noexcept { return p != nullptr; }
+
+	#ifdef OS_WIN
+		/**
+		 * @brief		Queries the held object for another interface.
+		 * @tparam U	The interface to query for.
+		 * @returns		A ComPtr to the requested interface; empty when the object doesn't implement it.
+		 */
+		template<ReferenceCounted U>
+		ComPtr<U> as() const noexcept
+		{
+			ComPtr<U> result;
+			if (p) p->QueryInterface(__uuidof(U), result.putVoid());
+			return result;
+		}
+	#endif
+	};
+
+	/**
+	 * @class	UniqueHandle
+	 * @brief	Move-only owner of a handle or pointer that must be passed to a specific function to be freed.
+	 *\n		A default-constructed (null) handle is never freed.
+	 * @tparam	T		The handle type.
+	 * @tparam	Free	The function that frees the handle.
+	 */
+	template<typename T, auto Free> requires std::invocable<decltype(Free), T>
+	class UniqueHandle {
+		T h{};
+
+	public:
+		UniqueHandle() = default;
+		/// @brief	Takes ownership of the given handle.
+		explicit UniqueHandle(T h) noexcept : h{ h } {}
+		UniqueHandle(UniqueHandle const&) = delete;
+		UniqueHandle(UniqueHandle&& o) noexcept : h{ std::exchange(o.h, T{}) } {}
+		~UniqueHandle() { reset(); }
+
+		UniqueHandle& operator=(UniqueHandle const&) = delete;
+		UniqueHandle& operator=(UniqueHandle&& o) noexcept
+		{
+			if (this != &o) {
+				reset();
+				h = std::exchange(o.h, T{});
+			}
+			return *this;
+		}
+
+		/// @brief	Frees the held handle, if there is one.
+		void reset() noexcept
+		{
+			if (h != T{}) Free(std::exchange(h, T{}));
+		}
+		/// @brief	Frees the held handle & returns the address of the empty handle, for functions that return a new handle through an out parameter.
+		T* put() noexcept
+		{
+			reset();
+			return &h;
+		}
+		/// @brief	Gives up ownership of the held handle without freeing it.
+		[[nodiscard]] T detach() noexcept { return std::exchange(h, T{}); }
+
+		T get() const noexcept { return h; }
+		explicit operator bool() const noexcept { return h != T{}; }
+	};
+
+#ifdef OS_WIN
+	/// @brief	A wide string that was allocated by a COM method, like IMMDevice::GetId, & must be freed with CoTaskMemFree.
+	using CoTaskMemString = UniqueHandle<LPWSTR, &CoTaskMemFree>;
+	/// @brief	Memory that was allocated by a Win32 function, like FormatMessage, & must be freed with LocalFree.
+	using LocalMemory = UniqueHandle<HLOCAL, &LocalFree>;
+	/// @brief	A kernel object handle that must be closed with CloseHandle.  INVALID_HANDLE_VALUE must be checked for before taking ownership.
+	using KernelHandle = UniqueHandle<HANDLE, &CloseHandle>;
+
+	/**
+	 * @class	PropVariant
+	 * @brief	Move-only owner of a PROPVARIANT, which is cleared with PropVariantClear when the PropVariant is destroyed.
+	 */
+	class PropVariant {
+		PROPVARIANT pv;
+
+	public:
+		PropVariant() noexcept { PropVariantInit(&pv); }
+		PropVariant(PropVariant const&) = delete;
+		PropVariant(PropVariant&& o) noexcept : pv{ o.pv } { PropVariantInit(&o.pv); }
+		~PropVariant() { PropVariantClear(&pv); }
+
+		PropVariant& operator=(PropVariant const&) = delete;
+		PropVariant& operator=(PropVariant&& o) noexcept
+		{
+			if (this != &o) {
+				PropVariantClear(&pv);
+				pv = o.pv;
+				PropVariantInit(&o.pv);
+			}
+			return *this;
+		}
+
+		/// @brief	Clears the held value & returns its address, for methods that return a value through an out parameter.
+		PROPVARIANT* put() noexcept
+		{
+			PropVariantClear(&pv);
+			return &pv;
+		}
+		PROPVARIANT const& get() const noexcept { return pv; }
+
+		/// @brief	Gets the held value as a UTF-8 string.
+		/// @returns	The string value, or an empty string when the value isn't a wide string.
+		std::string toUtf8() const
+		{
+			return pv.vt == VT_LPWSTR ? utf::toUtf8(pv.pwszVal) : std::string{};
+		}
+	};
+#endif
+
+	TEST_CASE("ComPtr")
+	{
+		struct Counted {
+			std::atomic<int>& live;
+			int refs{ 1 };
+
+			Counted(std::atomic<int>& live) : live{ live } { ++live; }
+			~Counted() { --live; }
+
+			int AddRef() { return ++refs; }
+			int Release()
+			{
+				const int count{ --refs };
+				if (count == 0)
+					delete this;
+				return count;
+			}
+		};
+		std::atomic<int> live{ 0 };
+
+		{
+			ComPtr<Counted> a{ new Counted(live) };
+			ComPtr<Counted> b{ std::move(a) };
+			CHECK(!a);
+			CHECK(b->refs == 1);
+
+			auto c{ ComPtr<Counted>::share(b.get()) };
+			CHECK(b->refs == 2);
+
+			// reusing an out parameter releases the previous reference
+			*c.put() = new Counted(live);
+			CHECK(live == 2);
+			CHECK(b->refs == 1);
+
+			b = std::move(c);
+			CHECK(live == 1);
+		}
+		CHECK(live == 0);
+
+		UniqueHandle<void*, &std::free> h{ std::malloc(16) };
+		const void* const address{ h.get() };
+		auto moved{ std::move(h) };
+		CHECK(!h);
+		CHECK(moved.get() == address);
+		moved.reset();
+		CHECK(!moved);
+	}
+}
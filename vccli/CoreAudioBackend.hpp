@@ -0,0 +1,352 @@
+#pragma once
+#include "AudioBackend.hpp"
+
+#ifdef OS_WIN
+#include <atomic>
+
+/**
+ * @def		$coreAudioCall(name)
+ * @brief	Counts one call made through the CoreAudioBackend, & records a trace span named `name` that covers it.
+ * @param name	A string literal that names the span.
+ */
+#define $coreAudioCall(name) $trace(name); ::vccli::coreAudioCallCount.fetch_add(1, std::memory_order_relaxed)
+
+namespace vccli {
+	/// @brief	The number of calls made through every CoreAudioBackend instance & the objects they returned.
+	inline std::atomic<size_t> coreAudioCallCount{ 0ull };
+
+	/**
+	 * @class	ComCallback
+	 * @brief	Reference-counted IUnknown implementation for COM callback objects that implement a single interface.
+	 * @tparam	TInterface	The callback interface that the derived type implements.
+	 */
+	template<std::derived_from<IUnknown> TInterface>
+	class ComCallback : public TInterface {
+		std::atomic<ULONG> refCount{ 1 };
+
+	public:
+		virtual ~ComCallback() = default;
+
+		ULONG STDMETHODCALLTYPE AddRef() override { return ++refCount; }
+		ULONG STDMETHODCALLTYPE Release() override
+		{
+			const ULONG count{ --refCount };
+			if (count == 0)
+				delete this;
+			return count;
+		}
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppv) override
+		{
+			if (riid == __uuidof(IUnknown) || riid == __uuidof(TInterface)) {
+				AddRef();
+				*ppv = static_cast<TInterface*>(this);
+				return S_OK;
+			}
+			*ppv = nullptr;
+			return E_NOINTERFACE;
+		}
+	};
+
+	/**
+	 * @class	CoreAudioSessionEvents
+	 * @brief	Forwards IAudioSessionEvents notifications to an AudioEventSink.
+	 */
+	class CoreAudioSessionEvents : public ComCallback<IAudioSessionEvents> {
+		AudioEventSink& sink;
+		std::string key;
+
+	public:
+		CoreAudioSessionEvents(AudioEventSink& sink, std::string const& key) : sink{ sink }, key{ key } {}
+
+		HRESULT STDMETHODCALLTYPE OnSimpleVolumeChanged(float level, BOOL muted, LPCGUID) override
+		{
+			sink.onVolumeChanged(key, level, muted != FALSE);
+			return S_OK;
+		}
+		HRESULT STDMETHODCALLTYPE OnStateChanged(AudioSessionState state) override
+		{
+			if (state == AudioSessionStateExpired)
+				sink.onSessionExpired(key);
+			return S_OK;
+		}
+		HRESULT STDMETHODCALLTYPE OnSessionDisconnected(AudioSessionDisconnectReason) override
+		{
+			sink.onSessionExpired(key);
+			return S_OK;
+		}
+		HRESULT STDMETHODCALLTYPE OnDisplayNameChanged(LPCWSTR, LPCGUID) override { return S_OK; }
+		HRESULT STDMETHODCALLTYPE OnIconPathChanged(LPCWSTR, LPCGUID) override { return S_OK; }
+		HRESULT STDMETHODCALLTYPE OnChannelVolumeChanged(DWORD, float[], DWORD, LPCGUID) override { return S_OK; }
+		HRESULT STDMETHODCALLTYPE OnGroupingParamChanged(LPCGUID, LPCGUID) override { return S_OK; }
+	};
+	/**
+	 * @class	CoreAudioEndpointVolumeCallback
+	 * @brief	Forwards IAudioEndpointVolumeCallback notifications to an AudioEventSink.
+	 */
+	class CoreAudioEndpointVolumeCallback : public ComCallback<IAudioEndpointVolumeCallback> {
+		AudioEventSink& sink;
+		std::string key;
+
+	public:
+		CoreAudioEndpointVolumeCallback(AudioEventSink& sink, std::string const& key) : sink{ sink }, key{ key } {}
+
+		HRESULT STDMETHODCALLTYPE OnNotify(PAUDIO_VOLUME_NOTIFICATION_DATA data) override
+		{
+			sink.onVolumeChanged(key, data->fMasterVolume, data->bMuted != FALSE);
+			return S_OK;
+		}
+	};
+	class CoreAudioSession;
+	/**
+	 * @class	CoreAudioSessionNotification
+	 * @brief	Forwards IAudioSessionNotification notifications to an AudioEventSink.
+	 */
+	class CoreAudioSessionNotification : public ComCallback<IAudioSessionNotification> {
+		AudioEventSink& sink;
+		std::string key;
+
+	public:
+		CoreAudioSessionNotification(AudioEventSink& sink, std::string const& key) : sink{ sink }, key{ key } {}
+
+		HRESULT STDMETHODCALLTYPE OnSessionCreated(IAudioSessionControl* sessionControl) override;
+	};
+
+	/**
+	 * @class	CoreAudioSessionSubscription
+	 * @brief	Keeps a CoreAudioSessionEvents object registered with a session.
+	 */
+	class CoreAudioSessionSubscription : public AudioEventSubscription {
+		ComPtr<IAudioSessionControl2> session;
+		ComPtr<CoreAudioSessionEvents> events;
+
+	public:
+		CoreAudioSessionSubscription(IAudioSessionControl2* session, AudioEventSink& sink, std::string const& key) : session{ ComPtr<IAudioSessionControl2>::share(session) }, events{ new CoreAudioSessionEvents(sink, key) }
+		{
+			if (const auto& hr{ session->RegisterAudioSessionNotification(events.get()) }; hr != S_OK)
+				throw make_exception("Failed to register for session notifications:  ", GetErrorMessageFrom(hr), " (code: ", hr, ')');
+		}
+		~CoreAudioSessionSubscription()
+		{
+			session->UnregisterAudioSessionNotification(events.get());
+		}
+	};
+	/**
+	 * @class	CoreAudioDeviceSubscription
+	 * @brief	Keeps a CoreAudioEndpointVolumeCallback & a CoreAudioSessionNotification object registered with a device.
+	 */
+	class CoreAudioDeviceSubscription : public AudioEventSubscription {
+		ComPtr<IAudioEndpointVolume> endpointVolume;
+		ComPtr<IAudioSessionManager2> sessionManager;
+		ComPtr<CoreAudioEndpointVolumeCallback> volumeCallback;
+		ComPtr<CoreAudioSessionNotification> sessionNotification;
+
+	public:
+		CoreAudioDeviceSubscription(IMMDevice* dev, AudioEventSink& sink, std::string const& key) : volumeCallback{ new CoreAudioEndpointVolumeCallback(sink, key) }, sessionNotification{ new CoreAudioSessionNotification(sink, key) }
+		{
+			if (dev->Activate(__uuidof(IAudioEndpointVolume), CLSCTX_INPROC_SERVER, NULL, endpointVolume.putVoid()) == S_OK
+				&& endpointVolume->RegisterControlChangeNotify(volumeCallback.get()) != S_OK)
+				endpointVolume.reset();
+
+			if (dev->Activate(__uuidof(IAudioSessionManager2), CLSCTX_INPROC_SERVER, NULL, sessionManager.putVoid()) == S_OK) {
+				if (sessionManager->RegisterSessionNotification(sessionNotification.get()) == S_OK) {
+					// session notifications aren't delivered until the sessions have been enumerated once
+					ComPtr<IAudioSessionEnumerator> sessionEnumerator;
+					sessionManager->GetSessionEnumerator(sessionEnumerator.put());
+				}
+				else sessionManager.reset();
+			}
+		}
+		~CoreAudioDeviceSubscription()
+		{
+			if (endpointVolume)
+				endpointVolume->UnregisterControlChangeNotify(volumeCallback.get());
+			if (sessionManager)
+				sessionManager->UnregisterSessionNotification(sessionNotification.get());
+		}
+	};
+
+	/**
+	 * @class	CoreAudioSession
+	 * @brief	AudioSession implementation that wraps an IAudioSessionControl2 object.
+	 */
+	class CoreAudioSession : public AudioSession {
+		ComPtr<IAudioSessionControl2> session;
+
+	public:
+		CoreAudioSession(ComPtr<IAudioSessionControl2>&& session) : session{ std::move(session) } {}
+
+		DWORD getProcessId() const override
+		{
+			$coreAudioCall("CoreAudioSession::getProcessId");
+			DWORD pid{};
+			session->GetProcessId(&pid);
+			return pid;
+		}
+		std::string getSessionIdentifier() const override
+		{
+			$coreAudioCall("CoreAudioSession::getSessionIdentifier");
+			return vccli::getSessionIdentifier(session.get());
+		}
+		std::string getSessionInstanceIdentifier() const override
+		{
+			$coreAudioCall("CoreAudioSession::getSessionInstanceIdentifier");
+			return vccli::getSessionInstanceIdentifier(session.get());
+		}
+
+		std::unique_ptr<ApplicationVolume> activateVolume(std::string const& resolved_name, EDataFlow flow, std::string const& deviceID, std::string const& suid, std::string const& sguid) const override
+		{
+			$coreAudioCall("CoreAudioSession::activateVolume");
+			return std::make_unique<ApplicationVolumeController>(session.as<ISimpleAudioVolume>(), resolved_name, getProcessId(), flow, deviceID, suid, sguid);
+		}
+
+		std::unique_ptr<AudioEventSubscription> subscribe(AudioEventSink& sink, std::string const& key) const override
+		{
+			$coreAudioCall("CoreAudioSession::subscribe");
+			return std::make_unique<CoreAudioSessionSubscription>(session.get(), sink, key);
+		}
+	};
+
+	inline HRESULT STDMETHODCALLTYPE CoreAudioSessionNotification::OnSessionCreated(IAudioSessionControl* sessionControl)
+	{
+		if (ComPtr<IAudioSessionControl2> sessionControl2; sessionControl->QueryInterface(__uuidof(IAudioSessionControl2), sessionControl2.putVoid()) == S_OK)
+			sink.onSessionCreated(key, std::make_unique<CoreAudioSession>(std::move(sessionControl2)));
+		return S_OK;
+	}
+
+	/**
+	 * @class	CoreAudioDevice
+	 * @brief	AudioDevice implementation that wraps an IMMDevice object.
+	 */
+	class CoreAudioDevice : public AudioDevice {
+		ComPtr<IMMDevice> dev;
+
+	public:
+		CoreAudioDevice(ComPtr<IMMDevice>&& dev) : dev{ std::move(dev) } {}
+
+		std::string getID() const override
+		{
+			$coreAudioCall("CoreAudioDevice::getID");
+			return getDeviceID(dev.get());
+		}
+		std::string getFriendlyName() const override
+		{
+			$coreAudioCall("CoreAudioDevice::getFriendlyName");
+			return getDeviceFriendlyName(dev.get());
+		}
+		EDataFlow getDataFlow() const override
+		{
+			$coreAudioCall("CoreAudioDevice::getDataFlow");
+			return getDeviceDataFlow(dev.get());
+		}
+
+		std::vector<std::unique_ptr<AudioSession>> getSessions() const override
+		{
+			$coreAudioCall("CoreAudioDevice::getSessions");
+			std::vector<std::unique_ptr<AudioSession>> vec;
+
+			ComPtr<IAudioSessionEnumerator> sessionEnumerator;
+			if (ComPtr<IAudioSessionManager2> mgr; dev->Activate(__uuidof(IAudioSessionManager2), 0, NULL, mgr.putVoid()) != S_OK
+				|| mgr->GetSessionEnumerator(sessionEnumerator.put()) != S_OK)
+				return vec;
+
+			int sessionCount{ 0 };
+			sessionEnumerator->GetCount(&sessionCount);
+
+			vec.reserve(sessionCount);
+
+			ComPtr<IAudioSessionControl> sessionControl;
+			for (int i{ 0 }; i < sessionCount; ++i) {
+				if (sessionEnumerator->GetSession(i, sessionControl.put()) != S_OK)
+					continue;
+				if (auto sessionControl2{ sessionControl.as<IAudioSessionControl2>() })
+					vec.emplace_back(std::make_unique<CoreAudioSession>(std::move(sessionControl2)));
+			}
+
+			return vec;
+		}
+
+		std::unique_ptr<EndpointVolume> activateVolume(std::string const& resolved_name, EDataFlow flow, const bool isDefault) const override
+		{
+			$coreAudioCall("CoreAudioDevice::activateVolume");
+			ComPtr<IAudioEndpointVolume> endpointVolume;
+			dev->Activate(__uuidof(IAudioEndpointVolume), CLSCTX_INPROC_SERVER, NULL, endpointVolume.putVoid());
+			return std::make_unique<EndpointVolumeController>(std::move(endpointVolume), resolved_name, getID(), flow, isDefault);
+		}
+
+		std::unique_ptr<AudioEventSubscription> subscribe(AudioEventSink& sink, std::string const& key) const override
+		{
+			$coreAudioCall("CoreAudioDevice::subscribe");
+			return std::make_unique<CoreAudioDeviceSubscription>(dev.get(), sink, key);
+		}
+	};
+
+	/**
+	 * @class	CoreAudioBackend
+	 * @brief	AudioBackend implementation that uses the Windows Core Audio API.
+	 *\n		COM must be initialized on the calling thread before an instance is created.
+	 */
+	class CoreAudioBackend : public AudioBackend {
+		ComPtr<IMMDeviceEnumerator> deviceEnumerator;
+
+	public:
+		CoreAudioBackend()
+		{
+			$trace("CoreAudioBackend::CoreAudioBackend");
+			if (const auto& hr{ CoCreateInstance(__uuidof(MMDeviceEnumerator), NULL, CLSCTX_INPROC_SERVER, __uuidof(IMMDeviceEnumerator), deviceEnumerator.putVoid()) }; hr != S_OK)
+				throw make_exception(GetErrorMessageFrom(hr), " (code ", hr, ')');
+		}
+		CoreAudioBackend(CoreAudioBackend const&) = delete;
+
+		std::vector<std::unique_ptr<AudioDevice>> getDevices(EDataFlow flow) override
+		{
+			$coreAudioCall("CoreAudioBackend::getDevices");
+			std::vector<std::unique_ptr<AudioDevice>> vec;
+
+			ComPtr<IMMDeviceCollection> devices;
+			if (deviceEnumerator->EnumAudioEndpoints(flow, DEVICE_STATE_ACTIVE, devices.put()) != S_OK)
+				return vec;
+
+			UINT count{ 0 };
+			devices->GetCount(&count);
+
+			vec.reserve(count);
+
+			for (UINT i{ 0u }; i < count; ++i)
+				if (ComPtr<IMMDevice> dev; devices->Item(i, dev.put()) == S_OK)
+					vec.emplace_back(std::make_unique<CoreAudioDevice>(std::move(dev)));
+
+			return vec;
+		}
+		std::unique_ptr<AudioDevice> getDefaultDevice(EDataFlow flow) override
+		{
+			$coreAudioCall("CoreAudioBackend::getDefaultDevice");
+			ComPtr<IMMDevice> dev;
+			if (deviceEnumerator->GetDefaultAudioEndpoint(flow, ERole::eMultimedia, dev.put()) != S_OK)
+				return nullptr;
+			return std::make_unique<CoreAudioDevice>(std::move(dev));
+		}
+		std::unique_ptr<AudioDevice> getDevice(std::string const& deviceID) override
+		{
+			$coreAudioCall("CoreAudioBackend::getDevice");
+			ComPtr<IMMDevice> dev;
+			if (deviceEnumerator->GetDevice(utf::toWide(deviceID).c_str(), dev.put()) != S_OK)
+				return nullptr;
+			return std::make_unique<CoreAudioDevice>(std::move(dev));
+		}
+		process_table_t getProcessTable() override
+		{
+			$coreAudioCall("CoreAudioBackend::getProcessTable");
+			return GetProcessTable();
+		}
+		std::optional<std::string> getProcessName(DWORD pid) override
+		{
+			$coreAudioCall("CoreAudioBackend::getProcessName");
+			return GetProcessNameFrom(pid);
+		}
+		size_t getCallCount() const override
+		{
+			return coreAudioCallCount.load(std::memory_order_relaxed);
+		}
+	};
+}
+#endif
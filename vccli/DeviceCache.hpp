@@ -0,0 +1,375 @@
+#pragma once
+#include "util.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#ifndef OS_WIN
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace vccli {
+	/**
+	 * @class	MappedFile
+	 * @brief	Read-only memory mapping of a whole file.
+	 */
+	class MappedFile {
+		const char* data{ nullptr };
+		size_t size{ 0 };
+	#ifdef OS_WIN
+		HANDLE mapping{ NULL };
+	#endif
+
+		void close()
+		{
+			if (data == nullptr)
+				return;
+		#ifdef OS_WIN
+			UnmapViewOfFile(data);
+			CloseHandle(mapping);
+			mapping = NULL;
+		#else
+			munmap(const_cast<char*>(data), size);
+		#endif
+			data = nullptr;
+			size = 0;
+		}
+
+	public:
+		MappedFile() = default;
+		/**
+		 * @brief		Maps the given file into memory.
+		 *\n			When the file doesn't exist, is empty, or can't be mapped, the result is an empty mapping.
+		 * @param path	The path of the file to map.
+		 */
+		MappedFile(std::filesystem::path const& path)
+		{
+		#ifdef OS_WIN
+			const HANDLE file{ CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL) };
+			if (file == INVALID_HANDLE_VALUE)
+				return;
+			LARGE_INTEGER fileSize{};
+			if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+				if ((mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL)) != NULL) {
+					if ((data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0))) != nullptr)
+						size = static_cast<size_t>(fileSize.QuadPart);
+					else {
+						CloseHandle(mapping);
+						mapping = NULL;
+					}
+				}
+			}
+			CloseHandle(file); //< the mapping keeps the file open
+		#else
+			const int fd{ ::open(path.c_str(), O_RDONLY) };
+			if (fd == -1)
+				return;
+			struct stat st {};
+			if (fstat(fd, &st) == 0 && st.st_size > 0) {
+				if (void* p{ mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0) }; p != MAP_FAILED) {
+					data = static_cast<const char*>(p);
+					size = static_cast<size_t>(st.st_size);
+				}
+			}
+			::close(fd); //< the mapping keeps the file open
+		#endif
+		}
+		MappedFile(MappedFile&& o) noexcept : data{ o.data }, size{ o.size }
+		{
+		#ifdef OS_WIN
+			mapping = o.mapping;
+			o.mapping = NULL;
+		#endif
+			o.data = nullptr;
+			o.size = 0;
+		}
+		MappedFile(MappedFile const&) = delete;
+		~MappedFile() { close(); }
+
+		MappedFile& operator=(MappedFile&& o) noexcept
+		{
+			if (this != &o) {
+				close();
+				data = o.data;
+				size = o.size;
+			#ifdef OS_WIN
+				mapping = o.mapping;
+				o.mapping = NULL;
+			#endif
+				o.data = nullptr;
+				o.size = 0;
+			}
+			return *this;
+		}
+		MappedFile& operator=(MappedFile const&) = delete;
+
+		/// @brief	Gets the contents of the file; or an empty view when nothing is mapped.
+		std::string_view view() const noexcept { return{ data, size }; }
+	};
+
+	/**
+	 * @class	DeviceCache
+	 * @brief	Persistent table of device ID -> friendly name & data flow, kept in a memory-mapped file between runs.
+	 *\n		Reading a device's friendly name opens its property store, which is by far the slowest part of enumerating
+	 *			 devices; the IDs themselves are cheap to get.  The cache is validated against the set of device IDs that
+	 *			 were enumerated, & is only rebuilt when a device was added or removed since it was written.
+	 *\n		Whether a device is the default isn't cached, since that changes far more often than the devices do & it
+	 *			 doesn't need the property store anyway.
+	 *\n		Renaming a device in the control panel doesn't change its ID, so a renamed device keeps its old name until
+	 *			 the cache is rebuilt.  invalidate() (which '--refresh' calls) or deleting the file forces a rebuild.
+	 */
+	class DeviceCache {
+		static constexpr uint32_t MAGIC{ 0x43444356 }; //< "VCDC"
+		static constexpr uint32_t VERSION{ 1 };
+
+		struct Header {
+			uint32_t magic;
+			uint32_t version;
+			/// @brief	The hash of the device IDs that the cache was built from; see hashIDs.
+			uint64_t idSetHash;
+			uint32_t count;
+			/// @brief	The size of the string table that follows the entries.
+			uint32_t stringsSize;
+		};
+		struct Entry {
+			uint32_t idOffset, idLength;
+			uint32_t nameOffset, nameLength;
+			uint32_t flow;
+		};
+
+		std::filesystem::path path;
+		MappedFile file;
+		/// @brief	Points into file when it contains a well-formed cache; otherwise nullptr.
+		const Header* header{ nullptr };
+		const Entry* entries{ nullptr };
+		const char* strings{ nullptr };
+
+		/// @brief	Checks the structure of the mapped file, & points the header, entries & strings into it if it's well-formed.
+		void load()
+		{
+			header = nullptr;
+			entries = nullptr;
+			strings = nullptr;
+
+			const auto& bytes{ file.view() };
+			if (bytes.size() < sizeof(Header))
+				return;
+			const auto* h{ reinterpret_cast<const Header*>(bytes.data()) };
+			if (h->magic != MAGIC || h->version != VERSION)
+				return;
+			if (bytes.size() != sizeof(Header) + static_cast<size_t>(h->count) * sizeof(Entry) + h->stringsSize)
+				return;
+			const auto* e{ reinterpret_cast<const Entry*>(bytes.data() + sizeof(Header)) };
+			for (uint32_t i{ 0 }; i < h->count; ++i) {
+				if (static_cast<uint64_t>(e[i].idOffset) + e[i].idLength > h->stringsSize
+					|| static_cast<uint64_t>(e[i].nameOffset) + e[i].nameLength > h->stringsSize)
+					return;
+			}
+			header = h;
+			entries = e;
+			strings = bytes.data() + sizeof(Header) + static_cast<size_t>(h->count) * sizeof(Entry);
+		}
+
+		std::string_view getID(Entry const& e) const noexcept { return{ strings + e.idOffset, e.idLength }; }
+
+	public:
+		/// @brief	A device in the cache.  The name is a view of the mapped file, so it's only valid until the cache is rebuilt.
+		struct Device {
+			std::string_view id;
+			std::string_view name;
+			EDataFlow flow;
+		};
+
+		/**
+		 * @brief		Gets the path of the cache file to use when one isn't specified.
+		 * @returns		"%LOCALAPPDATA%\vccli\devices.cache" on Windows; "$XDG_CACHE_HOME/vccli/devices.cache" or "~/.cache/vccli/devices.cache" on other platforms.
+		 */
+		static std::filesystem::path getDefaultPath()
+		{
+			const auto& getDir{ [](const char* name) -> std::optional<std::filesystem::path> {
+				if (const char* dir{ std::getenv(name) }; dir != nullptr && *dir != '\0')
+					return std::filesystem::path{ dir };
+				return std::nullopt;
+			} };
+		#ifdef OS_WIN
+			const auto& base{ getDir("LOCALAPPDATA") };
+		#else
+			auto base{ getDir("XDG_CACHE_HOME") };
+			if (!base.has_value())
+				if (const auto& home{ getDir("HOME") }; home.has_value())
+					base = home.value() / ".cache";
+		#endif
+			return base.value_or(std::filesystem::temp_directory_path()) / "vccli" / "devices.cache";
+		}
+
+		/**
+		 * @brief		Gets the hash that a cache is validated with; this doesn't depend on the order of the IDs.
+		 * @param ids	The ID of every device.
+		 */
+		static uint64_t hashIDs(std::vector<std::string_view> ids)
+		{
+			std::sort(ids.begin(), ids.end());
+			// FNV-1a
+			uint64_t hash{ 0xcbf29ce484222325ull };
+			const auto& add{ [&hash](const unsigned char c) {
+				hash ^= c;
+				hash *= 0x100000001b3ull;
+			} };
+			for (const auto& id : ids) {
+				for (const auto& c : id)
+					add(static_cast<unsigned char>(c));
+				add('\0');
+			}
+			return hash;
+		}
+
+		/**
+		 * @brief		Opens the cache file at the given path.  The file is created by rebuild(), when it's first needed.
+		 * @param path	The path of the cache file.
+		 */
+		DeviceCache(std::filesystem::path path) : path{ std::move(path) }, file{ this->path }
+		{
+			$trace("DeviceCache::DeviceCache");
+			load();
+		}
+
+		/// @brief	Gets the path of the cache file.
+		std::filesystem::path const& getPath() const noexcept { return path; }
+
+		/// @brief	Checks if the cache was built from exactly the given set of device IDs.
+		bool isValidFor(std::vector<std::string_view> const& ids) const
+		{
+			return header != nullptr && header->count == ids.size() && header->idSetHash == hashIDs(ids);
+		}
+
+		/// @brief	Marks the cache as out of date, so that the next snapshot rebuilds it instead of reading names from it.
+		void invalidate() noexcept
+		{
+			header = nullptr;
+			entries = nullptr;
+			strings = nullptr;
+		}
+
+		/// @brief	Gets the cached device with the given ID; or std::nullopt when it isn't in the cache.
+		std::optional<Device> find(const std::string_view id) const
+		{
+			if (header == nullptr)
+				return std::nullopt;
+			// entries are sorted by ID
+			const Entry* end{ entries + header->count };
+			const Entry* it{ std::lower_bound(entries, end, id, [this](Entry const& e, const std::string_view id) { return getID(e) < id; }) };
+			if (it == end || getID(*it) != id)
+				return std::nullopt;
+			return Device{ getID(*it), { strings + it->nameOffset, it->nameLength }, static_cast<EDataFlow>(it->flow) };
+		}
+
+		/**
+		 * @brief			Replaces the cache file with one built from the given devices, & maps the new file.
+		 *\n				The file is written to a temporary file that's unique to this process first & then renamed over the old
+		 *					 one, so other processes never read (or write to) a partially written cache.
+		 * @param devices	Every device on the system.
+		 * @returns			True when the file was replaced; false when it couldn't be written, in which case the cache is left unchanged.
+		 */
+		bool rebuild(std::vector<Device> devices)
+		{
+			$trace("DeviceCache::rebuild");
+			std::sort(devices.begin(), devices.end(), [](Device const& l, Device const& r) { return l.id < r.id; });
+
+			std::vector<std::string_view> ids;
+			ids.reserve(devices.size());
+			std::vector<Entry> table;
+			table.reserve(devices.size());
+			std::string stringTable;
+			for (const auto& dev : devices) {
+				ids.emplace_back(dev.id);
+				const auto idOffset{ static_cast<uint32_t>(stringTable.size()) };
+				stringTable += dev.id;
+				const auto nameOffset{ static_cast<uint32_t>(stringTable.size()) };
+				stringTable += dev.name;
+				table.emplace_back(Entry{ idOffset, static_cast<uint32_t>(dev.id.size()), nameOffset, static_cast<uint32_t>(dev.name.size()), static_cast<uint32_t>(dev.flow) });
+			}
+			const Header h{ MAGIC, VERSION, hashIDs(ids), static_cast<uint32_t>(table.size()), static_cast<uint32_t>(stringTable.size()) };
+
+			std::error_code ec;
+			std::filesystem::create_directories(path.parent_path(), ec);
+			auto tmpPath{ path };
+		#ifdef OS_WIN
+			tmpPath += '.' + std::to_string(GetCurrentProcessId()) + ".tmp";
+		#else
+			tmpPath += '.' + std::to_string(getpid()) + ".tmp";
+		#endif
+			{
+				std::ofstream ofs{ tmpPath, std::ios::binary | std::ios::trunc };
+				if (!ofs)
+					return false;
+				ofs.write(reinterpret_cast<const char*>(&h), sizeof(h));
+				ofs.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(Entry)));
+				ofs.write(stringTable.data(), static_cast<std::streamsize>(stringTable.size()));
+				if (!ofs.flush()) {
+					ofs.close();
+					std::filesystem::remove(tmpPath, ec);
+					return false;
+				}
+			}
+			// unmap the old file first; Windows doesn't allow replacing a file that is mapped
+			file = {};
+			std::filesystem::rename(tmpPath, path, ec);
+			if (ec)
+				std::filesystem::remove(tmpPath, ec);
+			file = MappedFile{ path };
+			load();
+			return isValidFor(ids);
+		}
+	};
+
+	TEST_CASE("DeviceCache")
+	{
+	#ifdef OS_WIN
+		const auto& path{ std::filesystem::temp_directory_path() / ("vccli-test-" + std::to_string(GetCurrentProcessId()) + ".cache") };
+	#else
+		const auto& path{ std::filesystem::temp_directory_path() / ("vccli-test-" + std::to_string(getpid()) + ".cache") };
+	#endif
+		std::filesystem::remove(path);
+		{
+			DeviceCache cache{ path };
+			CHECK_FALSE(cache.isValidFor({}));
+			CHECK_FALSE(cache.find("{0.0.0.00000000}.{a}").has_value());
+			REQUIRE(cache.rebuild({ { "{0.0.1.00000000}.{b}", "Microphone", EDataFlow::eCapture }, { "{0.0.0.00000000}.{a}", "Speakers", EDataFlow::eRender } }));
+		}
+		{
+			DeviceCache cache{ path };
+			CHECK(cache.isValidFor({ "{0.0.0.00000000}.{a}", "{0.0.1.00000000}.{b}" }));
+			CHECK(cache.isValidFor({ "{0.0.1.00000000}.{b}", "{0.0.0.00000000}.{a}" }));
+			CHECK_FALSE(cache.isValidFor({ "{0.0.0.00000000}.{a}" }));
+			CHECK_FALSE(cache.isValidFor({ "{0.0.0.00000000}.{a}", "{0.0.1.00000000}.{c}" }));
+
+			const auto& mic{ cache.find("{0.0.1.00000000}.{b}") };
+			REQUIRE(mic.has_value());
+			CHECK(mic->name == "Microphone");
+			CHECK(mic->flow == EDataFlow::eCapture);
+			CHECK_FALSE(cache.find("{0.0.1.00000000}.{c}").has_value());
+
+			// renamed devices are picked up once the cache is invalidated
+			cache.invalidate();
+			CHECK_FALSE(cache.isValidFor({ "{0.0.0.00000000}.{a}", "{0.0.1.00000000}.{b}" }));
+			CHECK_FALSE(cache.find("{0.0.1.00000000}.{b}").has_value());
+
+			REQUIRE(cache.rebuild({}));
+			CHECK(cache.isValidFor({}));
+		}
+
+		// the temporary file is renamed over the cache
+		for (const auto& entry : std::filesystem::directory_iterator{ path.parent_path() })
+			CHECK_FALSE(entry.path().filename().string().starts_with(path.filename().string() + '.'));
+
+		// A truncated file is ignored
+		std::filesystem::resize_file(path, sizeof(uint32_t) * 3);
+		CHECK_FALSE(DeviceCache{ path }.isValidFor({}));
+		std::filesystem::remove(path);
+	}
+}
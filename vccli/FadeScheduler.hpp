@@ -0,0 +1,361 @@
+#pragma once
+#include "Volume.hpp"
+#include "ThreadPool.hpp"
+#ifndef DOCTEST_CONFIG_DISABLE
+#include "SimulatedBackend.hpp"
+#endif
+
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace vccli {
+	/**
+	 * @enum	FadeCurve
+	 * @brief	The shape of a volume fade.
+	 */
+	enum class FadeCurve {
+		/// @brief	Changes the level by the same amount in every tick.
+		Linear,
+		/// @brief	Changes quickly at first, then slowly; sounds more even than linear since loudness is logarithmic.
+		Log,
+		/// @brief	Changes slowly at the start & end, and quickly in the middle.
+		SCurve,
+	};
+
+	/**
+	 * @brief		Parses the name of a fade curve.
+	 * @param s		"linear", "log", or "scurve". (case-insensitive)
+	 * @returns		The FadeCurve with the given name.
+	 */
+	inline FadeCurve ParseFadeCurve(std::string const& s)
+	{
+		const auto& lower{ str::tolower(s) };
+		if (lower == "linear")
+			return FadeCurve::Linear;
+		else if (lower == "log")
+			return FadeCurve::Log;
+		else if (lower == "scurve")
+			return FadeCurve::SCurve;
+		throw make_exception("Invalid fade curve '", s, "'!  Expected 'linear', 'log', or 'scurve'.");
+	}
+	/**
+	 * @brief		Maps the elapsed fraction of a fade to the completed fraction of its level change.
+	 * @param curve	The shape of the fade.
+	 * @param t		The elapsed fraction of the fade, in the range 0.0 - 1.0.
+	 * @returns		The completed fraction of the level change, in the range 0.0 - 1.0.
+	 */
+	inline float ApplyFadeCurve(const FadeCurve curve, const float t)
+	{
+		switch (curve) {
+		case FadeCurve::Log:
+			return std::log10(1.0f + 9.0f * t);
+		case FadeCurve::SCurve:
+			return t * t * (3.0f - 2.0f * t);
+		case FadeCurve::Linear:
+		default:
+			return t;
+		}
+	}
+
+	/**
+	 * @brief		Parses a duration string.
+	 * @param s		A number followed by an optional unit; "ms" (the default), "s", or "m".  Fractions are allowed, e.g. "1.5s".
+	 * @returns		The duration.
+	 */
+	inline std::chrono::milliseconds ParseDuration(std::string const& s)
+	{
+		const auto& str{ str::tolower(str::trim(s)) };
+		const auto unitPos{ str.find_first_not_of("0123456789.") };
+		const auto& number{ str.substr(0, unitPos) }, & unit{ unitPos == std::string::npos ? std::string{} : str.substr(unitPos) };
+		if (number.empty() || std::count(number.begin(), number.end(), '.') > 1)
+			throw make_exception("Invalid duration '", s, "'!");
+
+		double multiplier;
+		if (unit.empty() || unit == "ms")
+			multiplier = 1.0;
+		else if (unit == "s")
+			multiplier = 1000.0;
+		else if (unit == "m")
+			multiplier = 60000.0;
+		else throw make_exception("Invalid duration unit '", unit, "'!  Expected 'ms', 's', or 'm'.");
+
+		return std::chrono::milliseconds{ static_cast<std::chrono::milliseconds::rep>(std::round(std::stod(number) * multiplier)) };
+	}
+
+	/**
+	 * @class	FadeScheduler
+	 * @brief	Drives any number of concurrent volume fades from a single timer thread.
+	 *\n		Every tick, the timer thread calculates the level of each active fade & applies all of them in one pass,
+	 *			 then sleeps until the next tick is due.  When there aren't any active fades it sleeps until one is added.
+	 *\n		Ticks are scheduled on a fixed grid (rather than relative to the end of the previous tick) so that slow
+	 *			 setVolume calls don't accumulate drift.
+	 */
+	class FadeScheduler {
+	public:
+		using clock = std::chrono::steady_clock;
+
+		/**
+		 * @struct	Stats
+		 * @brief	Timing statistics of the ticks that were run since the scheduler was created.
+		 */
+		struct Stats {
+			/// @brief	The number of ticks that were run.
+			size_t ticks{ 0 };
+			/// @brief	The number of setVolume calls that were made.
+			size_t calls{ 0 };
+			/// @brief	The sum of the delay between when each tick was due & when it started.
+			clock::duration totalJitter{};
+			/// @brief	The longest delay between when a tick was due & when it started.
+			clock::duration maxJitter{};
+			/// @brief	The total time spent applying levels.
+			clock::duration totalWork{};
+
+			/// @brief	Gets the average delay between when a tick was due & when it started.
+			clock::duration meanJitter() const { return ticks == 0 ? clock::duration{} : totalJitter / static_cast<clock::rep>(ticks); }
+		};
+
+	private:
+		struct Fade {
+			const Volume* target;
+			float from, to;
+			clock::time_point start;
+			clock::duration duration;
+			FadeCurve curve;
+			std::promise<void> done;
+		};
+
+		/// @brief	The number of setVolume calls per pool task when a tick is split across the thread pool.
+		static constexpr size_t CHUNK_SIZE{ 32 };
+
+		const clock::duration interval;
+		ThreadPool* pool;
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::vector<Fade> fades;
+		/// @brief	The promises of fades that were replaced while a tick was applying levels; they're kept until the tick finishes.
+		std::vector<std::promise<void>> replaced;
+		/// @brief	True while a tick is applying levels outside of the lock.
+		bool applying{ false };
+		Stats stats;
+		bool stopping{ false };
+		std::thread thread;
+
+		void run()
+		{
+		#ifdef OS_WIN
+			const bool comInitialized{ SUCCEEDED(CoInitializeEx(NULL, COINIT::COINIT_MULTITHREADED)) };
+		#endif
+			std::vector<std::pair<const Volume*, float>> levels;
+			std::vector<std::promise<void>> finished;
+			clock::time_point nextTick{};
+
+			std::unique_lock lock(mutex);
+			while (true) {
+				if (fades.empty()) {
+					cv.wait(lock, [this]() { return stopping || !fades.empty(); });
+					nextTick = clock::now();
+				}
+				else cv.wait_until(lock, nextTick, [this]() { return stopping; });
+
+				if (stopping)
+					break;
+
+				const auto& now{ clock::now() };
+				if (now < nextTick)
+					continue; //< spurious wakeup or a fade was added
+
+				// Calculate the level of each fade
+				levels.clear();
+				for (auto it{ fades.begin() }; it != fades.end(); ) {
+					const float t{ it->duration.count() <= 0 ? 1.0f : std::clamp(std::chrono::duration<float>(now - it->start) / std::chrono::duration<float>(it->duration), 0.0f, 1.0f) };
+					levels.emplace_back(it->target, it->from + (it->to - it->from) * ApplyFadeCurve(it->curve, t));
+					if (t >= 1.0f) {
+						finished.emplace_back(std::move(it->done));
+						it = fades.erase(it);
+					}
+					else ++it;
+				}
+				const auto jitter{ now - nextTick };
+				applying = true;
+				lock.unlock();
+
+				// Apply all of the levels that are due in this tick
+				if (pool != nullptr && levels.size() > CHUNK_SIZE) {
+					// split large ticks across the pool so that the per-call latency doesn't add up
+					std::vector<std::future<void>> chunks;
+					chunks.reserve(levels.size() / CHUNK_SIZE + 1);
+					for (size_t begin{ 0 }; begin < levels.size(); begin += CHUNK_SIZE) {
+						chunks.emplace_back(pool->submit([&levels, begin, end = std::min(begin + CHUNK_SIZE, levels.size())]() {
+							for (size_t i{ begin }; i < end; ++i)
+								levels[i].first->setVolume(levels[i].second);
+						}));
+					}
+					for (auto& chunk : chunks)
+						chunk.wait();
+				}
+				else {
+					for (const auto& [target, level] : levels)
+						target->setVolume(level);
+				}
+				for (auto& promise : finished)
+					promise.set_value();
+				finished.clear();
+
+				const auto& end{ clock::now() };
+				lock.lock();
+
+				// the fades that were replaced during this tick may have been in levels, so their targets were in use until now
+				applying = false;
+				for (auto& promise : replaced)
+					promise.set_value();
+				replaced.clear();
+
+				++stats.ticks;
+				stats.calls += levels.size();
+				stats.totalJitter += jitter;
+				stats.maxJitter = std::max(stats.maxJitter, jitter);
+				stats.totalWork += end - now;
+
+				// schedule the next tick on the grid, skipping any ticks that were missed
+				nextTick += interval;
+				if (nextTick <= end)
+					nextTick += ((end - nextTick) / interval + 1) * interval;
+			}
+			// Release anyone waiting on fades that were cancelled
+			for (auto& fade : fades)
+				fade.done.set_value();
+			fades.clear();
+			lock.unlock();
+		#ifdef OS_WIN
+			if (comInitialized) CoUninitialize();
+		#endif
+		}
+
+	public:
+		/**
+		 * @brief			Creates a new FadeScheduler & starts its timer thread.
+		 * @param interval	The time between ticks.
+		 * @param pool		An optional thread pool that ticks with many fades are split across.  This must outlive the scheduler.
+		 */
+		FadeScheduler(const clock::duration interval = std::chrono::milliseconds{ 10 }, ThreadPool* pool = nullptr) : interval{ interval }, pool{ pool }, thread{ &FadeScheduler::run, this } {}
+		FadeScheduler(FadeScheduler const&) = delete;
+		~FadeScheduler()
+		{
+			{
+				std::scoped_lock lock(mutex);
+				stopping = true;
+			}
+			cv.notify_all();
+			thread.join();
+		}
+
+		/**
+		 * @brief			Starts fading the volume of the given target from its current level to the given level.
+		 *\n				If the target is already fading, that fade is replaced by the new one.  The replaced fade's future
+		 *					 becomes ready once the scheduler stops using the target for it, which is after the current tick.
+		 * @param target	The volume object to fade.  This must remain valid until the returned future becomes ready.
+		 * @param level		The target level, in the range 0.0 - 1.0.
+		 * @param duration	The length of the fade.
+		 * @param curve		The shape of the fade.
+		 * @returns			A future that becomes ready when the fade completes or is replaced.
+		 */
+		std::future<void> fade(const Volume* target, const float level, const clock::duration duration, const FadeCurve curve = FadeCurve::Linear)
+		{
+			const float from{ target->getVolume() };
+			std::promise<void> done;
+			auto future{ done.get_future() };
+			{
+				std::scoped_lock lock(mutex);
+				if (const auto& it{ std::find_if(fades.begin(), fades.end(), [target](auto&& f) { return f.target == target; }) }; it != fades.end()) {
+					if (applying)
+						replaced.emplace_back(std::move(it->done));
+					else it->done.set_value();
+					fades.erase(it);
+				}
+				fades.emplace_back(Fade{ target, from, std::clamp(level, 0.0f, 1.0f), clock::now(), duration, curve, std::move(done) });
+			}
+			cv.notify_one();
+			return future;
+		}
+
+		/// @brief	Gets the number of fades that are currently active.
+		size_t size()
+		{
+			std::scoped_lock lock(mutex);
+			return fades.size();
+		}
+		/// @brief	Gets the timing statistics of the ticks that were run so far.
+		Stats getStats()
+		{
+			std::scoped_lock lock(mutex);
+			return stats;
+		}
+	};
+
+	TEST_CASE("FadeScheduler")
+	{
+		CHECK(ParseDuration("500ms") == std::chrono::milliseconds{ 500 });
+		CHECK(ParseDuration("1.5s") == std::chrono::milliseconds{ 1500 });
+		CHECK(ParseDuration("250") == std::chrono::milliseconds{ 250 });
+		CHECK_THROWS(ParseDuration("5h"));
+		CHECK(ApplyFadeCurve(FadeCurve::Log, 1.0f) == 1.0f);
+		CHECK(ApplyFadeCurve(FadeCurve::SCurve, 0.5f) == 0.5f);
+
+		SimulatedBackend sim;
+		auto& speakers{ sim.addDevice("Speakers", EDataFlow::eRender) };
+		sim.addSession(speakers, 100, "chrome");
+		sim.addSession(speakers, 200, "Discord");
+		std::vector<std::unique_ptr<ApplicationVolume>> targets;
+		for (const auto& session : sim.getDevices(EDataFlow::eAll).front()->getSessions())
+			targets.emplace_back(session->activateVolume("", EDataFlow::eRender, "", "", ""));
+
+		FadeScheduler scheduler{ std::chrono::milliseconds{ 5 } };
+		auto first{ scheduler.fade(targets[0].get(), 0.0f, std::chrono::milliseconds{ 50 }) };
+		auto second{ scheduler.fade(targets[1].get(), 0.5f, std::chrono::milliseconds{ 50 }, FadeCurve::SCurve) };
+		first.wait();
+		second.wait();
+		CHECK(targets[0]->getVolume() == 0.0f);
+		CHECK(targets[1]->getVolume() == 0.5f);
+		CHECK(scheduler.size() == 0);
+		CHECK(scheduler.getStats().ticks >= 2);
+
+		// a fade that's replaced while a tick is applying its level isn't finished until that tick is
+		struct BlockingVolume : Volume {
+			mutable std::mutex mutex;
+			mutable std::condition_variable cv;
+			mutable bool entered{ false }, released{ false };
+
+			BlockingVolume() : Volume("blocking", "", EDataFlow::eRender) {}
+
+			bool getMuted() const override { return false; }
+			void setMuted(const bool) const override {}
+			float getVolume() const override { return 1.0f; }
+			void setVolume(const float&) const override
+			{
+				std::unique_lock lock(mutex);
+				entered = true;
+				cv.notify_all();
+				cv.wait(lock, [this] { return released; });
+			}
+			constexpr std::optional<std::string> type_name() const override { return std::nullopt; }
+		} blocking;
+		auto replacedFade{ scheduler.fade(&blocking, 0.0f, std::chrono::seconds{ 10 }) };
+		{
+			std::unique_lock lock(blocking.mutex);
+			blocking.cv.wait(lock, [&blocking] { return blocking.entered; });
+		}
+		auto replacement{ scheduler.fade(&blocking, 0.0f, std::chrono::milliseconds{ 0 }) };
+		CHECK(replacedFade.wait_for(std::chrono::milliseconds{ 20 }) == std::future_status::timeout);
+		{
+			std::scoped_lock lock(blocking.mutex);
+			blocking.released = true;
+		}
+		blocking.cv.notify_all();
+		replacedFade.wait();
+		replacement.wait();
+	}
+}
@@ -0,0 +1,467 @@
+#pragma once
+#include "util.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace vccli {
+	/**
+	 * @enum	FilterField
+	 * @brief	The fields of a device or session that a Filter can test.
+	 */
+	enum class FilterField : uint8_t {
+		/// @brief	'device' or 'session'.
+		TYPE,
+		PID,
+		PNAME,
+		DNAME,
+		DGUID,
+		SUID,
+		SGUID,
+		/// @brief	'in' or 'out'.
+		FLOW,
+		/// @brief	Whether the device (or the session's device) is a default device.
+		DEFAULT,
+		/// @brief	The volume level, in the range 0 - 100.
+		VOLUME,
+		MUTED,
+	};
+
+	/**
+	 * @struct	FilterValue
+	 * @brief	The value of one field of a device or session, as read for a Filter.
+	 *\n		Enumerated & boolean fields are numbers; a field that the row doesn't have (like the PID of a device) is missing.
+	 */
+	struct FilterValue {
+		enum class Kind : uint8_t { Missing, Number, Text };
+
+		Kind kind{ Kind::Missing };
+		double number{ 0.0 };
+		std::string_view text;
+
+		FilterValue() = default;
+		FilterValue(const double number) : kind{ Kind::Number }, number{ number } {}
+		FilterValue(const std::string_view text) : kind{ Kind::Text }, text{ text } {}
+	};
+
+	/**
+	 * @class	Filter
+	 * @brief	A predicate over the fields of devices & sessions, such as `flow==in && volume<50 && pname~"chrome"`.
+	 *\n		The expression is compiled once into a flat program of tests & jumps that is evaluated with a single result
+	 *			 register, so `&&` & `||` short-circuit; fields are only read when a test that needs them is reached.
+	 *			 Order the cheap tests (flow, type, pid, dname) first to avoid fetching expensive fields for rows that are
+	 *			 rejected anyway.
+	 *\n		Grammar:
+	 *\n		  expr       := term ('||' term)*
+	 *\n		  term       := factor ('&&' factor)*
+	 *\n		  factor     := '!' factor | '(' expr ')' | FIELD [OP VALUE]
+	 *\n		  OP         := '==' | '!=' | '<' | '<=' | '>' | '>=' | '~' (contains) | '!~' (doesn't contain)
+	 *\n		  VALUE      := a number, a bare word, or a "quoted" or 'quoted' string
+	 *\n		A FIELD without an operator tests whether a boolean field is true.  String comparisons ignore case, & a test
+	 *			 of a field that the row doesn't have (such as `pid` on a device) is always false.
+	 */
+	class Filter {
+	public:
+		enum class Compare : uint8_t { EQ, NE, LT, LE, GT, GE, CONTAINS, NOT_CONTAINS };
+
+	private:
+		enum class OpCode : uint8_t {
+			/// @brief	Sets the result register to the result of a comparison.
+			TEST,
+			/// @brief	Inverts the result register.
+			NOT,
+			/// @brief	Jumps to `arg` when the result register is false.
+			JUMP_IF_FALSE,
+			/// @brief	Jumps to `arg` when the result register is true.
+			JUMP_IF_TRUE,
+		};
+		struct Instruction {
+			OpCode op;
+			FilterField field{};
+			Compare compare{};
+			/// @brief	The index of the operand for TEST instructions; the index of the target instruction for jumps.
+			uint32_t arg{ 0 };
+		};
+		struct Operand {
+			double number{ 0.0 };
+			/// @brief	The case-folded string, for text fields.
+			std::string text;
+		};
+
+		enum class FieldKind : uint8_t { Number, Text, Boolean, Enum };
+
+		std::string expression;
+		std::vector<Instruction> program;
+		std::vector<Operand> operands;
+		/// @brief	A bit for each FilterField that the program reads.
+		uint32_t fieldMask{ 0 };
+
+		static constexpr FieldKind getFieldKind(const FilterField field) noexcept
+		{
+			switch (field) {
+			case FilterField::PID:
+			case FilterField::VOLUME:
+				return FieldKind::Number;
+			case FilterField::DEFAULT:
+			case FilterField::MUTED:
+				return FieldKind::Boolean;
+			case FilterField::TYPE:
+			case FilterField::FLOW:
+				return FieldKind::Enum;
+			default:
+				return FieldKind::Text;
+			}
+		}
+
+		/**
+		 * @class	Compiler
+		 * @brief	Recursive descent parser that emits the program as it goes.
+		 */
+		class Compiler {
+			Filter& filter;
+			std::string_view s;
+			size_t pos{ 0 };
+
+			[[noreturn]] void fail(std::string_view message) const
+			{
+				throw make_exception("Invalid filter '", filter.expression, "':  ", message, " at position ", pos + 1, '!');
+			}
+
+			void skipWhitespace()
+			{
+				while (pos < s.size() && match::isWhitespace(s[pos]))
+					++pos;
+			}
+			/// @brief	Consumes the given token if it's next.
+			bool accept(const std::string_view token)
+			{
+				skipWhitespace();
+				if (s.substr(pos, token.size()) != token)
+					return false;
+				pos += token.size();
+				return true;
+			}
+			static constexpr bool isWordChar(const char c) noexcept
+			{
+				return !match::isWhitespace(c) && std::string_view{ "()!=<>~&|\"'" }.find(c) == std::string_view::npos;
+			}
+			/// @brief	Reads a bare word or a quoted string.
+			std::string readValue()
+			{
+				skipWhitespace();
+				if (pos < s.size() && (s[pos] == '"' || s[pos] == '\'')) {
+					const char quote{ s[pos++] };
+					std::string value;
+					while (pos < s.size() && s[pos] != quote) {
+						if (s[pos] == '\\' && pos + 1 < s.size())
+							++pos;
+						value += s[pos++];
+					}
+					if (pos == s.size())
+						fail("Unterminated string");
+					++pos;
+					return value;
+				}
+				const auto begin{ pos };
+				while (pos < s.size() && isWordChar(s[pos]))
+					++pos;
+				if (begin == pos)
+					fail("Expected a value");
+				return std::string{ s.substr(begin, pos - begin) };
+			}
+
+			uint32_t emit(const Instruction& instruction)
+			{
+				filter.program.emplace_back(instruction);
+				return static_cast<uint32_t>(filter.program.size() - 1);
+			}
+			/// @brief	Points the given jump instruction at the next instruction to be emitted.
+			void patch(const uint32_t jump)
+			{
+				filter.program[jump].arg = static_cast<uint32_t>(filter.program.size());
+			}
+
+			FilterField parseField()
+			{
+				skipWhitespace();
+				const auto begin{ pos };
+				while (pos < s.size() && (std::isalnum(static_cast<unsigned char>(s[pos])) || s[pos] == '_'))
+					++pos;
+				const auto& name{ s.substr(begin, pos - begin) };
+				const auto& is{ [&name](const std::string_view n) { return match::equalsIgnoreCase(name, n); } };
+				if (is("type")) return FilterField::TYPE;
+				if (is("pid")) return FilterField::PID;
+				if (is("pname")) return FilterField::PNAME;
+				if (is("dname")) return FilterField::DNAME;
+				if (is("dguid")) return FilterField::DGUID;
+				if (is("suid")) return FilterField::SUID;
+				if (is("sguid")) return FilterField::SGUID;
+				if (is("flow") || is("io")) return FilterField::FLOW;
+				if (is("default")) return FilterField::DEFAULT;
+				if (is("volume")) return FilterField::VOLUME;
+				if (is("muted")) return FilterField::MUTED;
+				pos = begin;
+				fail(name.empty() ? "Expected a field name" : "Unknown field '" + std::string{ name } + '\'');
+			}
+			std::optional<Compare> parseCompare()
+			{
+				// longest operators first
+				if (accept("==")) return Compare::EQ;
+				if (accept("!=")) return Compare::NE;
+				if (accept("!~")) return Compare::NOT_CONTAINS;
+				if (accept("<=")) return Compare::LE;
+				if (accept(">=")) return Compare::GE;
+				if (accept("<")) return Compare::LT;
+				if (accept(">")) return Compare::GT;
+				if (accept("~")) return Compare::CONTAINS;
+				if (accept("=")) return Compare::EQ;
+				return std::nullopt;
+			}
+			/// @brief	Converts the given value to the operand of a test of the given field.
+			Operand makeOperand(const FilterField field, const Compare compare, std::string const& value)
+			{
+				const auto kind{ getFieldKind(field) };
+				const bool isEquality{ compare == Compare::EQ || compare == Compare::NE };
+				const auto& is{ [&value](auto&&... names) { return (match::equalsIgnoreCase(value, names) || ...); } };
+				Operand operand;
+				switch (kind) {
+				case FieldKind::Number:
+					if (compare == Compare::CONTAINS || compare == Compare::NOT_CONTAINS)
+						fail("'~' can only be used with text fields");
+					try {
+						size_t end{ 0 };
+						operand.number = std::stod(value, &end);
+						if (end != value.size())
+							fail("Expected a number instead of '" + value + '\'');
+					} catch (const std::logic_error&) {
+						fail("Expected a number instead of '" + value + '\'');
+					}
+					break;
+				case FieldKind::Text:
+					if (!isEquality && compare != Compare::CONTAINS && compare != Compare::NOT_CONTAINS)
+						fail("Text fields can only be compared with '==', '!=', '~' & '!~'");
+					operand.text = match::fold(value);
+					break;
+				case FieldKind::Boolean:
+					if (!isEquality)
+						fail("Boolean fields can only be compared with '==' & '!='");
+					if (is("true", "1", "yes", "on"))
+						operand.number = 1.0;
+					else if (is("false", "0", "no", "off"))
+						operand.number = 0.0;
+					else fail("Expected 'true' or 'false' instead of '" + value + '\'');
+					break;
+				case FieldKind::Enum:
+					if (!isEquality)
+						fail("Enumerated fields can only be compared with '==' & '!='");
+					if (field == FilterField::TYPE) {
+						if (is("session", "s"))
+							operand.number = 1.0;
+						else if (is("device", "d"))
+							operand.number = 0.0;
+						else fail("Expected 'session' or 'device' instead of '" + value + '\'');
+					}
+					else {
+						if (is("i", "in", "input", "rec", "record", "recording"))
+							operand.number = static_cast<double>(EDataFlow::eCapture);
+						else if (is("o", "out", "output", "play", "playback"))
+							operand.number = static_cast<double>(EDataFlow::eRender);
+						else fail("Expected 'in' or 'out' instead of '" + value + '\'');
+					}
+					break;
+				}
+				return operand;
+			}
+
+			void parseComparison()
+			{
+				const auto field{ parseField() };
+				Compare compare{ Compare::EQ };
+				std::string value{ "true" };
+				if (const auto& op{ parseCompare() }; op.has_value()) {
+					compare = op.value();
+					value = readValue();
+				}
+				else if (getFieldKind(field) != FieldKind::Boolean)
+					fail("Expected a comparison operator");
+
+				filter.operands.emplace_back(makeOperand(field, compare, value));
+				filter.fieldMask |= 1u << static_cast<uint8_t>(field);
+				emit({ OpCode::TEST, field, compare, static_cast<uint32_t>(filter.operands.size() - 1) });
+			}
+			void parseFactor()
+			{
+				skipWhitespace();
+				// '!' is a prefix unless it's part of '!=' or '!~', which can't start a factor anyway
+				if (accept("!")) {
+					parseFactor();
+					emit({ OpCode::NOT });
+				}
+				else if (accept("(")) {
+					parseExpression();
+					if (!accept(")"))
+						fail("Expected ')'");
+				}
+				else parseComparison();
+			}
+			void parseTerm()
+			{
+				parseFactor();
+				std::vector<uint32_t> jumps;
+				while (accept("&&")) {
+					jumps.emplace_back(emit({ OpCode::JUMP_IF_FALSE }));
+					parseFactor();
+				}
+				for (const auto& jump : jumps)
+					patch(jump);
+			}
+			void parseExpression()
+			{
+				parseTerm();
+				std::vector<uint32_t> jumps;
+				while (accept("||")) {
+					jumps.emplace_back(emit({ OpCode::JUMP_IF_TRUE }));
+					parseTerm();
+				}
+				for (const auto& jump : jumps)
+					patch(jump);
+			}
+
+		public:
+			Compiler(Filter& filter) : filter{ filter }, s{ filter.expression } {}
+
+			void compile()
+			{
+				parseExpression();
+				skipWhitespace();
+				if (pos != s.size())
+					fail("Unexpected '" + std::string{ s.substr(pos, 1) } + '\'');
+			}
+		};
+
+		static bool test(const Compare compare, FilterValue const& value, Operand const& operand) noexcept
+		{
+			switch (value.kind) {
+			case FilterValue::Kind::Number:
+				switch (compare) {
+				case Compare::EQ: return value.number == operand.number;
+				case Compare::NE: return value.number != operand.number;
+				case Compare::LT: return value.number < operand.number;
+				case Compare::LE: return value.number <= operand.number;
+				case Compare::GT: return value.number > operand.number;
+				case Compare::GE: return value.number >= operand.number;
+				default: return false;
+				}
+			case FilterValue::Kind::Text:
+				switch (compare) {
+				case Compare::EQ: return match::equalsFolded(value.text, operand.text);
+				case Compare::NE: return !match::equalsFolded(value.text, operand.text);
+				case Compare::CONTAINS: return match::findFolded(value.text, operand.text) != std::string_view::npos;
+				case Compare::NOT_CONTAINS: return match::findFolded(value.text, operand.text) == std::string_view::npos;
+				default: return false;
+				}
+			case FilterValue::Kind::Missing:
+			default:
+				return false;
+			}
+		}
+
+	public:
+		/**
+		 * @brief				Compiles a filter expression.
+		 * @param expression	The expression; see the class description for the syntax.
+		 */
+		Filter(std::string expression) : expression{ std::move(expression) }
+		{
+			Compiler{ *this }.compile();
+		}
+
+		/// @brief	Gets the expression that the filter was compiled from.
+		std::string const& getExpression() const noexcept { return expression; }
+		/// @brief	Checks whether the filter reads the given field.
+		bool uses(const FilterField field) const noexcept { return (fieldMask & (1u << static_cast<uint8_t>(field))) != 0; }
+
+		/**
+		 * @brief			Evaluates the filter against one device or session.
+		 * @param getField	Gets the value of a field of the device or session.  Only called for the fields that are tested.
+		 * @returns			true when the device or session matches the filter; otherwise false.
+		 */
+		template<std::invocable<FilterField> F>
+		bool evaluate(F&& getField) const
+		{
+			bool result{ false };
+			for (size_t i{ 0 }; i < program.size(); ++i) {
+				const auto& instruction{ program[i] };
+				switch (instruction.op) {
+				case OpCode::TEST:
+					result = test(instruction.compare, getField(instruction.field), operands[instruction.arg]);
+					break;
+				case OpCode::NOT:
+					result = !result;
+					break;
+				case OpCode::JUMP_IF_FALSE:
+					if (!result) i = instruction.arg - 1;
+					break;
+				case OpCode::JUMP_IF_TRUE:
+					if (result) i = instruction.arg - 1;
+					break;
+				}
+			}
+			return result;
+		}
+	};
+
+	TEST_CASE("Filter")
+	{
+		struct Row {
+			bool isSession;
+			double pid;
+			std::string pname;
+			EDataFlow flow;
+			double volume;
+			bool muted;
+		};
+		size_t reads{ 0 };
+		const auto& matches{ [&reads](Filter const& filter, Row const& row) {
+			return filter.evaluate([&](const FilterField field) -> FilterValue {
+				++reads;
+				switch (field) {
+				case FilterField::TYPE: return row.isSession ? 1.0 : 0.0;
+				case FilterField::PID: return row.isSession ? FilterValue{ row.pid } : FilterValue{};
+				case FilterField::PNAME: return row.isSession ? FilterValue{ std::string_view{ row.pname } } : FilterValue{};
+				case FilterField::FLOW: return static_cast<double>(row.flow);
+				case FilterField::VOLUME: return row.volume;
+				case FilterField::MUTED: return row.muted ? 1.0 : 0.0;
+				default: return{};
+				}
+			});
+		} };
+		const Row chrome{ true, 100, "Chrome", EDataFlow::eCapture, 25, false }, discord{ true, 200, "Discord", EDataFlow::eRender, 80, true }, device{ false, 0, "", EDataFlow::eCapture, 40, false };
+
+		const Filter filter{ "flow==in && volume<50 && pname~\"chro\"" };
+		CHECK(filter.uses(FilterField::PNAME));
+		CHECK(!filter.uses(FilterField::SGUID));
+		CHECK(matches(filter, chrome));
+		CHECK(!matches(filter, device));
+		// short-circuiting; only the flow is read when it doesn't match
+		reads = 0;
+		CHECK(!matches(filter, discord));
+		CHECK(reads == 1);
+
+		CHECK(matches(Filter{ "muted || (type==device && !(volume >= 50))" }, discord));
+		CHECK(matches(Filter{ "muted || (type==device && !(volume >= 50))" }, device));
+		CHECK(!matches(Filter{ "muted || (type==device && !(volume >= 50))" }, chrome));
+		CHECK(matches(Filter{ "pid != 100 && pname !~ 'chrome'" }, discord));
+		// fields that a row doesn't have never match
+		CHECK(!matches(Filter{ "pid != 100" }, device));
+
+		CHECK_THROWS(Filter{ "volume ~ 5" });
+		CHECK_THROWS(Filter{ "flow == sideways" });
+		CHECK_THROWS(Filter{ "size > 3" });
+		CHECK_THROWS(Filter{ "(muted" });
+		CHECK_THROWS(Filter{ "pname == \"chrome" });
+		CHECK_THROWS(Filter{ "" });
+	}
+}
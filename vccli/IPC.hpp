@@ -0,0 +1,357 @@
+#pragma once
+#include "util.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#ifndef OS_WIN
+#include <cerrno>
+#include <cstdlib>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @namespace	vccli::ipc
+ * @brief		Local inter-process communication channel used by the daemon & its clients.
+ *\n			On Windows this is a named pipe; on other platforms it is a Unix domain socket.
+ *\n			Messages are length-prefixed byte strings, so any number of them can be sent over one connection.
+ */
+namespace vccli::ipc {
+	/**
+	 * @brief		Gets the name of the pipe/socket to use when one isn't specified.
+	 * @returns		"\\.\pipe\vccli" on Windows; "$XDG_RUNTIME_DIR/vccli.sock" or "/tmp/vccli-<UID>.sock" on other platforms.
+	 */
+	inline std::string getDefaultEndpointName()
+	{
+	#ifdef OS_WIN
+		return R"(\\.\pipe\vccli)";
+	#else
+		if (const char* runtimeDir{ std::getenv("XDG_RUNTIME_DIR") }; runtimeDir != nullptr && *runtimeDir != '\0')
+			return std::string{ runtimeDir } + "/vccli.sock";
+		return "/tmp/vccli-" + std::to_string(getuid()) + ".sock";
+	#endif
+	}
+
+	/**
+	 * @class	Connection
+	 * @brief	One end of a connection between a client & the daemon.
+	 */
+	class Connection {
+	#ifdef OS_WIN
+		using handle_t = HANDLE;
+		static inline const handle_t invalid_handle{ INVALID_HANDLE_VALUE };
+		bool isServerEnd{ false };
+	#else
+		using handle_t = int;
+		static constexpr handle_t invalid_handle{ -1 };
+	#endif
+
+		handle_t handle{ invalid_handle };
+
+		void close()
+		{
+			if (handle == invalid_handle)
+				return;
+		#ifdef OS_WIN
+			if (isServerEnd) {
+				FlushFileBuffers(handle);
+				DisconnectNamedPipe(handle);
+			}
+			CloseHandle(handle);
+		#else
+			::close(handle);
+		#endif
+			handle = invalid_handle;
+		}
+
+		void writeAll(const char* data, size_t size)
+		{
+			while (size > 0) {
+			#ifdef OS_WIN
+				DWORD written{ 0 };
+				if (!WriteFile(handle, data, static_cast<DWORD>(size), &written, NULL))
+					throw make_exception("Failed to write to the daemon connection:  ", GetErrorMessageFrom(GetLastError()));
+			#else
+				const auto written{ ::send(handle, data, size, MSG_NOSIGNAL) };
+				if (written < 0) {
+					if (errno == EINTR) continue;
+					throw make_exception("Failed to write to the daemon connection:  ", std::strerror(errno));
+				}
+			#endif
+				data += written;
+				size -= static_cast<size_t>(written);
+			}
+		}
+		bool readAll(char* data, size_t size)
+		{
+			while (size > 0) {
+			#ifdef OS_WIN
+				DWORD read{ 0 };
+				if (!ReadFile(handle, data, static_cast<DWORD>(size), &read, NULL) || read == 0)
+					return false;
+			#else
+				const auto read{ ::recv(handle, data, size, 0) };
+				if (read < 0 && errno == EINTR) continue;
+				if (read <= 0)
+					return false;
+			#endif
+				data += read;
+				size -= static_cast<size_t>(read);
+			}
+			return true;
+		}
+
+	public:
+	#ifdef OS_WIN
+		Connection(handle_t handle, const bool isServerEnd) : isServerEnd{ isServerEnd }, handle{ handle } {}
+	#else
+		Connection(handle_t handle) : handle{ handle } {}
+	#endif
+		Connection(Connection&& o) noexcept : handle{ o.handle }
+		{
+		#ifdef OS_WIN
+			isServerEnd = o.isServerEnd;
+		#endif
+			o.handle = invalid_handle;
+		}
+		Connection(Connection const&) = delete;
+		~Connection() { close(); }
+
+		/**
+		 * @brief			Sends one message.
+		 * @param message	The message to send.
+		 */
+		void send(std::string_view message)
+		{
+			const auto size{ static_cast<uint32_t>(message.size()) };
+			char header[sizeof(size)];
+			std::memcpy(header, &size, sizeof(size));
+			writeAll(header, sizeof(header));
+			writeAll(message.data(), message.size());
+		}
+		/**
+		 * @brief		Receives one message, blocking until it arrives.
+		 * @returns		The message; or std::nullopt if the other end closed the connection.
+		 */
+		std::optional<std::string> receive()
+		{
+			uint32_t size{ 0 };
+			char header[sizeof(size)];
+			if (!readAll(header, sizeof(header)))
+				return std::nullopt;
+			std::memcpy(&size, header, sizeof(size));
+			std::string message(size, '\0');
+			if (!readAll(message.data(), message.size()))
+				return std::nullopt;
+			return message;
+		}
+	};
+
+	/**
+	 * @class	Server
+	 * @brief	Listens for client connections on a named pipe/socket.
+	 */
+	class Server {
+		std::string name;
+	#ifdef OS_WIN
+		/// @brief	The pipe instance that the next client connects to.  There's always one, so clients never find the pipe missing.
+		HANDLE pending{ INVALID_HANDLE_VALUE };
+
+		/// @brief	Creates a new instance of the pipe, for the next client to connect to.
+		HANDLE createInstance(const bool first) const
+		{
+			const HANDLE pipe{ CreateNamedPipeA(name.c_str(), PIPE_ACCESS_DUPLEX | (first ? FILE_FLAG_FIRST_PIPE_INSTANCE : 0), PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, PIPE_UNLIMITED_INSTANCES, 4096, 4096, 0, NULL) };
+			if (pipe == INVALID_HANDLE_VALUE) {
+				const auto hr{ GetLastError() };
+				throw make_exception("Failed to create named pipe '", name, "':  ", GetErrorMessageFrom(hr), " (code: ", hr, ')');
+			}
+			return pipe;
+		}
+	#else
+		int listener{ -1 };
+	#endif
+
+	public:
+		/**
+		 * @brief		Starts listening on the given pipe/socket.
+		 *\n			Clients can connect as soon as this returns; they wait until accept() is called.
+		 * @param name	The name of the pipe/socket.
+		 */
+		Server(std::string const& name) : name{ name }
+		{
+		#ifdef OS_WIN
+			pending = createInstance(true); //< fails if another server already owns the pipe
+		#else
+			sockaddr_un addr{};
+			if (name.size() >= sizeof(addr.sun_path))
+				throw make_exception("Socket path is too long:  ", name);
+			addr.sun_family = AF_UNIX;
+			std::memcpy(addr.sun_path, name.c_str(), name.size() + 1);
+
+			if (listener = ::socket(AF_UNIX, SOCK_STREAM, 0); listener < 0)
+				throw make_exception("Failed to create socket:  ", std::strerror(errno));
+
+			::unlink(name.c_str()); //< remove the socket left behind by a daemon that didn't exit cleanly
+			const auto oldMask{ ::umask(0077) }; //< only the current user may connect
+			const bool bound{ ::bind(listener, (sockaddr*)&addr, sizeof(addr)) == 0 };
+			::umask(oldMask);
+			if (!bound || ::listen(listener, 16) != 0) {
+				const auto err{ errno };
+				::close(listener);
+				throw make_exception("Failed to listen on '", name, "':  ", std::strerror(err));
+			}
+		#endif
+		}
+		Server(Server const&) = delete;
+		~Server()
+		{
+		#ifdef OS_WIN
+			if (pending != INVALID_HANDLE_VALUE)
+				CloseHandle(pending);
+		#else
+			if (listener >= 0) {
+				::close(listener);
+				::unlink(name.c_str());
+			}
+		#endif
+		}
+
+		/**
+		 * @brief		Blocks until a client connects.
+		 *\n			On Windows, the next pipe instance is created before this returns, so clients that connect while
+		 *			 this one is being served wait for their turn instead of failing.
+		 * @returns		The server end of the new connection.
+		 */
+		Connection accept()
+		{
+		#ifdef OS_WIN
+			if (!ConnectNamedPipe(pending, NULL) && GetLastError() != ERROR_PIPE_CONNECTED) {
+				const auto hr{ GetLastError() };
+				throw make_exception("Failed to accept a connection on '", name, "':  ", GetErrorMessageFrom(hr), " (code: ", hr, ')');
+			}
+			const HANDLE pipe{ pending };
+			try {
+				pending = createInstance(false);
+			} catch (...) {
+				pending = INVALID_HANDLE_VALUE;
+				CloseHandle(pipe);
+				throw;
+			}
+			return{ pipe, true };
+		#else
+			while (true) {
+				if (const int fd{ ::accept(listener, nullptr, nullptr) }; fd >= 0)
+					return{ fd };
+				else if (errno != EINTR)
+					throw make_exception("Failed to accept a connection on '", name, "':  ", std::strerror(errno));
+			}
+		#endif
+		}
+	};
+
+	/**
+	 * @brief		Connects to the daemon listening on the given pipe/socket.
+	 * @param name	The name of the pipe/socket.
+	 * @param wait	How long to keep retrying while the pipe/socket doesn't exist yet, for a daemon that's still starting up.
+	 * @returns		The client end of the connection; or std::nullopt if nothing is listening.
+	 */
+	inline std::optional<Connection> connect(std::string const& name, const std::chrono::milliseconds wait = std::chrono::milliseconds{ 500 })
+	{
+		static constexpr std::chrono::milliseconds RETRY_INTERVAL{ 10 };
+		const auto& deadline{ std::chrono::steady_clock::now() + wait };
+	#ifdef OS_WIN
+		while (true) {
+			if (const HANDLE pipe{ CreateFileA(name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL) }; pipe != INVALID_HANDLE_VALUE)
+				return Connection{ pipe, false };
+			else if (const auto err{ GetLastError() }; err == ERROR_PIPE_BUSY) {
+				if (!WaitNamedPipeA(name.c_str(), 5000))
+					return std::nullopt;
+			}
+			else if (err == ERROR_FILE_NOT_FOUND && std::chrono::steady_clock::now() < deadline)
+				std::this_thread::sleep_for(RETRY_INTERVAL);
+			else return std::nullopt;
+		}
+	#else
+		sockaddr_un addr{};
+		if (name.size() >= sizeof(addr.sun_path))
+			return std::nullopt;
+		addr.sun_family = AF_UNIX;
+		std::memcpy(addr.sun_path, name.c_str(), name.size() + 1);
+
+		while (true) {
+			const int fd{ ::socket(AF_UNIX, SOCK_STREAM, 0) };
+			if (fd < 0)
+				return std::nullopt;
+			if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0)
+				return Connection{ fd };
+			const auto err{ errno };
+			::close(fd);
+			if ((err == ENOENT || err == ECONNREFUSED) && std::chrono::steady_clock::now() < deadline)
+				std::this_thread::sleep_for(RETRY_INTERVAL);
+			else return std::nullopt;
+		}
+	#endif
+	}
+
+	/// @brief	Joins a list of arguments into a single message.
+	inline std::string packArguments(std::vector<std::string> const& args)
+	{
+		std::string message;
+		for (const auto& arg : args)
+			message.append(arg).push_back('\0');
+		return message;
+	}
+	/// @brief	Splits a message created by packArguments back into a list of arguments.
+	inline std::vector<std::string> unpackArguments(std::string_view message)
+	{
+		std::vector<std::string> args;
+		for (size_t pos{ 0 }, end; pos < message.size(); pos = end + 1) {
+			end = message.find('\0', pos);
+			if (end == std::string_view::npos)
+				end = message.size();
+			args.emplace_back(message.substr(pos, end - pos));
+		}
+		return args;
+	}
+
+	TEST_CASE("ipc::Connection")
+	{
+	#ifdef OS_WIN
+		const std::string name{ R"(\\.\pipe\vccli-test-)" + std::to_string(GetCurrentProcessId()) };
+	#else
+		const std::string name{ "/tmp/vccli-test-" + std::to_string(getpid()) + ".sock" };
+	#endif
+		const std::vector<std::string> args{ "chrome", "-v", "", "50" };
+
+		Server server{ name };
+		std::thread serverThread{ [&server]() {
+			for (int i{ 0 }; i < 2; ++i) {
+				auto conn{ server.accept() };
+				while (const auto& message{ conn.receive() })
+					conn.send(message.value());
+			}
+		} };
+
+		{
+			auto client{ connect(name) };
+			REQUIRE(client.has_value());
+			// a second client can connect while the first one is being served, & is served after it
+			auto waiting{ connect(name, std::chrono::milliseconds{ 0 }) };
+			REQUIRE(waiting.has_value());
+
+			client->send(packArguments(args));
+			const auto& reply{ client->receive() };
+			REQUIRE(reply.has_value());
+			CHECK(unpackArguments(reply.value()) == args);
+			client.reset();
+
+			waiting->send("again");
+			CHECK(waiting->receive() == "again");
+		}
+		serverThread.join();
+	}
+}
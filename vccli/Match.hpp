@@ -0,0 +1,272 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <doctest/doctest.h>
+
+#if !defined(VCCLI_SSE2) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define VCCLI_SSE2
+#endif
+#ifdef VCCLI_SSE2
+#include <emmintrin.h>
+#endif
+
+/**
+ * @namespace	vccli::match
+ * @brief		Allocation-free, ASCII case-insensitive string matching.
+ *\n			Needles are case-folded once up front; candidates are folded on the fly while they're compared, 16 bytes at a
+ *			 time with SSE2 when it's available.  Only ASCII letters are folded, which matches how str::tolower behaves.
+ */
+namespace vccli::match {
+	/// @brief	Case-folds one ASCII character.
+	inline constexpr char fold(const char c) noexcept
+	{
+		return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+	}
+	/// @brief	Checks if the given character is whitespace.
+	inline constexpr bool isWhitespace(const char c) noexcept
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+	}
+
+	/// @brief	Gets a view of the given string without leading or trailing whitespace.
+	inline constexpr std::string_view trimWhitespace(std::string_view s) noexcept
+	{
+		while (!s.empty() && isWhitespace(s.front())) s.remove_prefix(1);
+		while (!s.empty() && isWhitespace(s.back())) s.remove_suffix(1);
+		return s;
+	}
+
+#ifdef VCCLI_SSE2
+	/// @brief	Case-folds 16 ASCII characters.
+	inline __m128i fold(const __m128i v) noexcept
+	{
+		// bytes >= 0x80 are negative, so they're never in range
+		const __m128i isUpper{ _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1))) };
+		return _mm_add_epi8(v, _mm_and_si128(isUpper, _mm_set1_epi8('a' - 'A')));
+	}
+#endif
+
+	/**
+	 * @brief		Case-folds a string into the given buffer.
+	 * @param in	The string to fold.
+	 * @param out	The buffer to write to.  This must have room for in.size() characters, & may be the same as in.data().
+	 */
+	inline void fold(const std::string_view in, char* const out) noexcept
+	{
+		size_t i{ 0 };
+	#ifdef VCCLI_SSE2
+		for (; i + 16 <= in.size(); i += 16)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), fold(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in.data() + i))));
+	#endif
+		for (; i < in.size(); ++i)
+			out[i] = fold(in[i]);
+	}
+	/// @brief	Gets a case-folded copy of the given string.
+	inline std::string fold(const std::string_view in)
+	{
+		std::string out(in.size(), '\0');
+		fold(in, out.data());
+		return out;
+	}
+
+	/**
+	 * @brief				Checks if the first n characters of a string are equal to the first n characters of a case-folded needle, ignoring case.
+	 * @param s				The string to compare; this doesn't have to be case-folded.
+	 * @param foldedNeedle	The case-folded needle.
+	 * @param n				The number of characters to compare.
+	 */
+	inline bool equalsFolded(const char* s, const char* foldedNeedle, const size_t n) noexcept
+	{
+		size_t i{ 0 };
+	#ifdef VCCLI_SSE2
+		for (; i + 16 <= n; i += 16) {
+			const __m128i a{ fold(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i))) };
+			const __m128i b{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(foldedNeedle + i)) };
+			if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) != 0xFFFF)
+				return false;
+		}
+	#endif
+		for (; i < n; ++i)
+			if (fold(s[i]) != foldedNeedle[i])
+				return false;
+		return true;
+	}
+	/// @brief	Checks if a string is equal to a case-folded needle, ignoring case.
+	inline bool equalsFolded(const std::string_view s, const std::string_view foldedNeedle) noexcept
+	{
+		return s.size() == foldedNeedle.size() && equalsFolded(s.data(), foldedNeedle.data(), s.size());
+	}
+	/// @brief	Checks if two strings are equal, ignoring case.  Neither string has to be case-folded.
+	inline bool equalsIgnoreCase(const std::string_view l, const std::string_view r) noexcept
+	{
+		if (l.size() != r.size())
+			return false;
+		for (size_t i{ 0 }; i < l.size(); ++i)
+			if (fold(l[i]) != fold(r[i]))
+				return false;
+		return true;
+	}
+
+	/**
+	 * @brief				Finds the first occurrence of a case-folded needle in a string, ignoring case.
+	 *\n					The vectorised path compares the first & last characters of the needle at 16 positions at once,
+	 *					 & only compares the whole needle at the positions where both of them match.
+	 * @param haystack		The string to search; this doesn't have to be case-folded.
+	 * @param foldedNeedle	The case-folded string to search for.
+	 * @returns				The position of the first occurrence; or std::string_view::npos if there isn't one.
+	 */
+	inline size_t findFolded(const std::string_view haystack, const std::string_view foldedNeedle) noexcept
+	{
+		const size_t n{ haystack.size() }, m{ foldedNeedle.size() };
+		if (m == 0) return 0;
+		if (m > n) return std::string_view::npos;
+
+		size_t i{ 0 };
+	#ifdef VCCLI_SSE2
+		const __m128i first{ _mm_set1_epi8(foldedNeedle.front()) }, last{ _mm_set1_epi8(foldedNeedle.back()) };
+		for (; i + m - 1 + 16 <= n; i += 16) {
+			const __m128i blockFirst{ fold(_mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack.data() + i))) };
+			const __m128i blockLast{ fold(_mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack.data() + i + m - 1))) };
+			for (auto mask{ static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast)))) }; mask != 0; mask &= mask - 1) {
+				unsigned bit{ 0 };
+				while (((mask >> bit) & 1) == 0) ++bit;
+				if (m <= 2 || equalsFolded(haystack.data() + i + bit + 1, foldedNeedle.data() + 1, m - 2))
+					return i + bit;
+			}
+		}
+	#endif
+		for (; i + m <= n; ++i)
+			if (fold(haystack[i]) == foldedNeedle.front() && equalsFolded(haystack.data() + i, foldedNeedle.data(), m))
+				return i;
+		return std::string_view::npos;
+	}
+
+	/**
+	 * @class	TargetMatcher
+	 * @brief	Matches candidate strings against a TARGET, ignoring case & any whitespace surrounding either string.
+	 *\n		The target is case-folded & trimmed once when the matcher is created; matching a candidate doesn't allocate.
+	 */
+	class TargetMatcher {
+		std::string needle;
+		bool fuzzy;
+
+	public:
+		/**
+		 * @brief			Creates a new TargetMatcher.
+		 * @param target	The string to match candidates against.
+		 * @param fuzzy		When true, candidates that contain the target match; otherwise candidates must be equal to it.
+		 */
+		TargetMatcher(const std::string_view target, const bool fuzzy) : needle{ fold(trimWhitespace(target)) }, fuzzy{ fuzzy } {}
+
+		/// @brief	Gets the case-folded & trimmed target.
+		std::string const& folded() const noexcept { return needle; }
+
+		/// @brief	Checks if the given candidate matches the target.
+		bool operator()(const std::string_view candidate) const noexcept
+		{
+			const auto& trimmed{ trimWhitespace(candidate) };
+			return fuzzy ? findFolded(trimmed, needle) != std::string_view::npos : equalsFolded(trimmed, needle);
+		}
+	};
+
+	/**
+	 * @class	FuzzyPattern
+	 * @brief	Approximate string matching with Myers' bit-parallel edit distance algorithm.
+	 *\n		Finds the minimum number of edits (insertions, deletions & substitutions) needed to turn the pattern into any
+	 *			 substring of a candidate.  Each character of the candidate costs a handful of bitwise operations on one
+	 *			 64-bit word, regardless of the length of the pattern.
+	 */
+	class FuzzyPattern {
+	public:
+		/// @brief	The maximum length of a pattern; longer patterns are truncated.
+		static constexpr size_t MAX_LENGTH{ 64 };
+
+	private:
+		std::string needle;
+		/// @brief	For each character, a bitmask of the positions in the needle where it occurs.
+		std::array<uint64_t, 256> peq{};
+
+	public:
+		/**
+		 * @brief			Creates a new FuzzyPattern.
+		 * @param target	The string to search for.  This is trimmed, case-folded & truncated to MAX_LENGTH characters.
+		 */
+		FuzzyPattern(const std::string_view target) : needle{ fold(trimWhitespace(target).substr(0, MAX_LENGTH)) }
+		{
+			for (size_t i{ 0 }; i < needle.size(); ++i)
+				peq[static_cast<unsigned char>(needle[i])] |= uint64_t{ 1 } << i;
+		}
+
+		/// @brief	Gets the case-folded pattern.
+		std::string const& folded() const noexcept { return needle; }
+
+		/// @brief	Gets the default maximum number of edits that a candidate can need & still be considered a match; 1 per 4 characters.
+		size_t maxDistance() const noexcept { return needle.size() / 4; }
+
+		/**
+		 * @brief			Gets the edit distance between the pattern & the closest substring of the given candidate, ignoring case.
+		 * @param candidate	The string to search; this doesn't have to be case-folded.
+		 * @returns			0 when the candidate contains the pattern; otherwise the number of edits needed, up to the length of the pattern.
+		 */
+		size_t distance(const std::string_view candidate) const noexcept
+		{
+			const size_t m{ needle.size() };
+			if (m == 0) return 0;
+
+			const uint64_t last{ uint64_t{ 1 } << (m - 1) };
+			uint64_t pv{ ~uint64_t{ 0 } }, mv{ 0 };
+			size_t score{ m }, best{ m };
+
+			for (const char c : candidate) {
+				const uint64_t eq{ peq[static_cast<unsigned char>(fold(c))] };
+				const uint64_t xv{ eq | mv };
+				const uint64_t xh{ (((eq & pv) + pv) ^ pv) | eq };
+				uint64_t ph{ mv | ~(xh | pv) };
+				uint64_t mh{ pv & xh };
+				if (ph & last) ++score;
+				else if (mh & last) --score;
+				// the pattern can start anywhere in the candidate, so the top row of the matrix stays at 0
+				ph <<= 1;
+				mh <<= 1;
+				pv = mh | ~(xv | ph);
+				mv = ph & xv;
+				if (score < best && (best = score) == 0)
+					break;
+			}
+			return best;
+		}
+	};
+
+	TEST_CASE("match")
+	{
+		CHECK(fold(std::string_view{ "Speakers (USB Audio Codec) 0123456789 ÄÖ" }) == "speakers (usb audio codec) 0123456789 ÄÖ");
+		CHECK(equalsFolded("Speakers (Realtek High Definition Audio)", "speakers (realtek high definition audio)"));
+		CHECK(!equalsFolded("Speakers (Realtek High Definition Audio)", "speakers (realtek high definition audi0)"));
+		CHECK(equalsIgnoreCase("Chrome", "cHROME"));
+
+		CHECK(findFolded("Speakers (Realtek High Definition Audio)", "audio") == 34);
+		CHECK(findFolded("Speakers (Realtek High Definition Audio)", "definition") == 23);
+		CHECK(findFolded("Speakers (Realtek High Definition Audio)", "audi0") == std::string_view::npos);
+		CHECK(findFolded("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab", "aab") == 33);
+		CHECK(findFolded("ab", "b") == 1);
+
+		const TargetMatcher exact{ "USB Audio Codec", false }, fuzzy{ " audio ", true };
+		CHECK(exact("USB Audio Codec "));
+		CHECK(!exact("USB Audio Codec 2"));
+		CHECK(fuzzy("Speakers (USB AUDIO Codec )"));
+		CHECK(!fuzzy("Microphone"));
+
+		const FuzzyPattern spotfy{ "Spotfy" };
+		CHECK(spotfy.maxDistance() == 1);
+		CHECK(spotfy.distance("Spotify") == 1);
+		CHECK(spotfy.distance("spotfy.exe") == 0);
+		CHECK(spotfy.distance("Discord") > spotfy.maxDistance());
+		CHECK(FuzzyPattern{ "speakrs usb" }.distance("Speakers (USB Audio Codec )") == 2);
+		CHECK(FuzzyPattern{ std::string(100, 'a') }.distance(std::string(64, 'A')) == 0);
+	}
+}
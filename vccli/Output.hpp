@@ -0,0 +1,510 @@
+#pragma once
+#include "AudioAPI.hpp"
+#include "AudioWatcher.hpp"
+#include "RecordWriter.hpp"
+
+#include <TermAPI.hpp>
+
+// Globals:
+inline bool quiet{ false };
+inline bool extended{ false };
+inline vccli::OutputFormat format{ vccli::OutputFormat::Text };
+
+enum class COLOR {
+	HEADER,
+	VALUE,
+	HIGHLIGHT,
+	LOWLIGHT,
+	WARN,
+	ERR,
+	DEVICE,
+	SESSION,
+	INPUT,
+	OUTPUT,
+};
+inline term::palette<COLOR> colors{
+	std::make_pair(COLOR::HEADER, term::setcolor(term::make_sequence(color::FormatFlag::Bold))),
+	std::make_pair(COLOR::VALUE, color::setcolor(1, 4, 1)),
+	std::make_pair(COLOR::HIGHLIGHT, color::cyan),
+	std::make_pair(COLOR::LOWLIGHT, color::light_gray),
+	std::make_pair(COLOR::WARN, color::yellow),
+	std::make_pair(COLOR::ERR, color::orange),
+	std::make_pair(COLOR::DEVICE, color::setcolor(term::make_sequence(color::setcolor(color::lighter_purple), color::FormatFlag::Bold))),
+	std::make_pair(COLOR::SESSION, color::light_blue),
+	std::make_pair(COLOR::INPUT, color::pink),
+	std::make_pair(COLOR::OUTPUT, color::setcolor(4, 4, 0)),
+};
+inline size_t MARGIN_WIDTH{ 12ull };
+
+/**
+ * @struct	VolumeObjectPrinter
+ * @brief	Stream functor that pretty-prints a vccli::Volume object.
+ */
+struct VolumeObjectPrinter {
+	vccli::Volume* obj;
+
+	/**
+	 * @brief		Creates a new VolumeObjectPrinter instance with the given Volume object pointer.
+	 * @param obj	A pointer to a valid Volume object to print.
+	 */
+	constexpr VolumeObjectPrinter(vccli::Volume* obj) : obj{ obj } {}
+
+	friend std::ostream& operator<<(std::ostream& os, const VolumeObjectPrinter& p)
+	{
+		if (p.obj) {
+			const bool is_session{ p.obj->is_derived_type<vccli::ApplicationVolume>() }, is_device{ !is_session };
+
+			if (quiet) {
+				if (extended) {
+					os
+						<< (is_session ? 'P' : 'D') << "NAME: " << p.obj->resolved_name << '\n'
+						<< (is_session ? "P" : "DGU") << "ID: " << p.obj->identifier << '\n'
+						<< "TYPENAME: " << p.obj->type_name().value() << '\n'
+						<< "DATAFLOW: " << p.obj->getFlowTypeName() << '\n'
+						<< "VOLUME: " << p.obj->getVolumeScaled() << '\n'
+						<< "IS_MUTED: " << std::boolalpha << p.obj->getMuted() << std::noboolalpha << '\n'
+						;
+					if (is_session) {
+						auto* app = (vccli::ApplicationVolume*)p.obj;
+						os
+							<< "SUID: " << app->sessionIdentifier << '\n'
+							<< "SGUID: " << app->sessionInstanceIdentifier << '\n';
+					}
+					else if (is_device)
+						os << "IS_DEFAULT: " << std::boolalpha << ((vccli::EndpointVolume*)p.obj)->isDefault << std::noboolalpha << '\n';
+				}
+				else os << p.obj->type_name().value_or("null");
+			}
+			else {
+				const auto& typecolor{ is_session ? COLOR::SESSION : COLOR::DEVICE };
+				os
+					<< "              " << colors(typecolor) << p.obj->resolved_name << colors() << '\n'
+					<< "Typename:     " << colors(typecolor) << p.obj->type_name().value_or("null") << colors();
+				if (is_device && ((vccli::EndpointVolume*)p.obj)->isDefault) os << ' ' << colors(COLOR::LOWLIGHT) << "(Default)" << colors() << '\n';
+				if (is_session)
+					os << '\n'
+					<< "PID:          " << colors(COLOR::LOWLIGHT) << p.obj->identifier << colors() << '\n';
+				os
+					<< "Direction:    " << colors(p.obj->flow_type == EDataFlow::eRender ? COLOR::OUTPUT : COLOR::INPUT) << p.obj->getFlowTypeName() << colors() << '\n'
+					<< "Volume:       " << colors(COLOR::VALUE) << p.obj->getVolumeScaled() << colors() << '\n'
+					<< "Muted:        " << colors(COLOR::VALUE) << std::boolalpha << p.obj->getMuted() << std::noboolalpha << colors() << '\n'
+					;
+
+				if (extended) {
+					if (is_session) {
+						auto* app{ (vccli::ApplicationVolume*)p.obj };
+						os
+							<< "Session ID:   " << colors(COLOR::VALUE) << app->sessionIdentifier << colors() << '\n'
+							<< "Instance ID:  " << colors(COLOR::VALUE) << app->sessionInstanceIdentifier << colors() << '\n'
+							;
+					}
+				}
+			}
+		}
+		return os;
+	}
+};
+
+namespace vccli_operators {
+	inline constexpr auto SEP{ ';' };
+	inline constexpr auto COLSZ_DNAME{ 30 };
+	inline constexpr auto COLSZ_DGUID{ 57 };
+	inline constexpr auto COLSZ_IO{ 9 };
+	inline constexpr auto COLSZ_DEFAULT{ 9 };
+
+	inline std::ostream& operator<<(std::ostream& os, const vccli::DeviceInfo& di)
+	{ // DEVICE INFO
+		using namespace vccli;
+
+		if (quiet) {
+			os
+				<< di.dname << SEP
+				<< DataFlowToString(di.flow) << SEP
+				<< std::boolalpha << di.isDefault << std::noboolalpha;
+			if (extended)
+				os << SEP << di.dguid;
+		}
+		else {
+			const auto& flow_s{ DataFlowToString(di.flow) };
+			const auto& def_s{ str::stringify(std::boolalpha, di.isDefault) };
+			os
+				<< colors(COLOR::DEVICE) << di.dname << colors() << indent(COLSZ_DNAME, di.dname.size())
+				<< colors(COLOR::VALUE) << flow_s << colors() << indent(COLSZ_IO, flow_s.size())
+				<< colors(COLOR::LOWLIGHT) << def_s << colors();
+			if (extended) os
+				<< indent(COLSZ_DEFAULT, def_s.size()) << di.dguid;
+		}
+		return os;
+	}
+
+	inline constexpr auto COLSZ_PNAME{ 24 };
+	inline constexpr auto COLSZ_PID{ 10 };
+
+	inline std::ostream& operator<<(std::ostream& os, const vccli::ProcessInfo& pi)
+	{ // PROCESS INFO
+		using namespace vccli;
+
+		if (quiet) {
+			os
+				<< pi.pid << SEP
+				<< pi.pname << SEP
+				;
+		}
+		else {
+			const auto& flow_s{ DataFlowToString(pi.flow) };
+			const auto& pid_s{ std::to_string(pi.pid) };
+			os
+				<< '[' << colors(COLOR::SESSION) << pid_s << colors() << ']' << indent(COLSZ_PID, pid_s.size() + 2)
+				<< colors(COLOR::SESSION) << pi.pname << colors() << indent(COLSZ_PNAME, pi.pname.size())
+				;
+		}
+
+		os << static_cast<DeviceInfo const&>(pi);
+
+		if (extended) {
+			if (quiet) os
+				<< SEP
+				<< pi.suid << SEP
+				<< pi.sguid
+				;
+			else os
+				<< indent(2)
+				<< colors(COLOR::DEVICE) << pi.dguid << colors() << SEP
+				<< pi.suid << SEP
+				<< pi.sguid
+				;
+		}
+		return os;
+	}
+
+	inline std::ostream& operator<<(std::ostream& os, const vccli::WatchRecord& r)
+	{ // WATCH RECORD
+		using namespace vccli;
+
+		const auto& field{ [&os](std::string_view name, auto&& value, const COLOR valueColor = COLOR::VALUE) {
+			os << colors(COLOR::HEADER) << name << colors() << '=' << colors(valueColor) << value << colors();
+		} };
+
+		field("EVENT", WatchRecord::getEventName(r.event), COLOR::HIGHLIGHT);
+		os << SEP;
+		field("TYPENAME", r.isSession ? "Session" : "Device", r.isSession ? COLOR::SESSION : COLOR::DEVICE);
+		if (r.isSession) {
+			os << SEP;
+			field("PID", r.pid);
+			os << SEP;
+			field("PNAME", r.pname, COLOR::SESSION);
+		}
+		os << SEP;
+		field("DNAME", r.dname, COLOR::DEVICE);
+		os << SEP;
+		field("I/O", DataFlowToString(r.flow));
+		os << SEP;
+		field("IS_DEFAULT", str::stringify(std::boolalpha, r.isDefault));
+		os << SEP;
+		field("VOLUME", r.level * 100.0f);
+		os << SEP;
+		field("IS_MUTED", str::stringify(std::boolalpha, r.muted));
+		if (extended) {
+			os << SEP;
+			field("DGUID", r.dguid);
+			if (r.isSession) {
+				os << SEP;
+				field("SUID", r.suid);
+				os << SEP;
+				field("SGUID", r.sguid);
+			}
+		}
+		return os;
+	}
+
+	/// @brief	Prints the column headers of a session (ProcessInfo) or device (DeviceInfo) list, followed by a blank line.
+	template<std::derived_from<vccli::basic_info> T>
+	inline void printListHeader(std::ostream& os)
+	{
+		if (quiet) {
+			if constexpr (std::same_as<T, vccli::DeviceInfo>) {
+				os << "DNAME" << SEP << "I/O" << SEP << "IS_DEFAULT";
+				if (extended) os << SEP << "DGUID";
+			}
+			else if constexpr (std::same_as<T, vccli::ProcessInfo>) {
+				os << "PID" << SEP << "PNAME" << SEP << "DNAME" << SEP << "I/O" << SEP << "IS_DEFAULT";
+				if (extended) os << SEP << "DGUID" << SEP << "SUID" << SEP << "SGUID";
+			}
+		}
+		else {
+			if constexpr (std::same_as<T, vccli::DeviceInfo>) {
+				os
+					<< colors(COLOR::HEADER)
+					<< "Device Name (DNAME)" << indent(COLSZ_DNAME - 19)
+					<< "I/O" << indent(COLSZ_IO - 3)
+					<< "Default";
+				;
+				if (extended) os << indent(COLSZ_DEFAULT - 7) << "Device ID (DGUID)";
+			}
+			else if constexpr (std::same_as<T, vccli::ProcessInfo>) {
+				os
+					<< colors(COLOR::HEADER)
+					<< "PID" << indent(COLSZ_PID - 3)
+					<< "Process Name (PNAME)" << indent(COLSZ_PNAME - 20)
+					<< "Device Name (DNAME)" << indent(COLSZ_DNAME - 19)
+					<< "I/O" << indent(COLSZ_IO - 3)
+					<< "Default";
+				if (extended) os << indent(COLSZ_DEFAULT - 7)
+					<< "Device ID (DGUID)" << indent(COLSZ_DGUID - 17)
+					<< "Session ID" << SEP
+					<< "Instance ID";
+				os << colors();
+			}
+		}
+		os << "\n\n";
+	}
+
+	template<std::derived_from<vccli::basic_info> T>
+	struct InfoLister {
+		std::vector<T> vec;
+
+		InfoLister(std::vector<T>&& vec) : vec{ std::forward<std::vector<T>>(vec) } {}
+
+		friend std::ostream& operator<<(std::ostream& os, const InfoLister<T>& p)
+		{
+			printListHeader<T>(os);
+
+			for (const auto& obj : p.vec)
+				os << obj << '\n';
+
+			return os;
+		}
+	};
+}
+
+template<std::derived_from<vccli::basic_info> T>
+vccli_operators::InfoLister<T> make_printable_list(std::vector<T>&& vec)
+{
+	return vccli_operators::InfoLister<T>{ std::forward<std::vector<T>>(vec) };
+}
+
+/// @brief	Writes a record for each session in the snapshot with the given data flow (& that matches the filter, if there is one), in enumeration order.
+///\n		Sessions whose process name can't be resolved are skipped, like every other session list.
+inline void writeSessionRecords(vccli::RecordWriter& writer, const vccli::AudioSnapshot& snapshot, const EDataFlow flow, const vccli::Filter* filter = nullptr)
+{
+	using vccli::Field;
+	for (const auto& device : snapshot.getDevices()) {
+		if (flow != EDataFlow::eAll && device.flow() != flow)
+			continue;
+		const auto& flow_s{ vccli::DataFlowToString(device.flow()) };
+		for (size_t i{ device.sessionsBegin }; i < device.sessionsEnd; ++i) {
+			const auto& session{ snapshot.getSessions()[i] };
+			if (filter && !vccli::FilterRow{ device, &session }.matches(*filter))
+				continue;
+			if (!session.pname().has_value())
+				continue;
+			writer.begin()
+				.field(Field::TYPENAME, "Session")
+				.field(Field::PID, static_cast<uint32_t>(session.pid()))
+				.field(Field::PNAME, session.pname().value_or(""))
+				.field(Field::DNAME, device.name())
+				.field(Field::IO, flow_s)
+				.field(Field::IS_DEFAULT, device.isDefault())
+				.field(Field::DGUID, device.id())
+				.field(Field::SUID, session.suid())
+				.field(Field::SGUID, session.sguid())
+				.end();
+		}
+	}
+}
+/// @brief	Writes a record for each device in the snapshot with the given data flow (& that matches the filter, if there is one), in enumeration order.
+inline void writeDeviceRecords(vccli::RecordWriter& writer, const vccli::AudioSnapshot& snapshot, const EDataFlow flow, const vccli::Filter* filter = nullptr)
+{
+	using vccli::Field;
+	for (const auto& device : snapshot.getDevices()) {
+		if (flow != EDataFlow::eAll && device.flow() != flow)
+			continue;
+		if (filter && !vccli::FilterRow{ device }.matches(*filter))
+			continue;
+		writer.begin()
+			.field(Field::TYPENAME, "Device")
+			.null(Field::PID)
+			.null(Field::PNAME)
+			.field(Field::DNAME, device.name())
+			.field(Field::IO, vccli::DataFlowToString(device.flow()))
+			.field(Field::IS_DEFAULT, device.isDefault())
+			.field(Field::DGUID, device.id())
+			.null(Field::SUID)
+			.null(Field::SGUID)
+			.end();
+	}
+}
+
+TEST_CASE("writeSessionRecords")
+{
+	vccli::SimulatedBackend backend;
+	auto& speakers{ backend.addDevice("Speakers", EDataFlow::eRender) };
+	backend.addSession(speakers, 100, "chrome");
+	backend.addSession(speakers, 200, "unnamed");
+	backend.addSession(speakers, 300, "discord");
+	backend.removeProcess(200);
+
+	std::stringstream ss;
+	{
+		vccli::RecordWriter writer{ ss, vccli::OutputFormat::NDJSON };
+		const vccli::AudioSnapshot snapshot{ backend };
+		writeSessionRecords(writer, snapshot, EDataFlow::eAll);
+	}
+	const auto& out{ ss.str() };
+	CHECK(std::count(out.begin(), out.end(), '\n') == 2);
+	CHECK(out.find("\"PID\":200") == std::string::npos);
+	CHECK(out.find("\"PNAME\":\"\"") == std::string::npos);
+}
+/// @brief	Writes a record for the given session.
+inline void writeRecord(vccli::RecordWriter& writer, const vccli::ProcessInfo& session)
+{
+	using vccli::Field;
+	writer.begin()
+		.field(Field::TYPENAME, "Session")
+		.field(Field::PID, static_cast<uint32_t>(session.pid))
+		.field(Field::PNAME, session.pname)
+		.field(Field::DNAME, session.dname)
+		.field(Field::IO, vccli::DataFlowToString(session.flow))
+		.field(Field::IS_DEFAULT, session.isDefault)
+		.field(Field::DGUID, session.dguid)
+		.field(Field::SUID, session.suid)
+		.field(Field::SGUID, session.sguid)
+		.end();
+}
+/// @brief	Writes a record for the given device.
+inline void writeRecord(vccli::RecordWriter& writer, const vccli::DeviceInfo& device)
+{
+	using vccli::Field;
+	writer.begin()
+		.field(Field::TYPENAME, "Device")
+		.null(Field::PID)
+		.null(Field::PNAME)
+		.field(Field::DNAME, device.dname)
+		.field(Field::IO, vccli::DataFlowToString(device.flow))
+		.field(Field::IS_DEFAULT, device.isDefault)
+		.field(Field::DGUID, device.dguid)
+		.null(Field::SUID)
+		.null(Field::SGUID)
+		.end();
+}
+/// @brief	Writes a record for each of the given sessions, in order.
+inline void writeSessionRecords(vccli::RecordWriter& writer, const std::vector<vccli::ProcessInfo>& sessions)
+{
+	for (const auto& session : sessions)
+		writeRecord(writer, session);
+}
+/// @brief	Writes a record for each of the given devices, in order.
+inline void writeDeviceRecords(vccli::RecordWriter& writer, const std::vector<vccli::DeviceInfo>& devices)
+{
+	for (const auto& device : devices)
+		writeRecord(writer, device);
+}
+/**
+ * @brief			Writes a record for each session with the given data flow (& that matches the filter, if there is one) as soon as
+ *					 it's enumerated from the backend.  (See AudioAPI::StreamAudioProcesses)
+ *\n				The first record is written right away; the rest are written whenever the writer's buffer fills up.
+ */
+inline void streamSessionRecords(vccli::RecordWriter& writer, vccli::AudioBackend& backend, const EDataFlow flow, const vccli::Filter* filter = nullptr)
+{
+	bool first{ true };
+	vccli::AudioAPI::StreamAudioProcesses(backend, flow, true, filter, [&](const vccli::ProcessInfo& session) {
+		writeRecord(writer, session);
+		if (std::exchange(first, false))
+			writer.flush();
+	});
+}
+/// @brief	Writes a record for each device with the given data flow (& that matches the filter, if there is one) as soon as it's enumerated from the backend.
+inline void streamDeviceRecords(vccli::RecordWriter& writer, vccli::AudioBackend& backend, const EDataFlow flow, const vccli::Filter* filter = nullptr)
+{
+	bool first{ true };
+	vccli::AudioAPI::StreamAudioDevices(backend, flow, filter, [&](const vccli::DeviceInfo& device) {
+		writeRecord(writer, device);
+		if (std::exchange(first, false))
+			writer.flush();
+	});
+}
+/**
+ * @brief			Prints the session list as it's enumerated from the backend, in enumeration order, instead of building & sorting
+ *					 the whole list first.  (See AudioAPI::StreamAudioProcesses)
+ *\n				The header & the first row are written right away; the rest go through a BufferedOutput, so they're written
+ *					 in large blocks.
+ */
+inline void streamSessionList(std::ostream& os, vccli::AudioBackend& backend, const EDataFlow flow, const vccli::Filter* filter = nullptr)
+{
+	using namespace vccli_operators;
+	vccli::BufferedOutput buffer{ os };
+	std::ostream out{ &buffer };
+	printListHeader<vccli::ProcessInfo>(out);
+	bool first{ true };
+	vccli::AudioAPI::StreamAudioProcesses(backend, flow, extended, filter, [&](const vccli::ProcessInfo& session) {
+		out << session << '\n';
+		if (std::exchange(first, false))
+			out.flush();
+	});
+}
+/// @brief	Prints the device list as it's enumerated from the backend, in enumeration order.  (See streamSessionList)
+inline void streamDeviceList(std::ostream& os, vccli::AudioBackend& backend, const EDataFlow flow, const vccli::Filter* filter = nullptr)
+{
+	using namespace vccli_operators;
+	vccli::BufferedOutput buffer{ os };
+	std::ostream out{ &buffer };
+	printListHeader<vccli::DeviceInfo>(out);
+	bool first{ true };
+	vccli::AudioAPI::StreamAudioDevices(backend, flow, filter, [&](const vccli::DeviceInfo& device) {
+		out << device << '\n';
+		if (std::exchange(first, false))
+			out.flush();
+	});
+}
+/// @brief	Writes a record with the current state of the given volume object.
+///\n		Sessions & devices have the same fields; the device name & default state of a session aren't known here, so they're null.
+inline void writeRecord(vccli::RecordWriter& writer, const vccli::Volume* obj)
+{
+	using vccli::Field;
+	writer.begin().field(Field::TYPENAME, obj->type_name().value_or("null"));
+	const auto* app{ dynamic_cast<const vccli::ApplicationVolume*>(obj) };
+	const auto* dev{ dynamic_cast<const vccli::EndpointVolume*>(obj) };
+	if (app)
+		writer.field(Field::PID, static_cast<uint32_t>(str::stoul(app->identifier))).field(Field::PNAME, app->resolved_name).null(Field::DNAME);
+	else writer.null(Field::PID).null(Field::PNAME).field(Field::DNAME, obj->resolved_name);
+	writer.field(Field::IO, obj->getFlowTypeName());
+	if (dev)
+		writer.field(Field::IS_DEFAULT, dev->isDefault);
+	else writer.null(Field::IS_DEFAULT);
+	writer
+		.field(Field::VOLUME, obj->getVolumeScaled())
+		.field(Field::IS_MUTED, obj->getMuted())
+		.field(Field::DGUID, app ? std::string_view{ app->dev_id } : std::string_view{ obj->identifier });
+	if (app)
+		writer.field(Field::SUID, app->sessionIdentifier).field(Field::SGUID, app->sessionInstanceIdentifier);
+	else writer.null(Field::SUID).null(Field::SGUID);
+	writer.end();
+}
+/// @brief	Writes a record for the given watch event.
+inline void writeRecord(vccli::RecordWriter& writer, const vccli::WatchRecord& r)
+{
+	using vccli::Field;
+	writer.begin()
+		.field(Field::EVENT, vccli::WatchRecord::getEventName(r.event))
+		.field(Field::TYPENAME, r.isSession ? "Session" : "Device");
+	if (r.isSession) {
+		writer
+			.field(Field::PID, static_cast<uint32_t>(r.pid))
+			.field(Field::PNAME, r.pname);
+	}
+	else writer.null(Field::PID).null(Field::PNAME);
+	writer
+		.field(Field::DNAME, r.dname)
+		.field(Field::IO, vccli::DataFlowToString(r.flow))
+		.field(Field::IS_DEFAULT, r.isDefault)
+		.field(Field::VOLUME, r.level * 100.0f)
+		.field(Field::IS_MUTED, r.muted)
+		.field(Field::DGUID, r.dguid);
+	if (r.isSession) {
+		writer
+			.field(Field::SUID, r.suid)
+			.field(Field::SGUID, r.sguid);
+	}
+	else writer.null(Field::SUID).null(Field::SGUID);
+	writer.end();
+}
@@ -0,0 +1,156 @@
+#pragma once
+#include "util.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+namespace vccli {
+	/**
+	 * @interface	ProcessTableSource
+	 * @brief		Provides the names of running processes to a ProcessNameResolver.
+	 */
+	struct ProcessTableSource {
+		using process_table_t = std::vector<std::pair<DWORD, std::string>>;
+
+		virtual ~ProcessTableSource() = default;
+
+		/**
+		 * @brief		Takes a snapshot of all running processes.
+		 * @returns		A list of process IDs & their extensionless process names.
+		 */
+		virtual process_table_t getProcessTable() = 0;
+		/**
+		 * @brief		Gets the extensionless name of a single process. This is used for processes that weren't in the process table.
+		 * @param pid	The process ID to look up.
+		 * @returns		The process name when the process exists & can be queried; otherwise std::nullopt.
+		 */
+		virtual std::optional<std::string> getProcessName(DWORD pid) = 0;
+	};
+
+	/**
+	 * @class	ProcessNameResolver
+	 * @brief	Resolves process IDs to process names using one process table snapshot.
+	 *\n		The process table is taken from the source the first time that a name is resolved; processes that aren't in the
+	 *			 table (because they started after it was taken) are looked up individually & the result is cached.
+	 */
+	class ProcessNameResolver {
+		ProcessTableSource& source;
+		std::mutex mutex;
+		bool loaded{ false };
+		std::unordered_map<DWORD, std::optional<std::string>> names;
+
+	public:
+		ProcessNameResolver(ProcessTableSource& source) : source{ source } {}
+		ProcessNameResolver(ProcessNameResolver const&) = delete;
+
+		/**
+		 * @brief		Gets the extensionless name of the process with the given process ID.
+		 * @param pid	The process ID to look up.
+		 * @returns		The process name when the process exists & can be queried; otherwise std::nullopt.
+		 */
+		std::optional<std::string> resolve(const DWORD pid)
+		{
+			$trace("ProcessNameResolver::resolve");
+			{
+				std::scoped_lock lock(mutex);
+
+				if (!loaded) {
+					auto table{ source.getProcessTable() };
+					names.reserve(table.size());
+					for (auto& [tpid, tname] : table)
+						names.emplace(tpid, std::move(tname));
+					loaded = true;
+				}
+
+				if (const auto& it{ names.find(pid) }; it != names.end())
+					return it->second;
+			}
+			// this opens the process, so it isn't done under the lock; otherwise threads resolving different PIDs would wait for each other
+			auto name{ source.getProcessName(pid) };
+			std::scoped_lock lock(mutex);
+			return names.emplace(pid, std::move(name)).first->second;
+		}
+	};
+
+	/**
+	 * @brief			Removes the extension from a file name, without converting it to & from the ANSI code page like std::filesystem::path does.
+	 *\n				Names that start with their only '.' are returned as-is.
+	 * @param filename	A file name without any directories.
+	 * @returns			The file name up to its last '.'.
+	 */
+	inline std::string_view removeExtension(const std::string_view filename)
+	{
+		if (const auto pos{ filename.rfind('.') }; pos != std::string_view::npos && pos != 0)
+			return filename.substr(0, pos);
+		return filename;
+	}
+
+	TEST_CASE("ProcessNameResolver")
+	{
+		CHECK(removeExtension("chrome.exe") == "chrome");
+		CHECK(removeExtension("my.app.exe") == "my.app");
+		CHECK(removeExtension("chrome") == "chrome");
+		CHECK(removeExtension(".hidden") == ".hidden");
+
+		// processes that aren't in the table are looked up without holding the lock, so lookups of different PIDs can overlap
+		struct BlockingSource : ProcessTableSource {
+			std::mutex mutex;
+			std::condition_variable cv;
+			size_t inside{ 0 }, maxInside{ 0 };
+
+			process_table_t getProcessTable() override { return{ { 1, "explorer" } }; }
+			std::optional<std::string> getProcessName(DWORD pid) override
+			{
+				std::unique_lock lock(mutex);
+				maxInside = std::max(maxInside, ++inside);
+				cv.notify_all();
+				cv.wait_for(lock, std::chrono::seconds{ 5 }, [this] { return inside == 2; });
+				--inside;
+				return "process" + std::to_string(pid);
+			}
+		} source;
+		ProcessNameResolver resolver{ source };
+		CHECK(resolver.resolve(1) == "explorer");
+
+		std::thread other{ [&resolver] { CHECK(resolver.resolve(3) == "process3"); } };
+		CHECK(resolver.resolve(2) == "process2");
+		other.join();
+		CHECK(source.maxInside == 2);
+	}
+
+#ifdef OS_WIN
+	/**
+	 * @brief		Takes a snapshot of all running processes with the Toolhelp32 API.
+	 *\n			The idle process (PID 0) is omitted, since it can't be opened with GetProcessNameFrom either.
+	 * @returns		A list of process IDs & their extensionless process names.
+	 */
+	inline ProcessTableSource::process_table_t GetProcessTable()
+	{
+		$trace("GetProcessTable");
+		ProcessTableSource::process_table_t table;
+
+		const HANDLE snapshotHandle{ CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0) };
+		if (snapshotHandle == INVALID_HANDLE_VALUE) {
+			const auto hr{ GetLastError() };
+			throw make_exception("CreateToolhelp32Snapshot failed:  ", GetErrorMessageFrom(hr), " (code: ", hr, ')');
+		}
+		const KernelHandle hSnapshot{ snapshotHandle };
+
+		PROCESSENTRY32W entry{};
+		entry.dwSize = sizeof(entry);
+
+		if (Process32FirstW(hSnapshot.get(), &entry)) {
+			do {
+				if (entry.th32ProcessID == 0)
+					continue;
+				table.emplace_back(entry.th32ProcessID, removeExtension(utf::toUtf8(entry.szExeFile)));
+			} while (Process32NextW(hSnapshot.get(), &entry));
+		}
+		return table;
+	}
+#endif
+}
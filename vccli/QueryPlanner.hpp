@@ -0,0 +1,275 @@
+#pragma once
+#include "AudioBackend.hpp"
+#include "AudioSnapshot.hpp"
+#include "SimulatedBackend.hpp"
+
+#include <cstdint>
+
+namespace vccli {
+	/**
+	 * @class	QueryPlan
+	 * @brief	Picks the cheapest way to resolve a TARGET, based on what kind of identifier it is.
+	 *\n		Names (& every fuzzy search) have to be matched against everything, so they're resolved through an AudioSnapshot.
+	 *			 Other kinds of target only need a small part of the system:
+	 *\n		- DGUIDs are looked up directly with AudioBackend::getDevice.
+	 *\n		- SUIDs & SGUIDs begin with the ID of the device that owns the session, so only that device's sessions are scanned,
+	 *			 & the scan stops at the first match.
+	 *\n		- PIDs can only select sessions, so the sessions on each device are compared by process ID without reading
+	 *			 any of their other properties.
+	 *\n		When a plan doesn't find anything the caller should fall back to AudioAPI::getObjects, since a target that
+	 *			 looks like an ID can still be a name.
+	 */
+	class QueryPlan {
+	public:
+		enum class TargetKind : uint8_t {
+			/// @brief	A blank target, which selects the default device.
+			Default,
+			/// @brief	A device ID.  (DGUID)
+			DeviceID,
+			/// @brief	A process ID.  (PID)
+			ProcessID,
+			/// @brief	A session identifier.  (SUID)
+			SessionID,
+			/// @brief	A session instance identifier.  (SGUID)
+			SessionInstanceID,
+			/// @brief	Anything else, such as a device or process name.  (DNAME, PNAME)
+			Name,
+		};
+		enum class Strategy : uint8_t {
+			/// @brief	Gets the default device from the backend.
+			DefaultDeviceLookup,
+			/// @brief	Gets one device by its ID from the backend.
+			DeviceLookup,
+			/// @brief	Gets one device by its ID from the backend, & scans its sessions until one matches.
+			DeviceSessionScan,
+			/// @brief	Scans the sessions on every device, comparing process IDs only.
+			SessionScan,
+			/// @brief	Captures (or reuses) an AudioSnapshot & searches its indexes.
+			Snapshot,
+		};
+
+		TargetKind kind;
+		Strategy strategy;
+		/// @brief	True when the target can't match more than one device or session, so resolution stops at the first match.
+		bool atMostOne;
+
+	private:
+		/// @brief	The trimmed target.
+		std::string target;
+		/// @brief	The ID of the device to look up, for the DeviceLookup & DeviceSessionScan strategies.
+		std::string deviceID;
+
+		/// @brief	Checks if the given string has the format of a Windows endpoint ID, such as "{0.0.0.00000000}.{GUID}".
+		static constexpr bool isDeviceID(const std::string_view s) noexcept
+		{
+			return s.size() == 55 && s.starts_with("{0.0.") && s[15] == '}' && s[16] == '.' && s[17] == '{' && s.back() == '}';
+		}
+
+		/// @brief	Activates a volume control object for a session found by a scan.
+		static std::unique_ptr<ApplicationVolume> activate(AudioBackend& backend, AudioSession const& session, const EDataFlow flow, std::string const& deviceID, std::string const& suid, std::string const& sguid)
+		{
+			return session.activateVolume(backend.getProcessName(session.getProcessId()).value_or(""), flow, deviceID, suid, sguid);
+		}
+
+	public:
+		/**
+		 * @brief			Determines what kind of identifier the given target is.
+		 * @param trimmed	A target with no leading or trailing whitespace.
+		 */
+		static TargetKind classify(const std::string_view trimmed) noexcept
+		{
+			if (trimmed.empty())
+				return TargetKind::Default;
+			else if (std::all_of(trimmed.begin(), trimmed.end(), str::stdpred::isdigit))
+				return TargetKind::ProcessID;
+			else if (const auto pipe{ trimmed.find('|') }; pipe != std::string_view::npos && isDeviceID(trimmed.substr(0, pipe))) // SGUIDs are the SUID followed by "|<instance>"
+				return (trimmed.find('|', pipe + 1) != std::string_view::npos ? TargetKind::SessionInstanceID : TargetKind::SessionID);
+			else if (isDeviceID(trimmed))
+				return TargetKind::DeviceID;
+			return TargetKind::Name;
+		}
+
+		/**
+		 * @brief			Classifies the given target & picks a strategy for it.
+		 * @param target	A DNAME, DGUID, PID, PNAME, SUID, or SGUID; or a blank string to select the default device.
+		 * @param fuzzy		When true, the target is always resolved through a snapshot, since fuzzy searches rank every name.
+		 */
+		QueryPlan(std::string const& target, const bool fuzzy) : target{ match::trimWhitespace(target) }
+		{
+			kind = classify(this->target);
+			if (kind == TargetKind::DeviceID || kind == TargetKind::SessionID || kind == TargetKind::SessionInstanceID)
+				deviceID = std::string_view{ this->target }.substr(0, this->target.find('|'));
+
+			atMostOne = false;
+			if (fuzzy && kind != TargetKind::Default)
+				strategy = Strategy::Snapshot;
+			else switch (kind) {
+			case TargetKind::Default:
+				strategy = Strategy::DefaultDeviceLookup;
+				atMostOne = true;
+				break;
+			case TargetKind::DeviceID:
+				strategy = Strategy::DeviceLookup;
+				atMostOne = true;
+				break;
+			case TargetKind::SessionID: //< only the first matching session on each device is selected, & SUIDs belong to one device
+			case TargetKind::SessionInstanceID:
+				strategy = Strategy::DeviceSessionScan;
+				atMostOne = true;
+				break;
+			case TargetKind::ProcessID:
+				strategy = Strategy::SessionScan;
+				break;
+			default:
+				strategy = Strategy::Snapshot;
+				break;
+			}
+		}
+
+		/// @brief	Checks if this plan needs an AudioSnapshot, in which case execute() doesn't do anything.
+		bool needsSnapshot() const noexcept { return strategy == Strategy::Snapshot; }
+
+		/**
+		 * @brief					Resolves the target by asking the backend for only what this plan needs.
+		 * @param backend			The backend to query.
+		 * @param deviceFlowFilter	Only devices (and sessions on devices) with this data flow are selected.
+		 * @param defaultDevIsOutput	When the target is blank & the flow filter is eAll, selects the default output device when true; otherwise the default input device.
+		 * @returns					The same volume objects as AudioAPI::getObjects, or an empty vector when nothing was found or the plan needs a snapshot.
+		 */
+		std::vector<std::unique_ptr<Volume>> execute(AudioBackend& backend, const EDataFlow deviceFlowFilter, const bool defaultDevIsOutput = true) const
+		{
+			$trace("QueryPlan::execute");
+			std::vector<std::unique_ptr<Volume>> objects;
+
+			const auto& isSelectable{ [&deviceFlowFilter](const EDataFlow flow) { return deviceFlowFilter == EDataFlow::eAll || flow == deviceFlowFilter; } };
+			const auto& isDefaultDevice{ [&backend](std::string const& id, const EDataFlow flow) {
+				const auto& defaultDev{ backend.getDefaultDevice(flow) };
+				return defaultDev && defaultDev->getID() == id;
+			} };
+
+			switch (strategy) {
+			case Strategy::DefaultDeviceLookup: {
+				EDataFlow flow{ deviceFlowFilter };
+				if (flow == EDataFlow::eAll) //< we can't request a default 'eAll' device; select input or output
+					flow = (defaultDevIsOutput ? EDataFlow::eRender : EDataFlow::eCapture);
+				if (const auto& dev{ backend.getDefaultDevice(flow) })
+					objects.emplace_back(dev->activateVolume(dev->getFriendlyName(), flow, true));
+				break;
+			}
+			case Strategy::DeviceLookup: {
+				if (const auto& dev{ backend.getDevice(deviceID) }) {
+					if (const auto flow{ dev->getDataFlow() }; isSelectable(flow))
+						objects.emplace_back(dev->activateVolume(dev->getFriendlyName(), flow, isDefaultDevice(dev->getID(), flow)));
+				}
+				break;
+			}
+			case Strategy::DeviceSessionScan: {
+				const auto& dev{ backend.getDevice(deviceID) };
+				if (!dev)
+					break;
+				const auto flow{ dev->getDataFlow() };
+				if (!isSelectable(flow))
+					break;
+
+				const auto& folded{ match::fold(target) };
+				for (const auto& session : dev->getSessions()) {
+					if (kind == TargetKind::SessionInstanceID) {
+						if (const auto& sguid{ session->getSessionInstanceIdentifier() }; match::equalsFolded(match::trimWhitespace(sguid), folded)) {
+							objects.emplace_back(activate(backend, *session, flow, dev->getID(), session->getSessionIdentifier(), sguid));
+							break;
+						}
+					}
+					else if (const auto& suid{ session->getSessionIdentifier() }; match::equalsFolded(match::trimWhitespace(suid), folded)) {
+						objects.emplace_back(activate(backend, *session, flow, dev->getID(), suid, session->getSessionInstanceIdentifier()));
+						break;
+					}
+				}
+				break;
+			}
+			case Strategy::SessionScan: {
+				const DWORD pid{ static_cast<DWORD>(str::stoul(target)) };
+				for (const auto& dev : backend.getDevices(deviceFlowFilter)) {
+					for (const auto& session : dev->getSessions()) {
+						if (session->getProcessId() != pid)
+							continue;
+						// only the first matching session on each device is selected
+						objects.emplace_back(activate(backend, *session, deviceFlowFilter == EDataFlow::eAll ? dev->getDataFlow() : deviceFlowFilter, dev->getID(), session->getSessionIdentifier(), session->getSessionInstanceIdentifier()));
+						break;
+					}
+				}
+				break;
+			}
+			default:
+				break;
+			}
+
+			return objects;
+		}
+
+		/// @brief	Gets the name of the given target kind, as it's written in the usage text.
+		static constexpr std::string_view toString(const TargetKind kind) noexcept
+		{
+			switch (kind) {
+			case TargetKind::Default: return "Blank";
+			case TargetKind::DeviceID: return "DGUID";
+			case TargetKind::ProcessID: return "PID";
+			case TargetKind::SessionID: return "SUID";
+			case TargetKind::SessionInstanceID: return "SGUID";
+			default: return "DNAME/PNAME";
+			}
+		}
+		/// @brief	Gets a short description of the given strategy.
+		static constexpr std::string_view toString(const Strategy strategy) noexcept
+		{
+			switch (strategy) {
+			case Strategy::DefaultDeviceLookup: return "default device lookup";
+			case Strategy::DeviceLookup: return "direct device lookup by ID";
+			case Strategy::DeviceSessionScan: return "session scan of one device";
+			case Strategy::SessionScan: return "session-only scan by PID";
+			default: return "snapshot index lookup";
+			}
+		}
+	};
+
+	TEST_CASE("QueryPlan")
+	{
+		auto sim{ std::make_shared<SimulatedBackend>() };
+		auto& speakers{ sim->addDevice("Speakers", EDataFlow::eRender) };
+		auto& headphones{ sim->addDevice("Headphones", EDataFlow::eRender) };
+		auto& mic{ sim->addDevice("Microphone", EDataFlow::eCapture) };
+		sim->addSession(speakers, 100, "chrome");
+		const auto& discord{ sim->addSession(speakers, 200, "Discord") };
+		sim->addSession(headphones, 200, "Discord");
+		sim->addSession(mic, 200, "Discord");
+
+		CHECK(QueryPlan{ "", false }.strategy == QueryPlan::Strategy::DefaultDeviceLookup);
+		CHECK(QueryPlan{ "chrome", false }.strategy == QueryPlan::Strategy::Snapshot);
+		CHECK(QueryPlan{ "200", true }.strategy == QueryPlan::Strategy::Snapshot);
+		CHECK(QueryPlan{ speakers.id, false }.kind == QueryPlan::TargetKind::DeviceID);
+		CHECK(QueryPlan{ discord.suid, false }.kind == QueryPlan::TargetKind::SessionID);
+		CHECK(QueryPlan{ ' ' + discord.sguid + ' ', false }.kind == QueryPlan::TargetKind::SessionInstanceID);
+		CHECK(QueryPlan{ "{0.0.0.00000000}", false }.kind == QueryPlan::TargetKind::Name);
+
+		const auto& device{ QueryPlan{ headphones.id, false }.execute(*sim, EDataFlow::eAll) };
+		REQUIRE(device.size() == 1);
+		CHECK(device.front()->resolved_name == "Headphones");
+		CHECK(QueryPlan{ headphones.id, false }.execute(*sim, EDataFlow::eCapture).empty());
+
+		CHECK(QueryPlan{ "200", false }.execute(*sim, EDataFlow::eAll).size() == 3);
+		CHECK(QueryPlan{ "200", false }.execute(*sim, EDataFlow::eRender).size() == 2);
+		CHECK(QueryPlan{ "100", false }.execute(*sim, EDataFlow::eCapture).empty());
+
+		sim->resetCallCount();
+		const auto& session{ QueryPlan{ discord.sguid, false }.execute(*sim, EDataFlow::eAll) };
+		REQUIRE(session.size() == 1);
+		CHECK(session.front()->resolved_name == "Discord");
+		CHECK(static_cast<ApplicationVolume const*>(session.front().get())->sessionInstanceIdentifier == discord.sguid);
+
+		// The same target takes many more calls to resolve through a snapshot
+		const auto callsByPlan{ sim->getCallCount() };
+		sim->resetCallCount();
+		const AudioSnapshot snapshot{ *sim };
+		REQUIRE(snapshot.findSessionBySGUID(discord.sguid) != nullptr);
+		CHECK(callsByPlan < sim->getCallCount());
+	}
+}
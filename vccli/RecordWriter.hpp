@@ -0,0 +1,364 @@
+#pragma once
+#include "util.hpp"
+
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <streambuf>
+#include <string_view>
+#include <vector>
+
+namespace vccli {
+	/**
+	 * @enum	OutputFormat
+	 * @brief	The format of the output written by list, query & watch commands.
+	 */
+	enum class OutputFormat : uint8_t {
+		/// @brief	Human-readable text; or semicolon-separated text when '--quiet' is specified.
+		Text,
+		/// @brief	One JSON object per line.
+		NDJSON,
+		/// @brief	Length-prefixed binary records.  See RecordWriter for the layout.
+		Binary,
+	};
+
+	/**
+	 * @brief		Parses the name of an output format.
+	 * @param s		"text", "ndjson", or "binary". (case-insensitive)
+	 * @returns		The OutputFormat with the given name.
+	 */
+	inline OutputFormat ParseOutputFormat(std::string const& s)
+	{
+		const auto& lower{ str::tolower(s) };
+		if (lower == "text")
+			return OutputFormat::Text;
+		else if (lower == "ndjson")
+			return OutputFormat::NDJSON;
+		else if (lower == "binary")
+			return OutputFormat::Binary;
+		throw make_exception("Invalid output format '", s, "'!  Expected 'text', 'ndjson', or 'binary'.");
+	}
+
+	/**
+	 * @enum	Field
+	 * @brief	The fields that can appear in a record.  The underlying values are the field IDs used by the binary format,
+	 *			 so existing values must never change; new fields are added to the end.
+	 */
+	enum class Field : uint8_t {
+		EVENT,
+		TYPENAME,
+		PID,
+		PNAME,
+		DNAME,
+		DGUID,
+		SUID,
+		SGUID,
+		IO,
+		IS_DEFAULT,
+		VOLUME,
+		IS_MUTED,
+		/// @brief	A target string given on the commandline, such as one that didn't match anything.
+		TARGET,
+	};
+
+	/// @brief	Gets the name of the given field, which is the same as its column name in the quiet output format.
+	inline constexpr std::string_view getFieldName(const Field field)
+	{
+		switch (field) {
+		case Field::EVENT: return "EVENT";
+		case Field::TYPENAME: return "TYPENAME";
+		case Field::PID: return "PID";
+		case Field::PNAME: return "PNAME";
+		case Field::DNAME: return "DNAME";
+		case Field::DGUID: return "DGUID";
+		case Field::SUID: return "SUID";
+		case Field::SGUID: return "SGUID";
+		case Field::IO: return "I/O";
+		case Field::IS_DEFAULT: return "IS_DEFAULT";
+		case Field::VOLUME: return "VOLUME";
+		case Field::IS_MUTED: return "IS_MUTED";
+		case Field::TARGET: return "TARGET";
+		default: return "";
+		}
+	}
+
+	/**
+	 * @class	RecordWriter
+	 * @brief	Writes records in a machine-readable OutputFormat through one reusable buffer.
+	 *\n		Records are appended to the buffer as they are produced, and the buffer is written to the stream with a
+	 *			 single write once it reaches the flush threshold (or when flush() is called), so rows stream out
+	 *			 without the whole list being built first.
+	 *\n
+	 *\n		Every record of the same kind (list rows, query results, or watch events) has the same fields in the same order,
+	 *			 whether it describes a session or a device; fields that don't apply to a record are written as null.
+	 *\n		NDJSON records are one JSON object per line, with the field names as keys.  Volumes that aren't finite are null.
+	 *\n		Binary records are laid out as follows, with all integers in little-endian byte order:
+	 *\n		 - u32 payload size, followed by that many bytes of fields.  Each field is:
+	 *\n		   - u8 field ID (see Field)
+	 *\n		   - u8 type:  0 = string (u32 length + UTF-8 bytes), 1 = u32, 2 = f32 (IEEE 754), 3 = bool (u8), 4 = null (no value)
+	 *\n		   - the value
+	 */
+	class RecordWriter {
+		enum class Type : uint8_t {
+			String,
+			UInt32,
+			Float32,
+			Bool,
+			Null,
+		};
+
+		std::ostream& os;
+		OutputFormat format;
+		size_t flushThreshold;
+		std::string buffer;
+		/// @brief	The buffer offset of the current record.
+		size_t recordBegin{ 0 };
+		bool firstField{ true };
+
+		template<std::integral T>
+		void appendLE(const T value)
+		{
+			using U = std::make_unsigned_t<T>;
+			auto u{ static_cast<U>(value) };
+			for (size_t i{ 0 }; i < sizeof(T); ++i, u >>= 8)
+				buffer.push_back(static_cast<char>(u & 0xFF));
+		}
+		void appendJSONString(std::string_view s)
+		{
+			static constexpr char hex[]{ "0123456789abcdef" };
+			buffer.push_back('"');
+			for (const char c : s) {
+				switch (c) {
+				case '"': buffer.append("\\\""); break;
+				case '\\': buffer.append("\\\\"); break;
+				case '\n': buffer.append("\\n"); break;
+				case '\r': buffer.append("\\r"); break;
+				case '\t': buffer.append("\\t"); break;
+				default:
+					if (static_cast<unsigned char>(c) < 0x20) {
+						buffer.append("\\u00");
+						buffer.push_back(hex[(c >> 4) & 0xF]);
+						buffer.push_back(hex[c & 0xF]);
+					}
+					else buffer.push_back(c);
+					break;
+				}
+			}
+			buffer.push_back('"');
+		}
+		/// @brief	Appends the field header; for NDJSON this is the key, for binary it's the field ID & type.
+		void beginField(const Field field, const Type type)
+		{
+			if (format == OutputFormat::NDJSON) {
+				if (firstField) firstField = false;
+				else buffer.push_back(',');
+				buffer.push_back('"');
+				buffer.append(getFieldName(field));
+				buffer.append("\":");
+			}
+			else {
+				buffer.push_back(static_cast<char>(field));
+				buffer.push_back(static_cast<char>(type));
+			}
+		}
+
+	public:
+		/// @brief	The default number of buffered bytes that triggers a write.
+		static constexpr size_t DEFAULT_FLUSH_THRESHOLD{ 64 * 1024 };
+
+		/**
+		 * @brief					Creates a new RecordWriter.
+		 * @param os				The stream to write records to.  This should be in binary mode when format is Binary.
+		 * @param format			The format to write; NDJSON or Binary.
+		 * @param flushThreshold	The number of buffered bytes that triggers a write.  0 writes each record immediately.
+		 */
+		RecordWriter(std::ostream& os, const OutputFormat format, const size_t flushThreshold = DEFAULT_FLUSH_THRESHOLD) : os{ os }, format{ format }, flushThreshold{ flushThreshold }
+		{
+			if (format == OutputFormat::Text)
+				throw make_exception("RecordWriter doesn't support the text output format!");
+			buffer.reserve(flushThreshold + 512);
+		}
+		RecordWriter(RecordWriter const&) = delete;
+		~RecordWriter()
+		{
+			flush();
+		}
+
+		/// @brief	Starts a new record.
+		RecordWriter& begin()
+		{
+			recordBegin = buffer.size();
+			firstField = true;
+			if (format == OutputFormat::NDJSON)
+				buffer.push_back('{');
+			else appendLE<uint32_t>(0); //< placeholder for the payload size
+			return *this;
+		}
+		/// @brief	Finishes the current record, & writes the buffer if it reached the flush threshold.
+		RecordWriter& end()
+		{
+			if (format == OutputFormat::NDJSON)
+				buffer.append("}\n");
+			else {
+				const auto size{ static_cast<uint32_t>(buffer.size() - recordBegin - sizeof(uint32_t)) };
+				for (size_t i{ 0 }; i < sizeof(uint32_t); ++i)
+					buffer[recordBegin + i] = static_cast<char>((size >> (8 * i)) & 0xFF);
+			}
+			if (buffer.size() >= flushThreshold)
+				flush();
+			return *this;
+		}
+
+		RecordWriter& field(const Field field, std::string_view value)
+		{
+			beginField(field, Type::String);
+			if (format == OutputFormat::NDJSON)
+				appendJSONString(value);
+			else {
+				appendLE(static_cast<uint32_t>(value.size()));
+				buffer.append(value);
+			}
+			return *this;
+		}
+		RecordWriter& field(const Field field, const char* value) { return this->field(field, std::string_view{ value }); }
+		RecordWriter& field(const Field field, const uint32_t value)
+		{
+			beginField(field, Type::UInt32);
+			if (format == OutputFormat::NDJSON)
+				buffer.append(std::to_string(value));
+			else appendLE(value);
+			return *this;
+		}
+		RecordWriter& field(const Field field, const float value)
+		{
+			beginField(field, Type::Float32);
+			if (format == OutputFormat::NDJSON) {
+				if (!std::isfinite(value)) { //< JSON doesn't have NaN or infinity
+					buffer.append("null");
+					return *this;
+				}
+				char buf[32];
+				const int len{ std::snprintf(buf, sizeof(buf), "%.9g", value) };
+				buffer.append(buf, static_cast<size_t>(len));
+			}
+			else appendLE(std::bit_cast<uint32_t>(value));
+			return *this;
+		}
+		RecordWriter& field(const Field field, const bool value)
+		{
+			beginField(field, Type::Bool);
+			if (format == OutputFormat::NDJSON)
+				buffer.append(value ? "true" : "false");
+			else buffer.push_back(value ? 1 : 0);
+			return *this;
+		}
+		/// @brief	Writes a field that doesn't have a value for this record.
+		RecordWriter& null(const Field field)
+		{
+			beginField(field, Type::Null);
+			if (format == OutputFormat::NDJSON)
+				buffer.append("null");
+			return *this;
+		}
+
+		/// @brief	Writes all of the buffered records to the stream with a single write.
+		void flush()
+		{
+			if (!buffer.empty()) {
+				os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+				buffer.clear();
+			}
+			os.flush();
+		}
+	};
+
+	/**
+	 * @class	BufferedOutput
+	 * @brief	Stream buffer that collects text in one reusable buffer & writes it to another stream with a single write once the
+	 *			 buffer is full (or when it's flushed), which is what RecordWriter does for records.  Use it through a std::ostream:
+	 *\n		  BufferedOutput buffer{ std::cout };
+	 *\n		  std::ostream os{ &buffer };
+	 *\n		Flushing the std::ostream also flushes the stream that the buffer writes to.
+	 */
+	class BufferedOutput : public std::streambuf {
+		std::ostream& os;
+		std::vector<char> buffer;
+
+	protected:
+		int_type overflow(const int_type ch) override
+		{
+			if (sync() != 0)
+				return traits_type::eof();
+			if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+				*pptr() = traits_type::to_char_type(ch);
+				pbump(1);
+			}
+			return traits_type::not_eof(ch);
+		}
+		int sync() override
+		{
+			if (const auto size{ pptr() - pbase() }; size > 0) {
+				os.write(pbase(), size);
+				setp(buffer.data(), buffer.data() + buffer.size());
+			}
+			os.flush();
+			return os ? 0 : -1;
+		}
+
+	public:
+		/**
+		 * @brief				Creates a new BufferedOutput.
+		 * @param os			The stream to write to.
+		 * @param capacity		The number of buffered bytes that triggers a write.
+		 */
+		BufferedOutput(std::ostream& os, const size_t capacity = RecordWriter::DEFAULT_FLUSH_THRESHOLD) : os{ os }, buffer(capacity == 0 ? 1 : capacity)
+		{
+			setp(buffer.data(), buffer.data() + buffer.size());
+		}
+		BufferedOutput(BufferedOutput const&) = delete;
+		~BufferedOutput()
+		{
+			sync();
+		}
+	};
+
+	TEST_CASE("RecordWriter")
+	{
+		std::stringstream ss;
+		{
+			RecordWriter w{ ss, OutputFormat::NDJSON };
+			w.begin().field(Field::PID, 1000u).field(Field::PNAME, "a\"b").field(Field::IS_MUTED, true).field(Field::VOLUME, 0.5f).end();
+		}
+		CHECK(ss.str() == "{\"PID\":1000,\"PNAME\":\"a\\\"b\",\"IS_MUTED\":true,\"VOLUME\":0.5}\n");
+
+		ss.str({});
+		{
+			RecordWriter w{ ss, OutputFormat::NDJSON };
+			w.begin().null(Field::PID).field(Field::VOLUME, std::nanf("")).field(Field::VOLUME, -INFINITY).end();
+		}
+		CHECK(ss.str() == "{\"PID\":null,\"VOLUME\":null,\"VOLUME\":null}\n");
+
+		ss.str({});
+		{
+			RecordWriter w{ ss, OutputFormat::Binary };
+			w.begin().field(Field::PID, 1u).field(Field::PNAME, "ab").null(Field::SUID).end();
+		}
+		CHECK(ss.str() == std::string{ "\x10\0\0\0" "\x02\x01\x01\0\0\0" "\x03\0\x02\0\0\0ab" "\x06\x04", 20 });
+
+		ss.str({});
+		{
+			BufferedOutput buffer{ ss, 8 };
+			std::ostream os{ &buffer };
+			os << "abc" << 123;
+			CHECK(ss.str().empty());
+			os << "defgh";
+			CHECK(ss.str() == "abc123de");
+			os << std::flush;
+			CHECK(ss.str() == "abc123defgh");
+			os << "ij";
+		}
+		CHECK(ss.str() == "abc123defghij");
+	}
+}
@@ -0,0 +1,209 @@
+#pragma once
+#include "util.hpp"
+#include "AudioBackend.hpp"
+#include "ProcessNameResolver.hpp"
+#include "SimulatedBackend.hpp"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace vccli {
+	/**
+	 * @class	SessionStream
+	 * @brief	Walks the devices & sessions of a backend one device at a time, without capturing an AudioSnapshot.
+	 *\n		Each device's sessions are enumerated when the walk reaches it, passed to the callback one at a time, & released
+	 *			 before the next device is enumerated; so the first row is available after one device's enumeration, & only
+	 *			 one device's sessions are held at once no matter how many there are in total.
+	 *\n		Like the records of an AudioSnapshot, each property is fetched from the backend the first time that it's read.
+	 *			 Unlike them, the strings are only valid until the callback returns.
+	 *\n		The backend must outlive the stream.
+	 */
+	class SessionStream {
+		AudioBackend& backend;
+		ProcessNameResolver processNames;
+		std::optional<std::pair<std::string, std::string>> defaultIDs;
+
+		/// @brief	Gets the IDs of the default output & input devices, fetching them on the first call.
+		std::pair<std::string, std::string> const& getDefaultIDs()
+		{
+			if (!defaultIDs.has_value()) {
+				$trace("SessionStream::getDefaultIDs");
+				const auto& render{ backend.getDefaultDevice(EDataFlow::eRender) }, & capture{ backend.getDefaultDevice(EDataFlow::eCapture) };
+				defaultIDs.emplace(render ? render->getID() : std::string{}, capture ? capture->getID() : std::string{});
+			}
+			return defaultIDs.value();
+		}
+
+		/// @brief	Calls the given callback, & returns false when it returned false to stop the walk.
+		template<typename F, typename... Ts>
+		static bool invoke(F& f, Ts const&... args)
+		{
+			if constexpr (std::same_as<std::invoke_result_t<F&, Ts const&...>, bool>)
+				return f(args...);
+			else {
+				f(args...);
+				return true;
+			}
+		}
+
+	public:
+		/**
+		 * @class	DeviceRow
+		 * @brief	The device that the walk is currently on.  This has the same accessors as AudioSnapshot::DeviceRecord.
+		 */
+		class DeviceRow {
+			friend class SessionStream;
+
+			SessionStream* stream;
+			mutable std::optional<std::string> id_, name_;
+			mutable std::optional<EDataFlow> flow_;
+
+			DeviceRow(SessionStream& stream, std::unique_ptr<AudioDevice>&& handle, const std::optional<EDataFlow> flow) : stream{ &stream }, flow_{ flow }, handle{ std::move(handle) } {}
+
+		public:
+			std::unique_ptr<AudioDevice> handle;
+
+			/// @brief	Gets the device ID.  (DGUID)
+			std::string_view id() const
+			{
+				if (!id_.has_value())
+					id_ = handle->getID();
+				return id_.value();
+			}
+			/// @brief	Gets the friendly name of the device.  (DNAME)
+			std::string_view name() const
+			{
+				if (!name_.has_value())
+					name_ = handle->getFriendlyName();
+				return name_.value();
+			}
+			/// @brief	Gets the data flow of the device.
+			EDataFlow flow() const
+			{
+				if (!flow_.has_value())
+					flow_ = handle->getDataFlow();
+				return flow_.value();
+			}
+			/// @brief	Checks if this is the default input or output device.
+			bool isDefault() const
+			{
+				const auto& [renderID, captureID] { stream->getDefaultIDs() };
+				const auto& deviceID{ id() };
+				return !deviceID.empty() && (deviceID == renderID || deviceID == captureID);
+			}
+		};
+		/**
+		 * @class	SessionRow
+		 * @brief	The session that the walk is currently on.  This has the same accessors as AudioSnapshot::SessionRecord.
+		 */
+		class SessionRow {
+			friend class SessionStream;
+
+			SessionStream* stream;
+			mutable std::optional<DWORD> pid_;
+			mutable std::optional<std::optional<std::string>> pname_;
+			mutable std::optional<std::string> suid_, sguid_;
+
+			SessionRow(SessionStream& stream, std::unique_ptr<AudioSession>&& handle) : stream{ &stream }, handle{ std::move(handle) } {}
+
+		public:
+			std::unique_ptr<AudioSession> handle;
+
+			/// @brief	Gets the ID of the process that owns this session.  (PID)
+			DWORD pid() const
+			{
+				if (!pid_.has_value())
+					pid_ = handle->getProcessId();
+				return pid_.value();
+			}
+			/// @brief	Gets the name of the process that owns this session, if it could be resolved.  (PNAME)
+			std::optional<std::string_view> pname() const
+			{
+				if (!pname_.has_value())
+					pname_ = stream->processNames.resolve(pid());
+				if (!pname_->has_value())
+					return std::nullopt;
+				return pname_->value();
+			}
+			/// @brief	Gets the session identifier.  (SUID)
+			std::string_view suid() const
+			{
+				if (!suid_.has_value())
+					suid_ = handle->getSessionIdentifier();
+				return suid_.value();
+			}
+			/// @brief	Gets the session instance identifier.  (SGUID)
+			std::string_view sguid() const
+			{
+				if (!sguid_.has_value())
+					sguid_ = handle->getSessionInstanceIdentifier();
+				return sguid_.value();
+			}
+		};
+
+		/// @param backend	The backend to enumerate.  This must outlive the stream.
+		SessionStream(AudioBackend& backend) : backend{ backend }, processNames{ backend } {}
+		SessionStream(SessionStream const&) = delete;
+
+		/**
+		 * @brief		Calls the given function for each device with the given data flow, in enumeration order.
+		 * @param flow	Only devices with this data flow are visited.  The backend filters them, so they aren't enumerated.
+		 * @param f		A function that accepts a DeviceRow.  When it returns a bool, returning false stops the walk.
+		 */
+		template<std::invocable<DeviceRow const&> F>
+		void forEachDevice(const EDataFlow flow, F&& f)
+		{
+			$trace("SessionStream::forEachDevice");
+			for (auto& handle : backend.getDevices(flow)) {
+				const DeviceRow dev{ *this, std::move(handle), flow == EDataFlow::eAll ? std::nullopt : std::optional<EDataFlow>{ flow } };
+				if (!invoke(f, dev))
+					return;
+			}
+		}
+		/**
+		 * @brief		Calls the given function for each session on a device with the given data flow, in enumeration order.
+		 *\n			The sessions of each device are enumerated when the walk reaches that device.
+		 * @param flow	Only sessions on devices with this data flow are visited.
+		 * @param f		A function that accepts a DeviceRow & a SessionRow.  When it returns a bool, returning false stops the walk.
+		 */
+		template<std::invocable<DeviceRow const&, SessionRow const&> F>
+		void forEachSession(const EDataFlow flow, F&& f)
+		{
+			$trace("SessionStream::forEachSession");
+			forEachDevice(flow, [&](DeviceRow const& dev) {
+				for (auto& handle : dev.handle->getSessions()) {
+					const SessionRow session{ *this, std::move(handle) };
+					if (!invoke(f, dev, session))
+						return false;
+				}
+				return true;
+			});
+		}
+	};
+
+	TEST_CASE("SessionStream")
+	{
+		const auto& sim{ SimulatedBackend::generate(4, 25) };
+		SessionStream stream{ *sim };
+
+		// the walk stops as soon as the callback returns false, before the other devices are enumerated
+		sim->resetCallCount();
+		std::string firstName;
+		stream.forEachSession(EDataFlow::eAll, [&](auto&& dev, auto&& session) {
+			firstName = std::string{ session.pname().value_or("") };
+			return dev.name().empty();
+		});
+		CHECK(!firstName.empty());
+		// devices, the first device's sessions, its name & the session's PID; plus the process table
+		CHECK(sim->getCallCount() == 5);
+
+		size_t sessionCount{ 0 }, deviceCount{ 0 };
+		stream.forEachSession(EDataFlow::eAll, [&](auto&&, auto&&) { ++sessionCount; });
+		stream.forEachDevice(EDataFlow::eRender, [&](auto&& dev) { deviceCount += dev.flow() == EDataFlow::eRender; });
+		CHECK(sessionCount == 100);
+		CHECK(deviceCount == sim->getDevices(EDataFlow::eRender).size());
+	}
+}
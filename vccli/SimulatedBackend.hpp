@@ -0,0 +1,498 @@
+#pragma once
+#include "AudioBackend.hpp"
+#include "ComHandle.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace vccli {
+	/**
+	 * @class	SimulatedBackend
+	 * @brief	In-memory AudioBackend implementation that models an arbitrary number of devices & sessions.
+	 *\n		Every call made through the backend interface (including calls made on the objects it returns)
+	 *			 is counted & can be delayed by a configurable latency to approximate a real system.
+	 *\n		Every object it returns holds a reference-counted stand-in for the COM interface that the CoreAudioBackend
+	 *			 equivalent would hold, so leaks show up in getLiveObjectCount.
+	 *\n		This is used to test, profile & benchmark vccli on machines without the Windows Core Audio API.
+	 */
+	class SimulatedBackend : public AudioBackend {
+	public:
+		struct Session {
+			DWORD pid;
+			std::string pname, suid, sguid;
+			std::atomic<float> level{ 1.0f };
+			std::atomic<bool> muted{ false };
+			/// @brief	Set when the session is removed; volume objects that were activated for it report that it expired.
+			std::atomic<bool> expired{ false };
+
+			Session(const DWORD pid, std::string const& pname, std::string const& suid, std::string const& sguid) : pid{ pid }, pname{ pname }, suid{ suid }, sguid{ sguid } {}
+		};
+		struct Device {
+			std::string id, name;
+			EDataFlow flow;
+			std::atomic<float> level{ 1.0f };
+			std::atomic<bool> muted{ false };
+			std::vector<std::shared_ptr<Session>> sessions;
+
+			Device(std::string const& id, std::string const& name, const EDataFlow flow) : id{ id }, name{ name }, flow{ flow } {}
+		};
+
+	private:
+		struct State {
+			mutable std::mutex mutex;
+			std::vector<std::shared_ptr<Device>> devices;
+			std::string defaultRenderID, defaultCaptureID;
+			std::unordered_map<DWORD, std::string> processes;
+			std::atomic<std::chrono::nanoseconds::rep> latency;
+			std::atomic<size_t> callCount{ 0ull };
+			std::atomic<size_t> liveObjects{ 0ull };
+			size_t idCounter{ 0ull };
+
+			/// @brief	Held while notifications are being delivered, so unsubscribing waits for in-flight notifications.
+			std::recursive_mutex eventMutex;
+			/// @brief	Device or Session pointer -> subscribed sinks & their keys
+			std::unordered_multimap<const void*, std::pair<AudioEventSink*, std::string>> subscribers;
+
+			State(const std::chrono::nanoseconds latency) : latency{ latency.count() } {}
+
+			/// @brief	Calls the given function for each sink that is subscribed to the given object.
+			template<std::invocable<AudioEventSink&, std::string const&> F>
+			void notify(const void* source, F&& func)
+			{
+				std::scoped_lock lock(eventMutex);
+				const auto& [begin, end] { subscribers.equal_range(source) };
+				for (auto it{ begin }; it != end; ++it)
+					func(*it->second.first, it->second.second);
+			}
+
+			/**
+			 * @brief		Counts a backend call & blocks for the configured latency.
+			 * @param name	The name of the trace span that covers the call.  This must be a string literal.
+			 */
+			void simulateCall(const char* name)
+			{
+				$trace(name);
+				++callCount;
+				if (const auto ns{ latency.load(std::memory_order_relaxed) }; ns > 0)
+					std::this_thread::sleep_for(std::chrono::nanoseconds{ ns });
+			}
+		};
+
+		std::shared_ptr<State> state;
+
+		/**
+		 * @struct	SimulatedInterface
+		 * @brief	Reference-counted stand-in for a COM interface, which is counted in State::liveObjects until it is released.
+		 */
+		struct SimulatedInterface {
+			State& state;
+			std::atomic<unsigned long> refCount{ 1 };
+
+			SimulatedInterface(State& state) : state{ state } { ++state.liveObjects; }
+			~SimulatedInterface() { --state.liveObjects; }
+
+			unsigned long AddRef() { return ++refCount; }
+			unsigned long Release()
+			{
+				const unsigned long count{ --refCount };
+				if (count == 0)
+					delete this;
+				return count;
+			}
+		};
+		using interface_ptr = ComPtr<SimulatedInterface>;
+
+		struct SimulatedSubscription : AudioEventSubscription {
+			std::shared_ptr<State> state;
+			interface_ptr handle;
+			const void* source;
+			AudioEventSink* sink;
+
+			SimulatedSubscription(std::shared_ptr<State> const& state, SimulatedInterface* handle, const void* source, AudioEventSink& sink, std::string const& key) : state{ state }, handle{ interface_ptr::share(handle) }, source{ source }, sink{ &sink }
+			{
+				std::scoped_lock lock(state->eventMutex);
+				state->subscribers.emplace(source, std::make_pair(this->sink, key));
+			}
+			~SimulatedSubscription()
+			{
+				std::scoped_lock lock(state->eventMutex);
+				const auto& [begin, end] { state->subscribers.equal_range(source) };
+				for (auto it{ begin }; it != end; ++it) {
+					if (it->second.first == sink) {
+						state->subscribers.erase(it);
+						break;
+					}
+				}
+			}
+		};
+
+		struct SimulatedApplicationVolume : ApplicationVolume {
+			std::shared_ptr<State> state;
+			interface_ptr handle;
+			std::shared_ptr<Session> session;
+
+			SimulatedApplicationVolume(std::shared_ptr<State> const& state, interface_ptr&& handle, std::shared_ptr<Session> const& session, std::string const& resolved_name, const EDataFlow flow_type, std::string const& deviceID, std::string const& suid, std::string const& sguid) : ApplicationVolume(resolved_name, session->pid, flow_type, deviceID, suid, sguid), state{ state }, handle{ std::move(handle) }, session{ session } {}
+
+			bool getMuted() const override
+			{
+				state->simulateCall("SimulatedApplicationVolume::getMuted");
+				return session->muted.load();
+			}
+			void setMuted(const bool isMuted) const override
+			{
+				state->simulateCall("SimulatedApplicationVolume::setMuted");
+				session->muted.store(isMuted);
+				notifyVolumeChanged(*state, *session);
+			}
+			float getVolume() const override
+			{
+				state->simulateCall("SimulatedApplicationVolume::getVolume");
+				return session->level.load();
+			}
+			void setVolume(const float& level) const override
+			{
+				state->simulateCall("SimulatedApplicationVolume::setVolume");
+				session->level.store(level);
+				notifyVolumeChanged(*state, *session);
+			}
+			bool isExpired() const override
+			{
+				state->simulateCall("SimulatedApplicationVolume::isExpired");
+				return session->expired.load();
+			}
+		};
+		struct SimulatedEndpointVolume : EndpointVolume {
+			std::shared_ptr<State> state;
+			interface_ptr handle;
+			std::shared_ptr<Device> device;
+
+			SimulatedEndpointVolume(std::shared_ptr<State> const& state, interface_ptr&& handle, std::shared_ptr<Device> const& device, std::string const& resolved_name, const EDataFlow flow_type, const bool isDefault) : EndpointVolume(resolved_name, device->id, flow_type, isDefault), state{ state }, handle{ std::move(handle) }, device{ device } {}
+
+			bool getMuted() const override
+			{
+				state->simulateCall("SimulatedEndpointVolume::getMuted");
+				return device->muted.load();
+			}
+			void setMuted(const bool isMuted) const override
+			{
+				state->simulateCall("SimulatedEndpointVolume::setMuted");
+				device->muted.store(isMuted);
+				notifyVolumeChanged(*state, *device);
+			}
+			float getVolume() const override
+			{
+				state->simulateCall("SimulatedEndpointVolume::getVolume");
+				return device->level.load();
+			}
+			void setVolume(const float& level) const override
+			{
+				state->simulateCall("SimulatedEndpointVolume::setVolume");
+				device->level.store(level);
+				notifyVolumeChanged(*state, *device);
+			}
+		};
+
+		struct SimulatedSession : AudioSession {
+			std::shared_ptr<State> state;
+			interface_ptr handle;
+			std::shared_ptr<Session> session;
+
+			SimulatedSession(std::shared_ptr<State> const& state, std::shared_ptr<Session> const& session) : state{ state }, handle{ new SimulatedInterface(*state) }, session{ session } {}
+
+			DWORD getProcessId() const override
+			{
+				state->simulateCall("SimulatedSession::getProcessId");
+				return session->pid;
+			}
+			std::string getSessionIdentifier() const override
+			{
+				state->simulateCall("SimulatedSession::getSessionIdentifier");
+				return session->suid;
+			}
+			std::string getSessionInstanceIdentifier() const override
+			{
+				state->simulateCall("SimulatedSession::getSessionInstanceIdentifier");
+				return session->sguid;
+			}
+			std::unique_ptr<ApplicationVolume> activateVolume(std::string const& resolved_name, EDataFlow flow, std::string const& deviceID, std::string const& suid, std::string const& sguid) const override
+			{
+				state->simulateCall("SimulatedSession::activateVolume");
+				// like QueryInterface, this returns a new reference to the same object
+				return std::make_unique<SimulatedApplicationVolume>(state, interface_ptr::share(handle.get()), session, resolved_name, flow, deviceID, suid, sguid);
+			}
+			std::unique_ptr<AudioEventSubscription> subscribe(AudioEventSink& sink, std::string const& key) const override
+			{
+				state->simulateCall("SimulatedSession::subscribe");
+				return std::make_unique<SimulatedSubscription>(state, handle.get(), session.get(), sink, key);
+			}
+		};
+		struct SimulatedDevice : AudioDevice {
+			std::shared_ptr<State> state;
+			interface_ptr handle;
+			std::shared_ptr<Device> device;
+
+			SimulatedDevice(std::shared_ptr<State> const& state, std::shared_ptr<Device> const& device) : state{ state }, handle{ new SimulatedInterface(*state) }, device{ device } {}
+
+			std::string getID() const override
+			{
+				state->simulateCall("SimulatedDevice::getID");
+				return device->id;
+			}
+			std::string getFriendlyName() const override
+			{
+				state->simulateCall("SimulatedDevice::getFriendlyName");
+				return device->name;
+			}
+			EDataFlow getDataFlow() const override
+			{
+				state->simulateCall("SimulatedDevice::getDataFlow");
+				return device->flow;
+			}
+			std::vector<std::unique_ptr<AudioSession>> getSessions() const override
+			{
+				state->simulateCall("SimulatedDevice::getSessions");
+				std::vector<std::unique_ptr<AudioSession>> vec;
+				std::scoped_lock lock(state->mutex);
+				vec.reserve(device->sessions.size());
+				for (const auto& session : device->sessions)
+					vec.emplace_back(std::make_unique<SimulatedSession>(state, session));
+				return vec;
+			}
+			std::unique_ptr<EndpointVolume> activateVolume(std::string const& resolved_name, EDataFlow flow, const bool isDefault) const override
+			{
+				state->simulateCall("SimulatedDevice::activateVolume");
+				// like IMMDevice::Activate, this returns a new object
+				return std::make_unique<SimulatedEndpointVolume>(state, interface_ptr{ new SimulatedInterface(*state) }, device, resolved_name, flow, isDefault);
+			}
+			std::unique_ptr<AudioEventSubscription> subscribe(AudioEventSink& sink, std::string const& key) const override
+			{
+				state->simulateCall("SimulatedDevice::subscribe");
+				return std::make_unique<SimulatedSubscription>(state, handle.get(), device.get(), sink, key);
+			}
+		};
+
+		/// @brief	Notifies the sinks subscribed to the given device or session of its current volume & mute state.
+		template<typename T> requires std::same_as<T, Device> || std::same_as<T, Session>
+		static void notifyVolumeChanged(State& state, T const& target)
+		{
+			state.notify(&target, [&target](AudioEventSink& sink, std::string const& key) {
+				sink.onVolumeChanged(key, target.level.load(), target.muted.load());
+			});
+		}
+
+		/// @brief	Generates a deterministic, unique GUID string in the same format that Windows uses.
+		std::string makeGUID()
+		{
+			// splitmix64
+			auto next{ [this]() -> uint64_t {
+				uint64_t z{ (++state->idCounter) * 0x9E3779B97F4A7C15ull };
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+				return z ^ (z >> 31);
+			} };
+			const uint64_t hi{ next() }, lo{ next() };
+			char buf[40];
+			std::snprintf(buf, sizeof(buf), "{%08x-%04x-%04x-%04x-%012llx}",
+				static_cast<unsigned>(hi >> 32), static_cast<unsigned>((hi >> 16) & 0xFFFF), static_cast<unsigned>(hi & 0xFFFF),
+				static_cast<unsigned>(lo >> 48), static_cast<unsigned long long>(lo & 0xFFFFFFFFFFFFull));
+			return{ buf };
+		}
+
+	public:
+		/**
+		 * @brief			Creates a new, empty SimulatedBackend instance.
+		 * @param latency	The amount of time that each backend call blocks for.
+		 */
+		SimulatedBackend(const std::chrono::nanoseconds latency = {}) : state{ std::make_shared<State>(latency) } {}
+
+		/**
+		 * @brief				Creates a new SimulatedBackend with a synthetic topology.
+		 *\n					Every third device is an input device, the rest are output devices. Every device has the same set of
+		 *						 processes playing audio on it, which is what a real system with many virtual endpoints looks like.
+		 * @param deviceCount	The number of devices to create.
+		 * @param sessionCount	The number of sessions to create on each device.
+		 * @param latency		The amount of time that each backend call blocks for.
+		 */
+		static std::shared_ptr<SimulatedBackend> generate(const size_t deviceCount, const size_t sessionCount, const std::chrono::nanoseconds latency = {})
+		{
+			static constexpr std::array<const char*, 16> processNames{
+				"chrome", "firefox", "Discord", "Spotify", "Teams", "obs64", "vlc", "steam",
+				"msedge", "Zoom", "slack", "explorer", "foobar2000", "Telegram", "mpv", "WINWORD",
+			};
+
+			auto backend{ std::make_shared<SimulatedBackend>() };
+			for (size_t i{ 0 }; i < deviceCount; ++i) {
+				const bool isInput{ i % 3 == 2 };
+				auto& dev{ backend->addDevice((isInput ? "Microphone (Simulated Audio Device " : "Speakers (Simulated Audio Device ") + std::to_string(i) + ')', isInput ? EDataFlow::eCapture : EDataFlow::eRender) };
+				for (size_t j{ 0 }; j < sessionCount; ++j) {
+					std::string pname{ processNames[j % processNames.size()] };
+					if (j >= processNames.size())
+						pname += std::to_string(j / processNames.size());
+					backend->addSession(dev, static_cast<DWORD>(1000 + j * 4), pname);
+				}
+			}
+			backend->setLatency(latency);
+			return backend;
+		}
+
+		/**
+		 * @brief			Adds a new device to the simulated system.
+		 *\n				The first device added for each data flow becomes the default device for that data flow.
+		 * @param name		The friendly name of the device.
+		 * @param flow		The data flow of the device; eRender or eCapture.
+		 * @returns			A reference to the new device.
+		 */
+		Device& addDevice(std::string const& name, const EDataFlow flow)
+		{
+			std::scoped_lock lock(state->mutex);
+			const auto& dev{ state->devices.emplace_back(std::make_shared<Device>(std::string{ flow == EDataFlow::eCapture ? "{0.0.1.00000000}." : "{0.0.0.00000000}." } + makeGUID(), name, flow)) };
+			auto& defaultID{ flow == EDataFlow::eCapture ? state->defaultCaptureID : state->defaultRenderID };
+			if (defaultID.empty())
+				defaultID = dev->id;
+			return *dev;
+		}
+		/**
+		 * @brief			Adds a new audio session to the given device.
+		 * @param device	A device that was returned by addDevice.
+		 * @param pid		The process ID of the session's owner process.
+		 * @param pname		The name of the session's owner process.
+		 * @returns			A reference to the new session.
+		 */
+		Session& addSession(Device& device, const DWORD pid, std::string const& pname)
+		{
+			std::shared_ptr<Session> session;
+			{
+				std::scoped_lock lock(state->mutex);
+				std::string suid{ device.id + "|\\Device\\HarddiskVolume3\\Program Files\\" + pname + '\\' + pname + ".exe%b{00000000-0000-0000-0000-000000000000}" };
+				std::string sguid{ suid + "|1%b" + std::to_string(pid) };
+				state->processes.insert_or_assign(pid, pname);
+				session = device.sessions.emplace_back(std::make_shared<Session>(pid, pname, suid, sguid));
+			}
+			state->notify(&device, [this, &session](AudioEventSink& sink, std::string const& key) {
+				sink.onSessionCreated(key, std::make_unique<SimulatedSession>(state, session));
+			});
+			return *session;
+		}
+		/**
+		 * @brief			Removes an audio session from the given device, as if its owner process stopped playing audio.
+		 * @param device	The device that owns the session.
+		 * @param session	A session that was returned by addSession.
+		 */
+		void removeSession(Device& device, Session const& session)
+		{
+			std::shared_ptr<Session> removed;
+			{
+				std::scoped_lock lock(state->mutex);
+				if (const auto& it{ std::find_if(device.sessions.begin(), device.sessions.end(), [&session](auto&& s) { return s.get() == &session; }) }; it != device.sessions.end()) {
+					removed = *it;
+					device.sessions.erase(it);
+				}
+			}
+			if (removed) {
+				removed->expired.store(true);
+				state->notify(removed.get(), [](AudioEventSink& sink, std::string const& key) {
+					sink.onSessionExpired(key);
+				});
+			}
+		}
+		/**
+		 * @brief			Changes the volume & mute state of a device or session from outside of vccli, such as from the volume mixer.
+		 * @param target	A device or session that was returned by addDevice or addSession.
+		 * @param level		The new volume level, in the range 0.0 - 1.0.
+		 * @param muted		The new mute state.
+		 */
+		template<typename T> requires std::same_as<T, Device> || std::same_as<T, Session>
+		void setVolume(T& target, const float level, const bool muted)
+		{
+			target.level.store(level);
+			target.muted.store(muted);
+			notifyVolumeChanged(*state, target);
+		}
+		/**
+		 * @brief			Adds a process that doesn't have an audio session to the simulated process table.
+		 * @param pid		The process ID of the process.
+		 * @param pname		The name of the process.
+		 */
+		void addProcess(const DWORD pid, std::string const& pname)
+		{
+			std::scoped_lock lock(state->mutex);
+			state->processes.insert_or_assign(pid, pname);
+		}
+		/**
+		 * @brief			Removes a process from the simulated process table, so its name can't be resolved, as if it exited or couldn't be opened.
+		 * @param pid		The process ID of the process.
+		 */
+		void removeProcess(const DWORD pid)
+		{
+			std::scoped_lock lock(state->mutex);
+			state->processes.erase(pid);
+		}
+		/**
+		 * @brief			Changes the default device for the given device's data flow.
+		 * @param device	A device that was returned by addDevice.
+		 */
+		void setDefaultDevice(Device const& device)
+		{
+			std::scoped_lock lock(state->mutex);
+			(device.flow == EDataFlow::eCapture ? state->defaultCaptureID : state->defaultRenderID) = device.id;
+		}
+
+		/// @brief	Sets the amount of time that each backend call blocks for.
+		void setLatency(const std::chrono::nanoseconds latency) { state->latency.store(latency.count()); }
+		/// @brief	Gets the number of backend calls that were made since the last call to resetCallCount.
+		size_t getCallCount() const override { return state->callCount.load(); }
+		/// @brief	Resets the backend call counter to 0.
+		void resetCallCount() { state->callCount.store(0ull); }
+		/// @brief	Gets the number of objects returned by the backend (including sessions, volumes & subscriptions) that haven't been released yet.
+		size_t getLiveObjectCount() const { return state->liveObjects.load(); }
+
+		std::vector<std::unique_ptr<AudioDevice>> getDevices(EDataFlow flow) override
+		{
+			state->simulateCall("SimulatedBackend::getDevices");
+			std::vector<std::unique_ptr<AudioDevice>> vec;
+			std::scoped_lock lock(state->mutex);
+			vec.reserve(state->devices.size());
+			for (const auto& dev : state->devices)
+				if (flow == EDataFlow::eAll || dev->flow == flow)
+					vec.emplace_back(std::make_unique<SimulatedDevice>(state, dev));
+			return vec;
+		}
+		std::unique_ptr<AudioDevice> getDefaultDevice(EDataFlow flow) override
+		{
+			std::string defaultID;
+			{
+				std::scoped_lock lock(state->mutex);
+				defaultID = (flow == EDataFlow::eCapture ? state->defaultCaptureID : state->defaultRenderID);
+			}
+			return getDevice(defaultID);
+		}
+		std::unique_ptr<AudioDevice> getDevice(std::string const& deviceID) override
+		{
+			state->simulateCall("SimulatedBackend::getDevice");
+			std::scoped_lock lock(state->mutex);
+			for (const auto& dev : state->devices)
+				if (dev->id == deviceID)
+					return std::make_unique<SimulatedDevice>(state, dev);
+			return nullptr;
+		}
+		process_table_t getProcessTable() override
+		{
+			state->simulateCall("SimulatedBackend::getProcessTable");
+			std::scoped_lock lock(state->mutex);
+			return{ state->processes.begin(), state->processes.end() };
+		}
+		std::optional<std::string> getProcessName(DWORD pid) override
+		{
+			state->simulateCall("SimulatedBackend::getProcessName");
+			std::scoped_lock lock(state->mutex);
+			if (const auto& it{ state->processes.find(pid) }; it != state->processes.end())
+				return it->second;
+			return std::nullopt;
+		}
+	};
+}
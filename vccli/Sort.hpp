@@ -0,0 +1,258 @@
+#pragma once
+#include "util.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace vccli {
+	/**
+	 * @enum	SortField
+	 * @brief	The columns that a list can be sorted by.
+	 */
+	enum class SortField : uint8_t {
+		/// @brief	The process ID of a session.  Devices don't have one, so they all sort as 0.
+		PID,
+		/// @brief	The process name of a session, or the name of a device.  (case-insensitive)
+		NAME,
+		/// @brief	The name of the device.  (case-insensitive)
+		DEVICE,
+		/// @brief	The data flow of the device; output before input.
+		IO,
+		/// @brief	Whether the device is a default device; non-default before default.
+		DEFAULT,
+		/// @brief	The current volume level.  This activates a volume object for each row, so it's slower than the other fields.
+		VOLUME,
+		/// @brief	The current mute state; unmuted before muted.  Activates a volume object for each row, like VOLUME.
+		MUTED,
+	};
+
+	/// @brief	Checks whether the given field is sorted by a string rather than by a number.
+	inline constexpr bool isTextField(const SortField field) noexcept
+	{
+		return field == SortField::NAME || field == SortField::DEVICE;
+	}
+	/// @brief	Checks whether the given field requires activating a volume object.
+	inline constexpr bool isVolumeField(const SortField field) noexcept
+	{
+		return field == SortField::VOLUME || field == SortField::MUTED;
+	}
+
+	/**
+	 * @struct	SortKey
+	 * @brief	One column of a sort order, & its direction.
+	 */
+	struct SortKey {
+		SortField field;
+		bool descending{ false };
+
+		constexpr bool operator==(SortKey const&) const = default;
+	};
+
+	/**
+	 * @brief		Parses a comma-separated list of sort keys.
+	 *\n			Each key is one of 'pid', 'name' (or 'pname'), 'device' (or 'dname'), 'io', 'default', 'volume', or 'muted',
+	 *			 optionally prefixed with '-' to sort in descending order or '+' to sort in ascending order.  (case-insensitive)
+	 * @param s		The sort keys, e.g. "pid,-volume,name,device".
+	 * @returns		The sort keys, in order of precedence.
+	 */
+	inline std::vector<SortKey> ParseSortKeys(std::string const& s)
+	{
+		std::vector<SortKey> keys;
+		std::string_view rest{ s };
+		while (!rest.empty() || keys.empty()) {
+			const auto comma{ rest.find(',') };
+			std::string_view item{ match::trimWhitespace(rest.substr(0, comma)) };
+			rest = comma == std::string_view::npos ? std::string_view{} : rest.substr(comma + 1);
+
+			SortKey key{};
+			if (!item.empty() && (item.front() == '-' || item.front() == '+')) {
+				key.descending = item.front() == '-';
+				item.remove_prefix(1);
+			}
+
+			const auto& is{ [&item](const std::string_view name) { return match::equalsIgnoreCase(item, name); } };
+			if (is("pid"))
+				key.field = SortField::PID;
+			else if (is("name") || is("pname"))
+				key.field = SortField::NAME;
+			else if (is("device") || is("dname"))
+				key.field = SortField::DEVICE;
+			else if (is("io"))
+				key.field = SortField::IO;
+			else if (is("default"))
+				key.field = SortField::DEFAULT;
+			else if (is("volume"))
+				key.field = SortField::VOLUME;
+			else if (is("muted"))
+				key.field = SortField::MUTED;
+			else throw make_exception("Invalid sort key '", item, "'!  Expected 'pid', 'name', 'device', 'io', 'default', 'volume', or 'muted'.");
+
+			keys.emplace_back(key);
+		}
+		return keys;
+	}
+
+	/**
+	 * @class	RowSorter
+	 * @brief	Sorts the rows of a list by several keys at once.
+	 *\n		Each row's keys are converted once up front to a compact array of integers; strings are case-folded & replaced
+	 *			 with their rank among all of the strings in their column. Comparing two rows is then only a few integer
+	 *			 comparisons. The row indices are sorted, not the rows, & ties keep their original order.
+	 */
+	class RowSorter {
+		std::vector<SortKey> keys;
+		size_t rowCount{ 0 };
+		/// @brief	rowCount * keys.size() sort keys, row by row.  Text keys hold an index into `strings` until rankStrings is called.
+		std::vector<uint64_t> values;
+		std::vector<std::string_view> strings;
+
+		/// @brief	Replaces the string indices of the given text column with the dense rank of their case-folded strings.
+		void rankStrings(const size_t k)
+		{
+			// fold every string once, into one buffer
+			std::vector<size_t> offsets;
+			offsets.reserve(rowCount + 1);
+			std::string folded;
+			for (size_t row{ 0 }; row < rowCount; ++row) {
+				offsets.emplace_back(folded.size());
+				folded += strings[values[row * keys.size() + k]];
+			}
+			offsets.emplace_back(folded.size());
+			match::fold(folded, folded.data());
+
+			const auto& foldedAt{ [&](const size_t row) { return std::string_view{ folded }.substr(offsets[row], offsets[row + 1] - offsets[row]); } };
+
+			std::vector<uint32_t> order(rowCount);
+			std::iota(order.begin(), order.end(), 0u);
+			std::sort(order.begin(), order.end(), [&](const uint32_t l, const uint32_t r) { return foldedAt(l) < foldedAt(r); });
+
+			uint64_t rank{ 0 };
+			for (size_t i{ 0 }; i < order.size(); ++i) {
+				if (i != 0 && foldedAt(order[i]) != foldedAt(order[i - 1]))
+					++rank;
+				values[order[i] * keys.size() + k] = rank;
+			}
+		}
+
+	public:
+		/**
+		 * @brief			Creates a new RowSorter.
+		 * @param keys		The sort keys, in order of precedence.
+		 * @param capacity	The expected number of rows.
+		 */
+		RowSorter(std::vector<SortKey> keys, const size_t capacity = 0) : keys{ std::move(keys) }
+		{
+			values.reserve(capacity * this->keys.size());
+		}
+
+		/// @brief	Checks whether any of the sort keys require activating a volume object.
+		bool needsVolume() const noexcept
+		{
+			return std::any_of(keys.begin(), keys.end(), [](auto&& key) { return isVolumeField(key.field); });
+		}
+
+		/**
+		 * @brief			Adds a row.
+		 * @param number	Gets the value of a numeric field for the row.  Called once for each numeric sort key.
+		 * @param text		Gets the value of a text field for the row.  Called once for each text sort key.  The string must
+		 *					 outlive the RowSorter.
+		 */
+		template<std::invocable<SortField> FNumber, std::invocable<SortField> FText>
+		void addRow(FNumber&& number, FText&& text)
+		{
+			for (const auto& key : keys) {
+				if (isTextField(key.field)) {
+					values.emplace_back(strings.size());
+					strings.emplace_back(text(key.field));
+				}
+				else values.emplace_back(static_cast<uint64_t>(number(key.field)));
+			}
+			++rowCount;
+		}
+
+		/**
+		 * @brief		Sorts the rows that were added.
+		 * @returns		The indices of the rows, in sorted order.
+		 */
+		std::vector<uint32_t> sort()
+		{
+			const size_t keyCount{ keys.size() };
+			for (size_t k{ 0 }; k < keyCount; ++k)
+				if (isTextField(keys[k].field))
+					rankStrings(k);
+			// descending keys are inverted, so every column sorts in ascending order
+			for (size_t k{ 0 }; k < keyCount; ++k)
+				if (keys[k].descending)
+					for (size_t row{ 0 }; row < rowCount; ++row)
+						values[row * keyCount + k] = ~values[row * keyCount + k];
+
+			std::vector<uint32_t> order(rowCount);
+			std::iota(order.begin(), order.end(), 0u);
+			std::sort(order.begin(), order.end(), [this, keyCount](const uint32_t l, const uint32_t r) {
+				const uint64_t* lv{ values.data() + l * keyCount }, * rv{ values.data() + r * keyCount };
+				for (size_t k{ 0 }; k < keyCount; ++k)
+					if (lv[k] != rv[k])
+						return lv[k] < rv[k];
+				return l < r; //< the original order breaks ties, which makes the sort stable
+			});
+			return order;
+		}
+
+		/**
+		 * @brief		Sorts the given rows, which must be the rows that were added in the same order.
+		 * @param rows	The rows to sort.
+		 * @returns		The sorted rows.
+		 */
+		template<typename T>
+		std::vector<T> sort(std::vector<T>&& rows)
+		{
+			std::vector<T> sorted;
+			sorted.reserve(rows.size());
+			for (const auto& i : sort())
+				sorted.emplace_back(std::move(rows[i]));
+			return sorted;
+		}
+	};
+
+	/// @brief	Converts a volume level to a sort key that orders the same way.
+	inline uint64_t volumeSortKey(const float level) noexcept
+	{
+		// the bits of non-negative floats order the same way as their values
+		return std::bit_cast<uint32_t>(level > 0.0f ? level : 0.0f);
+	}
+
+	TEST_CASE("RowSorter")
+	{
+		CHECK(ParseSortKeys("pid,-Volume, name ,+device") == std::vector<SortKey>{ { SortField::PID }, { SortField::VOLUME, true }, { SortField::NAME }, { SortField::DEVICE } });
+		CHECK_THROWS(ParseSortKeys("pid,size"));
+		CHECK_THROWS(ParseSortKeys(""));
+
+		struct Row { uint64_t pid; std::string name; float level; };
+		std::vector<Row> rows{
+			{ 3, "discord", 0.5f },
+			{ 1, "Chrome", 1.0f },
+			{ 2, "chrome", 0.25f },
+			{ 1, "Discord", 0.5f },
+			{ 4, "chrome", 1.0f },
+		};
+		const auto& sortBy{ [&rows](std::string const& keys) {
+			RowSorter sorter{ ParseSortKeys(keys), rows.size() };
+			for (const auto& row : rows) {
+				sorter.addRow(
+					[&row](SortField field) { return field == SortField::PID ? row.pid : volumeSortKey(row.level); },
+					[&row](SortField) -> std::string_view { return row.name; });
+			}
+			return sorter.sort();
+		} };
+
+		// case-insensitive, & ties keep their original order
+		CHECK(sortBy("name") == std::vector<uint32_t>{ 1, 2, 4, 0, 3 });
+		CHECK(sortBy("-name") == std::vector<uint32_t>{ 0, 3, 1, 2, 4 });
+		CHECK(sortBy("-volume,pid") == std::vector<uint32_t>{ 1, 4, 3, 0, 2 });
+		CHECK(sortBy("name,-pid") == std::vector<uint32_t>{ 4, 2, 1, 0, 3 });
+	}
+}
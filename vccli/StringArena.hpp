@@ -0,0 +1,91 @@
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+namespace vccli {
+	/**
+	 * @class	StringArena
+	 * @brief	Interns strings into large blocks of memory that are only released when the arena is destroyed.
+	 *\n		Each distinct string is stored once, so records that share a value (i.e. every session on one device shares the
+	 *			 device's name & ID) hold views of the same bytes instead of their own copies, & a large enumeration makes a
+	 *			 handful of block allocations instead of thousands of small ones.
+	 *\n		Views returned by intern() stay valid until the arena is destroyed, even if the arena is moved.
+	 */
+	class StringArena {
+		/// @brief	The minimum size of each block.  Strings that are longer than this get a block of their own.
+		static constexpr size_t BLOCK_SIZE{ 16 * 1024 };
+
+		std::vector<std::unique_ptr<char[]>> blocks;
+		/// @brief	The unused part of the current block.
+		char* next{ nullptr };
+		size_t remaining{ 0 };
+		/// @brief	Every interned string, for deduplication.
+		std::unordered_set<std::string_view> interned;
+
+		char* allocate(const size_t size)
+		{
+			if (size > remaining) {
+				const auto blockSize{ std::max(size, BLOCK_SIZE) };
+				next = blocks.emplace_back(std::make_unique<char[]>(blockSize)).get();
+				remaining = blockSize;
+			}
+			char* p{ next };
+			next += size;
+			remaining -= size;
+			return p;
+		}
+
+	public:
+		StringArena() = default;
+		StringArena(StringArena const&) = delete;
+		StringArena(StringArena&&) noexcept = default;
+		StringArena& operator=(StringArena const&) = delete;
+		StringArena& operator=(StringArena&&) noexcept = default;
+
+		/**
+		 * @brief		Gets a view of an interned copy of the given string, copying it into the arena if it isn't there yet.
+		 * @param s		The string to intern.
+		 * @returns		A view of the interned string.  This stays valid for the lifetime of the arena.
+		 */
+		std::string_view intern(const std::string_view s)
+		{
+			if (s.empty())
+				return{};
+			if (const auto& it{ interned.find(s) }; it != interned.end())
+				return *it;
+			char* p{ allocate(s.size()) };
+			std::memcpy(p, s.data(), s.size());
+			return *interned.emplace(p, s.size()).first;
+		}
+
+		/// @brief	Gets the number of distinct strings in the arena.
+		size_t size() const { return interned.size(); }
+		/// @brief	Gets the number of blocks that the arena allocated.
+		size_t blockCount() const { return blocks.size(); }
+	};
+
+	TEST_CASE("StringArena")
+	{
+		StringArena arena;
+		const auto& a{ arena.intern("Speakers") };
+		const auto& b{ arena.intern(std::string{ "Speakers" }) };
+		CHECK(a == "Speakers");
+		CHECK(a.data() == b.data());
+		CHECK(arena.intern("").empty());
+		CHECK(arena.size() == 1);
+
+		// views survive new blocks & moves
+		const std::string big(20000, 'x');
+		CHECK(arena.intern(big) == big);
+		StringArena moved{ std::move(arena) };
+		CHECK(a == "Speakers");
+		CHECK(moved.intern("Speakers").data() == a.data());
+		CHECK(moved.blockCount() == 2);
+	}
+}
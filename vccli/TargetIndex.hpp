@@ -0,0 +1,238 @@
+#pragma once
+#include "Match.hpp"
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+namespace vccli {
+	/**
+	 * @class	TargetIndex
+	 * @brief	Case-insensitive string index used to resolve TARGET strings without scanning every candidate.
+	 *\n		Each key is associated with one or more numeric values (i.e. indexes into an AudioSnapshot's device or session list).
+	 *\n		Exact lookups go through a hash map of case-folded keys; substring lookups go through a trigram index
+	 *			 that narrows the candidate keys down to those that contain every trigram of the search term.
+	 *\n		Whitespace surrounding keys is ignored, so search terms should be trimmed as well (see match::TargetMatcher).
+	 *\n		Ranked lookups score names by edit distance (see match::FuzzyPattern); keys that aren't names, such as IDs,
+	 *			 only match when they contain the search term.
+	 */
+	class TargetIndex {
+	public:
+		using value_t = uint32_t;
+
+		/// @brief	A key that matched a ranked lookup.
+		struct RankedKey {
+			/// @brief	The edit distance in the high 32 bits, & the difference in length between the key & the search term in the low 32 bits.  Lower is better.
+			uint64_t score;
+			uint32_t keyID;
+		};
+
+	private:
+		using trigram_t = uint32_t;
+
+		/// @brief	Maps case-folded keys to key IDs. std::unordered_map never moves its nodes, so pointers to its keys stay valid.
+		std::unordered_map<std::string, uint32_t> keyIDs;
+		/// @brief	Case-folded keys, by key ID.
+		std::vector<const std::string*> keys;
+		/// @brief	The values associated with each key, by key ID.
+		std::vector<std::vector<value_t>> postings;
+		/// @brief	The IDs of all keys that contain each trigram, in ascending order.
+		std::unordered_map<trigram_t, std::vector<uint32_t>> trigrams;
+		/// @brief	Whether each key is a name that ranked lookups score by edit distance, by key ID.
+		std::vector<bool> isName;
+		/// @brief	The IDs of all name keys.
+		std::vector<uint32_t> nameKeys;
+		/// @brief	Buffer that keys are case-folded into, so that adding a key that's already indexed doesn't allocate.
+		std::string scratch;
+
+		static constexpr trigram_t make_trigram(const char a, const char b, const char c)
+		{
+			return (static_cast<trigram_t>(static_cast<unsigned char>(a)) << 16) | (static_cast<trigram_t>(static_cast<unsigned char>(b)) << 8) | static_cast<trigram_t>(static_cast<unsigned char>(c));
+		}
+
+		/**
+		 * @brief			Calls the given function with the ID of every key that contains the given search term.
+		 * @param needle	A case-folded search term.
+		 * @param func		A function that accepts a key ID.
+		 */
+		template<std::invocable<uint32_t> F>
+		void forEachKeyContaining(std::string const& needle, F&& func) const
+		{
+			if (needle.size() < 3) {
+				// Too short to have a trigram; check every distinct key instead
+				for (uint32_t keyID{ 0 }; keyID < keys.size(); ++keyID)
+					if (keys[keyID]->find(needle) != std::string::npos)
+						func(keyID);
+				return;
+			}
+
+			// Find the rarest trigram in the needle; every key that contains the needle must also contain it
+			const std::vector<uint32_t>* candidates{ nullptr };
+			for (size_t i{ 0 }; i + 2 < needle.size(); ++i) {
+				const auto& it{ trigrams.find(make_trigram(needle[i], needle[i + 1], needle[i + 2])) };
+				if (it == trigrams.end())
+					return; //< no key contains this trigram
+				if (candidates == nullptr || it->second.size() < candidates->size())
+					candidates = &it->second;
+			}
+
+			for (const auto& keyID : *candidates)
+				if (keys[keyID]->find(needle) != std::string::npos)
+					func(keyID);
+		}
+
+		/// @brief	Sorts & removes duplicates from the given value list.
+		static std::vector<value_t>& make_unique(std::vector<value_t>& values)
+		{
+			std::sort(values.begin(), values.end());
+			values.erase(std::unique(values.begin(), values.end()), values.end());
+			return values;
+		}
+
+	public:
+		TargetIndex() = default;
+		/// @brief	Copying is disabled because keys point into the nodes of keyIDs, which a copy wouldn't share.
+		TargetIndex(TargetIndex const&) = delete;
+		TargetIndex& operator=(TargetIndex const&) = delete;
+		/// @brief	Moving transfers ownership of keyIDs' nodes without relocating them, so the moved keys stay valid.
+		TargetIndex(TargetIndex&&) noexcept = default;
+		TargetIndex& operator=(TargetIndex&&) noexcept = default;
+
+		/**
+		 * @brief		Adds a key to the index.
+		 * @param key		The key string. This is trimmed & case-folded before it is stored.
+		 * @param value		The value to associate with the key.
+		 * @param isName	When true, ranked lookups score this key by edit distance; otherwise it must contain the search term.
+		 */
+		void add(const std::string_view key, const value_t value, const bool isName = true)
+		{
+			const auto& trimmed{ match::trimWhitespace(key) };
+			scratch.resize(trimmed.size());
+			match::fold(trimmed, scratch.data());
+
+			auto it{ keyIDs.find(scratch) };
+			if (it == keyIDs.end()) {
+				it = keyIDs.emplace(scratch, static_cast<uint32_t>(keys.size())).first;
+				const auto keyID{ it->second };
+				keys.emplace_back(&it->first);
+				postings.emplace_back();
+				this->isName.emplace_back(isName);
+				if (isName)
+					nameKeys.emplace_back(keyID);
+
+				const auto& folded{ it->first };
+				for (size_t i{ 0 }; i + 2 < folded.size(); ++i) {
+					auto& keyList{ trigrams[make_trigram(folded[i], folded[i + 1], folded[i + 2])] };
+					if (keyList.empty() || keyList.back() != keyID)
+						keyList.emplace_back(keyID);
+				}
+			}
+			postings[it->second].emplace_back(value);
+		}
+
+		/**
+		 * @brief			Finds all values associated with a key that is equal to the given search term, ignoring case.
+		 * @param needle	A trimmed, case-folded search term.
+		 * @returns			A sorted vector of unique values.
+		 */
+		std::vector<value_t> findExact(std::string const& needle) const
+		{
+			std::vector<value_t> values;
+			if (const auto& it{ keyIDs.find(needle) }; it != keyIDs.end())
+				values = postings[it->second];
+			return make_unique(values);
+		}
+
+		/**
+		 * @brief			Finds all values associated with a key that contains the given search term, ignoring case.
+		 * @param needle	A case-folded search term.
+		 * @returns			A sorted vector of unique values.
+		 */
+		std::vector<value_t> findSubstring(std::string const& needle) const
+		{
+			std::vector<value_t> values;
+			forEachKeyContaining(needle, [&](const uint32_t keyID) {
+				values.insert(values.end(), postings[keyID].begin(), postings[keyID].end());
+			});
+			return make_unique(values);
+		}
+
+		/**
+		 * @brief				Finds all keys that approximately match the given pattern, best match first.
+		 *\n					Every name key is scored by its edit distance from the pattern; other keys match with a distance
+		 *						 of 0 when they contain the pattern.  Ties are broken by how close the key's length is to the
+		 *						 pattern's, so "spot" ranks "spotify" ahead of "spotifywebhelper".
+		 * @param pattern		The pattern to search for.
+		 * @param maxDistance	The maximum edit distance of a match.
+		 * @returns				The matching keys, sorted by score & then by key ID.
+		 */
+		std::vector<RankedKey> rank(match::FuzzyPattern const& pattern, const size_t maxDistance) const
+		{
+			const auto& needle{ pattern.folded() };
+			const auto& makeScore{ [&needle](const size_t distance, const std::string& key) {
+				const auto lengthDifference{ key.size() > needle.size() ? key.size() - needle.size() : needle.size() - key.size() };
+				return (static_cast<uint64_t>(distance) << 32) | static_cast<uint32_t>(lengthDifference);
+			} };
+
+			std::vector<RankedKey> ranked;
+			for (const auto& keyID : nameKeys)
+				if (const auto distance{ pattern.distance(*keys[keyID]) }; distance <= maxDistance)
+					ranked.emplace_back(RankedKey{ makeScore(distance, *keys[keyID]), keyID });
+			forEachKeyContaining(needle, [&](const uint32_t keyID) {
+				if (!isName[keyID])
+					ranked.emplace_back(RankedKey{ makeScore(0, *keys[keyID]), keyID });
+			});
+
+			std::sort(ranked.begin(), ranked.end(), [](RankedKey const& l, RankedKey const& r) { return l.score < r.score || (l.score == r.score && l.keyID < r.keyID); });
+			return ranked;
+		}
+
+		/// @brief	Gets the values associated with the given key ID, in the order that they were added.
+		std::vector<value_t> const& getValues(const uint32_t keyID) const { return postings[keyID]; }
+		/// @brief	Gets the case-folded key with the given key ID.
+		std::string const& getKey(const uint32_t keyID) const { return *keys[keyID]; }
+
+		/// @brief	Gets the number of distinct keys in the index.
+		size_t size() const { return keys.size(); }
+	};
+
+	TEST_CASE("TargetIndex")
+	{
+		TargetIndex index;
+		index.add("Speakers (USB Audio Codec ) ", 0);
+		index.add("chrome", 1);
+		index.add("Chrome", 2);
+		index.add("discord", 3);
+
+		CHECK(index.size() == 3);
+		CHECK(index.findExact("chrome") == std::vector<TargetIndex::value_t>{ 1, 2 });
+		CHECK(index.findExact("chr").empty());
+		CHECK(index.findExact("speakers (usb audio codec )") == std::vector<TargetIndex::value_t>{ 0 });
+		CHECK(index.findSubstring("usb audio codec") == std::vector<TargetIndex::value_t>{ 0 });
+		CHECK(index.findSubstring("o") == std::vector<TargetIndex::value_t>{ 0, 1, 2, 3 });
+		CHECK(index.findSubstring("cord") == std::vector<TargetIndex::value_t>{ 3 });
+		CHECK(index.findSubstring("xyz").empty());
+
+		index.add("{0.0.0.00000000}.{e220a839}", 4, false);
+		index.add("Spotify", 5);
+		index.add("SpotifyWebHelper", 6);
+		const auto& ranked{ index.rank(match::FuzzyPattern{ "spotfy" }, 1) };
+		REQUIRE(ranked.size() == 2);
+		CHECK(index.getKey(ranked[0].keyID) == "spotify");
+		CHECK(index.getKey(ranked[1].keyID) == "spotifywebhelper");
+		CHECK(index.rank(match::FuzzyPattern{ "e220a838" }, 1).empty()); //< IDs aren't scored by edit distance
+		CHECK(index.getValues(index.rank(match::FuzzyPattern{ "e220a839" }, 1).front().keyID) == std::vector<TargetIndex::value_t>{ 4 });
+
+		static_assert(!std::is_copy_constructible_v<TargetIndex> && !std::is_copy_assignable_v<TargetIndex>);
+		TargetIndex moved{ std::move(index) };
+		CHECK(moved.findSubstring("usb audio") == std::vector<TargetIndex::value_t>{ 0 });
+		CHECK(moved.getKey(ranked[0].keyID) == "spotify");
+	}
+}
@@ -0,0 +1,169 @@
+#pragma once
+#include "util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace vccli {
+	/**
+	 * @class	ThreadPool
+	 * @brief	Pool of worker threads that grows on demand, up to a fixed limit.
+	 *\n		On Windows each worker joins the multithreaded apartment before running any tasks, so COM objects created
+	 *			 on the main thread (which is also MTA) can be called from the workers without marshalling.
+	 *\n		Workers are only started when a task is submitted while all of the existing workers are busy, which keeps
+	 *			 the pool cheap for the common case of one target.
+	 */
+	class ThreadPool {
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::deque<std::packaged_task<void()>> tasks;
+		std::vector<std::thread> workers;
+		size_t maxWorkers;
+		size_t idleWorkers{ 0 };
+		bool stopping{ false };
+
+		void work()
+		{
+		#ifdef OS_WIN
+			const bool comInitialized{ SUCCEEDED(CoInitializeEx(NULL, COINIT::COINIT_MULTITHREADED)) };
+		#endif
+			std::unique_lock lock(mutex);
+			while (true) {
+				++idleWorkers;
+				cv.wait(lock, [this]() { return stopping || !tasks.empty(); });
+				--idleWorkers;
+				if (tasks.empty())
+					break; //< stopping & nothing left to do
+				auto task{ std::move(tasks.front()) };
+				tasks.pop_front();
+				lock.unlock();
+				task();
+				lock.lock();
+			}
+			lock.unlock();
+		#ifdef OS_WIN
+			if (comInitialized) CoUninitialize();
+		#endif
+		}
+
+	public:
+		/**
+		 * @brief				Creates a new thread pool without starting any workers.
+		 * @param maxWorkers	The maximum number of worker threads that may be started.
+		 */
+		ThreadPool(const size_t maxWorkers) : maxWorkers{ maxWorkers > 0 ? maxWorkers : 1 } {}
+		ThreadPool(ThreadPool const&) = delete;
+		~ThreadPool()
+		{
+			{
+				std::scoped_lock lock(mutex);
+				stopping = true;
+			}
+			cv.notify_all();
+			for (auto& worker : workers)
+				worker.join();
+		}
+
+		/**
+		 * @brief		Queues a function to be called on a worker thread.
+		 * @param func	The function to call.
+		 * @returns		A future that becomes ready when the function returns, & rethrows any exception that it threw.
+		 */
+		template<std::invocable F>
+		std::future<void> submit(F&& func)
+		{
+			std::packaged_task<void()> task{ std::forward<F>(func) };
+			auto future{ task.get_future() };
+			{
+				std::scoped_lock lock(mutex);
+				tasks.emplace_back(std::move(task));
+				if (idleWorkers < tasks.size() && workers.size() < maxWorkers)
+					workers.emplace_back(&ThreadPool::work, this);
+			}
+			cv.notify_one();
+			return future;
+		}
+
+		/**
+		 * @brief			Calls a function for every index in [0, count), on the calling thread & on up to maxTasks - 1 workers.
+		 *\n				Each thread claims the next unclaimed index from a shared counter whenever it finishes one, so a slow index
+		 *					 doesn't hold up the others, & indices are spread evenly however long each one takes.  This must not
+		 *					 be called from a task running on the same pool.
+		 * @param count		The number of indices.
+		 * @param func		The function to call with each index.  Calls for different indices can run at the same time.
+		 * @param maxTasks	The maximum number of threads to use, including the calling thread.
+		 * @throws			The first exception thrown by func, after every thread has stopped.  Indices that weren't claimed yet
+		 *					 when it was thrown are skipped.
+		 */
+		template<std::invocable<size_t> F>
+		void parallelFor(const size_t count, F&& func, const size_t maxTasks = SIZE_MAX)
+		{
+			std::atomic<size_t> next{ 0 };
+			const auto& run{ [&]() {
+				try {
+					for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count; )
+						func(i);
+				} catch (...) {
+					next.store(count, std::memory_order_relaxed);
+					throw;
+				}
+			} };
+
+			const size_t threads{ std::min({ count, maxWorkers + 1, maxTasks }) };
+			std::vector<std::future<void>> helpers;
+			helpers.reserve(threads > 0 ? threads - 1 : 0);
+			for (size_t i{ 1 }; i < threads; ++i)
+				helpers.emplace_back(submit(run));
+
+			std::exception_ptr error;
+			try {
+				run();
+			} catch (...) {
+				error = std::current_exception();
+			}
+			for (auto& helper : helpers) {
+				try {
+					helper.get();
+				} catch (...) {
+					if (!error) error = std::current_exception();
+				}
+			}
+			if (error)
+				std::rethrow_exception(error);
+		}
+
+		/// @brief	Gets the number of worker threads that have been started.
+		size_t size()
+		{
+			std::scoped_lock lock(mutex);
+			return workers.size();
+		}
+	};
+
+	TEST_CASE("ThreadPool")
+	{
+		ThreadPool pool{ 4 };
+		std::vector<int> results(16, 0);
+		std::vector<std::future<void>> futures;
+		for (int i{ 0 }; i < 16; ++i)
+			futures.emplace_back(pool.submit([&results, i]() { results[i] = i * i; }));
+		futures.emplace_back(pool.submit([]() { throw std::runtime_error("expected"); }));
+
+		for (size_t i{ 0 }; i < 16; ++i)
+			futures[i].get();
+		CHECK_THROWS(futures.back().get());
+		CHECK(pool.size() <= 4);
+		for (int i{ 0 }; i < 16; ++i)
+			CHECK(results[i] == i * i);
+
+		std::vector<std::atomic<int>> visits(1000);
+		pool.parallelFor(visits.size(), [&visits](const size_t i) { ++visits[i]; });
+		CHECK(std::all_of(visits.begin(), visits.end(), [](auto&& n) { return n == 1; }));
+		CHECK_THROWS(pool.parallelFor(100, [](const size_t i) { if (i == 50) throw std::runtime_error("expected"); }));
+	}
+}
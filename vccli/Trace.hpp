@@ -0,0 +1,198 @@
+#pragma once
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+/**
+ * @def		$trace(name)
+ * @brief	Records a span named `name` that lasts until the end of the current scope, when tracing is enabled.
+ *\n		When tracing is disabled the cost is one relaxed atomic load; defining VCCLI_DISABLE_TRACE removes spans entirely.
+ * @param name	A string literal that names the span.
+ */
+#ifndef VCCLI_DISABLE_TRACE
+#define $trace_concat_impl(a, b) a##b
+#define $trace_concat(a, b) $trace_concat_impl(a, b)
+#define $trace(name) const ::vccli::trace::Span $trace_concat($trace_span_, __LINE__){ name }
+#else
+#define $trace(name)
+#endif
+
+/**
+ * @namespace	vccli::trace
+ * @brief		Lightweight span recorder that exports Chrome's trace_event JSON format (chrome://tracing, Perfetto).
+ */
+namespace vccli::trace {
+	using clock = std::chrono::steady_clock;
+
+	/// @brief	True while spans are being recorded.
+	inline std::atomic<bool> enabled{ false };
+
+	/**
+	 * @class	Recorder
+	 * @brief	Collects the spans recorded by all threads.
+	 */
+	class Recorder {
+		struct Event {
+			const char* name;
+			uint32_t tid;
+			clock::time_point begin;
+			clock::duration duration;
+		};
+
+		std::mutex mutex;
+		std::vector<Event> events;
+		clock::time_point origin{ clock::now() };
+
+		/// @brief	Gets a small, stable ID for the calling thread.
+		static uint32_t getThreadID()
+		{
+			static std::atomic<uint32_t> next{ 0 };
+			thread_local const uint32_t id{ next++ };
+			return id;
+		}
+
+		static void writeJSONString(std::ostream& os, std::string_view s)
+		{
+			os << '"';
+			for (const char c : s) {
+				if (c == '"' || c == '\\') os << '\\' << c;
+				else if (static_cast<unsigned char>(c) >= 0x20) os << c;
+			}
+			os << '"';
+		}
+
+	public:
+		/// @brief	Gets the global recorder.
+		static Recorder& get()
+		{
+			static Recorder instance;
+			return instance;
+		}
+
+		/// @brief	Discards all recorded spans & starts recording.
+		void start()
+		{
+			{
+				std::scoped_lock lock(mutex);
+				events.clear();
+				origin = clock::now();
+			}
+			enabled.store(true, std::memory_order_release);
+		}
+		/// @brief	Stops recording.  Spans that are still open when this is called are discarded.
+		void stop()
+		{
+			enabled.store(false, std::memory_order_release);
+		}
+
+		/// @brief	Records a completed span.
+		void record(const char* name, const clock::time_point begin, const clock::time_point end)
+		{
+			const auto tid{ getThreadID() };
+			std::scoped_lock lock(mutex);
+			events.emplace_back(Event{ name, tid, begin, end - begin });
+		}
+
+		/// @brief	Gets the number of times that each span was recorded.
+		std::map<std::string, size_t> getCallCounts()
+		{
+			std::scoped_lock lock(mutex);
+			std::map<std::string, size_t> counts;
+			for (const auto& e : events)
+				++counts[e.name];
+			return counts;
+		}
+
+		/**
+		 * @brief		Writes all of the recorded spans in Chrome's trace_event JSON format.
+		 *\n			Each span is a complete ("X") event; the number of times each span was recorded is written to "otherData".
+		 * @param os	The stream to write to.
+		 */
+		void writeChromeTrace(std::ostream& os)
+		{
+			const auto& counts{ getCallCounts() };
+			std::scoped_lock lock(mutex);
+
+			const auto& toMicroseconds{ [](const clock::duration d) { return std::chrono::duration<double, std::micro>(d).count(); } };
+
+			os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+			bool first{ true };
+			for (const auto& e : events) {
+				if (first) first = false;
+				else os << ',';
+				os << "\n{\"name\":";
+				writeJSONString(os, e.name);
+				os
+					<< ",\"cat\":\"vccli\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.tid
+					<< ",\"ts\":" << toMicroseconds(e.begin - origin)
+					<< ",\"dur\":" << toMicroseconds(e.duration)
+					<< '}';
+			}
+			os << "\n],\"otherData\":{";
+			first = true;
+			for (const auto& [name, count] : counts) {
+				if (first) first = false;
+				else os << ',';
+				os << "\n";
+				writeJSONString(os, name);
+				os << ':' << count;
+			}
+			os << "\n}}\n";
+		}
+	};
+
+	/**
+	 * @class	Span
+	 * @brief	Records the time between its construction & destruction, when tracing is enabled.  Use the $trace macro.
+	 */
+	class Span {
+		const char* name;
+		clock::time_point begin;
+
+	public:
+		Span(const char* name) : name{ enabled.load(std::memory_order_relaxed) ? name : nullptr }
+		{
+			if (this->name != nullptr)
+				begin = clock::now();
+		}
+		Span(Span const&) = delete;
+		~Span()
+		{
+			if (name != nullptr && enabled.load(std::memory_order_relaxed))
+				Recorder::get().record(name, begin, clock::now());
+		}
+	};
+
+#ifndef VCCLI_DISABLE_TRACE
+	TEST_CASE("trace::Span")
+	{
+		auto& recorder{ Recorder::get() };
+		{
+			$trace("disabled");
+		}
+		recorder.start();
+		{
+			$trace("outer");
+			for (int i{ 0 }; i < 3; ++i) {
+				$trace("inner");
+			}
+		}
+		recorder.stop();
+
+		const auto& counts{ recorder.getCallCounts() };
+		CHECK(!counts.contains("disabled"));
+		CHECK(counts.at("outer") == 1);
+		CHECK(counts.at("inner") == 3);
+
+		std::stringstream ss;
+		recorder.writeChromeTrace(ss);
+		CHECK(ss.str().find("\"name\":\"inner\",\"cat\":\"vccli\",\"ph\":\"X\"") != std::string::npos);
+	}
+#endif
+}
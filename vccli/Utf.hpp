@@ -0,0 +1,225 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <doctest/doctest.h>
+
+#if !defined(VCCLI_SSE2) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define VCCLI_SSE2
+#endif
+#ifdef VCCLI_SSE2
+#include <emmintrin.h>
+#endif
+
+/**
+ * @namespace	vccli::utf
+ * @brief		UTF-16 <=> UTF-8 transcoding.
+ *\n			Runs of ASCII characters are converted 16 at a time with SSE2 (when it's available); everything else goes
+ *			 through a scalar path.  Unpaired surrogates & invalid UTF-8 sequences are replaced with U+FFFD.
+ */
+namespace vccli::utf {
+	/// @brief	The UTF-16 replacement character, which replaces invalid input.
+	inline constexpr char16_t REPLACEMENT_CHARACTER{ 0xFFFD };
+
+	/// @brief	Gets the size of the buffer that toUtf8 needs for a UTF-16 string with the given number of code units.
+	inline constexpr size_t maxUtf8Size(const size_t utf16Length) { return utf16Length * 3; }
+	/// @brief	Gets the size of the buffer that toUtf16 needs for a UTF-8 string with the given number of bytes.
+	inline constexpr size_t maxUtf16Size(const size_t utf8Length) { return utf8Length; }
+
+	/**
+	 * @brief		Converts a UTF-16 string to UTF-8.
+	 * @param in	The UTF-16 string to convert.
+	 * @param out	The buffer to write to.  This must have room for at least maxUtf8Size(in.size()) bytes.
+	 * @returns		The number of bytes that were written to the buffer.
+	 */
+	inline size_t toUtf8(const std::u16string_view in, char* const out) noexcept
+	{
+		const char16_t* src{ in.data() };
+		const size_t n{ in.size() };
+		char* dst{ out };
+
+		for (size_t i{ 0 }; i < n; ) {
+		#ifdef VCCLI_SSE2
+			// ASCII fast path; 16 code units per iteration
+			const __m128i nonAsciiMask{ _mm_set1_epi16(static_cast<short>(0xFF80)) };
+			for (; i + 16 <= n; i += 16, dst += 16) {
+				const __m128i a{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)) };
+				const __m128i b{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8)) };
+				const __m128i nonAscii{ _mm_and_si128(_mm_or_si128(a, b), nonAsciiMask) };
+				if (_mm_movemask_epi8(_mm_cmpeq_epi16(nonAscii, _mm_setzero_si128())) != 0xFFFF)
+					break;
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(a, b));
+			}
+			if (i >= n) break;
+		#endif
+			// Scalar path; one code point per iteration
+			char32_t c{ src[i++] };
+			if (c < 0x80) {
+				*dst++ = static_cast<char>(c);
+				continue;
+			}
+			else if (c < 0x800) {
+				*dst++ = static_cast<char>(0xC0 | (c >> 6));
+				*dst++ = static_cast<char>(0x80 | (c & 0x3F));
+				continue;
+			}
+			else if (c >= 0xD800 && c <= 0xDFFF) {
+				if (c <= 0xDBFF && i < n && src[i] >= 0xDC00 && src[i] <= 0xDFFF) {
+					c = 0x10000 + ((c - 0xD800) << 10) + (src[i++] - 0xDC00);
+					*dst++ = static_cast<char>(0xF0 | (c >> 18));
+					*dst++ = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+					*dst++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+					*dst++ = static_cast<char>(0x80 | (c & 0x3F));
+					continue;
+				}
+				c = REPLACEMENT_CHARACTER; //< unpaired surrogate
+			}
+			*dst++ = static_cast<char>(0xE0 | (c >> 12));
+			*dst++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+			*dst++ = static_cast<char>(0x80 | (c & 0x3F));
+		}
+		return static_cast<size_t>(dst - out);
+	}
+	/**
+	 * @brief		Converts a UTF-16 string to UTF-8, replacing the contents of the given string.
+	 *\n			The string's capacity is reused, so converting many strings into the same buffer doesn't allocate.
+	 * @param in	The UTF-16 string to convert.
+	 * @param out	The string to write to.
+	 */
+	inline void toUtf8(const std::u16string_view in, std::string& out)
+	{
+		out.resize(maxUtf8Size(in.size()));
+		out.resize(toUtf8(in, out.data()));
+	}
+	/// @brief	Converts a UTF-16 string to UTF-8.
+	inline std::string toUtf8(const std::u16string_view in)
+	{
+		// convert short strings on the stack so that the result is the only allocation
+		if (char buf[768]; maxUtf8Size(in.size()) <= sizeof(buf))
+			return{ buf, toUtf8(in, buf) };
+		std::string out;
+		toUtf8(in, out);
+		return out;
+	}
+
+	/**
+	 * @brief		Converts a UTF-8 string to UTF-16.
+	 * @param in	The UTF-8 string to convert.
+	 * @param out	The buffer to write to.  This must have room for at least maxUtf16Size(in.size()) code units.
+	 * @returns		The number of code units that were written to the buffer.
+	 */
+	inline size_t toUtf16(const std::string_view in, char16_t* const out) noexcept
+	{
+		const auto* src{ reinterpret_cast<const unsigned char*>(in.data()) };
+		const size_t n{ in.size() };
+		char16_t* dst{ out };
+
+		const auto& isContinuation{ [&](const size_t i) { return i < n && (src[i] & 0xC0) == 0x80; } };
+
+		for (size_t i{ 0 }; i < n; ) {
+		#ifdef VCCLI_SSE2
+			// ASCII fast path; 16 bytes per iteration
+			for (; i + 16 <= n; i += 16, dst += 16) {
+				const __m128i v{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)) };
+				if (_mm_movemask_epi8(v) != 0)
+					break;
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi8(v, _mm_setzero_si128()));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 8), _mm_unpackhi_epi8(v, _mm_setzero_si128()));
+			}
+			if (i >= n) break;
+		#endif
+			// Scalar path; one code point per iteration
+			const unsigned char c{ src[i] };
+			if (c < 0x80) {
+				*dst++ = c;
+				++i;
+			}
+			else if (c >= 0xC2 && c <= 0xDF && isContinuation(i + 1)) {
+				*dst++ = static_cast<char16_t>(((c & 0x1F) << 6) | (src[i + 1] & 0x3F));
+				i += 2;
+			}
+			else if (c >= 0xE0 && c <= 0xEF && isContinuation(i + 1) && isContinuation(i + 2)
+				&& !(c == 0xE0 && src[i + 1] < 0xA0) //< overlong
+				&& !(c == 0xED && src[i + 1] >= 0xA0)) { //< surrogate
+				*dst++ = static_cast<char16_t>(((c & 0x0F) << 12) | ((src[i + 1] & 0x3F) << 6) | (src[i + 2] & 0x3F));
+				i += 3;
+			}
+			else if (c >= 0xF0 && c <= 0xF4 && isContinuation(i + 1) && isContinuation(i + 2) && isContinuation(i + 3)
+				&& !(c == 0xF0 && src[i + 1] < 0x90) //< overlong
+				&& !(c == 0xF4 && src[i + 1] >= 0x90)) { //< > U+10FFFF
+				const char32_t cp{ ((c & 0x07u) << 18) | ((src[i + 1] & 0x3Fu) << 12) | ((src[i + 2] & 0x3Fu) << 6) | (src[i + 3] & 0x3Fu) };
+				*dst++ = static_cast<char16_t>(0xD800 + ((cp - 0x10000) >> 10));
+				*dst++ = static_cast<char16_t>(0xDC00 + ((cp - 0x10000) & 0x3FF));
+				i += 4;
+			}
+			else {
+				*dst++ = REPLACEMENT_CHARACTER;
+				++i;
+			}
+		}
+		return static_cast<size_t>(dst - out);
+	}
+	/**
+	 * @brief		Converts a UTF-8 string to UTF-16, replacing the contents of the given string.
+	 *\n			The string's capacity is reused, so converting many strings into the same buffer doesn't allocate.
+	 * @param in	The UTF-8 string to convert.
+	 * @param out	The string to write to.
+	 */
+	inline void toUtf16(const std::string_view in, std::u16string& out)
+	{
+		out.resize(maxUtf16Size(in.size()));
+		out.resize(toUtf16(in, out.data()));
+	}
+	/// @brief	Converts a UTF-8 string to UTF-16.
+	inline std::u16string toUtf16(const std::string_view in)
+	{
+		std::u16string out;
+		toUtf16(in, out);
+		return out;
+	}
+
+#ifdef OS_WIN
+	static_assert(sizeof(wchar_t) == sizeof(char16_t), "wchar_t must be UTF-16 on Windows");
+
+	/// @brief	Converts a null-terminated wide string (i.e. a string returned by a Windows API) to UTF-8.
+	inline std::string toUtf8(const wchar_t* in)
+	{
+		if (in == nullptr) return{};
+		return toUtf8(std::u16string_view{ reinterpret_cast<const char16_t*>(in) });
+	}
+	/// @brief	Converts a UTF-8 string to a wide string for use with Windows APIs.
+	inline std::wstring toWide(const std::string_view in)
+	{
+		std::wstring out(maxUtf16Size(in.size()), L'\0');
+		out.resize(toUtf16(in, reinterpret_cast<char16_t*>(out.data())));
+		return out;
+	}
+#endif
+
+	TEST_CASE("utf")
+	{
+		// ASCII (long enough for the vectorised path, with a tail)
+		const std::string id{ "{0.0.0.00000000}.{e220a839-7b1d-cdaf-6e78-9e6aa1b965f4}" };
+		const std::u16string id16{ u"{0.0.0.00000000}.{e220a839-7b1d-cdaf-6e78-9e6aa1b965f4}" };
+		CHECK(toUtf8(id16) == id);
+		CHECK(toUtf16(id) == id16);
+
+		// 2, 3 & 4 byte sequences, mixed into ASCII runs
+		const std::string mixed{ "Lautsprecher (Realtek\xC2\xAE Audio) \xE3\x83\x98\xE3\x83\x83\xE3\x83\x89\xE3\x83\x9B\xE3\x83\xB3 \xF0\x9F\x8E\xA7 and some more ASCII" };
+		const std::u16string mixed16{ u"Lautsprecher (Realtek® Audio) ヘッドホン \U0001F3A7 and some more ASCII" };
+		CHECK(toUtf8(mixed16) == mixed);
+		CHECK(toUtf16(mixed) == mixed16);
+
+		// invalid input
+		CHECK(toUtf8(std::u16string{ u'a', char16_t(0xD800), u'b' }) == "a\xEF\xBF\xBD" "b");
+		CHECK(toUtf8(std::u16string{ char16_t(0xDC00) }) == "\xEF\xBF\xBD");
+		CHECK(toUtf16("a\xFF" "b\xE0\x80\x80") == std::u16string{ u'a', REPLACEMENT_CHARACTER, u'b', REPLACEMENT_CHARACTER, REPLACEMENT_CHARACTER, REPLACEMENT_CHARACTER });
+
+		// caller-provided buffer
+		std::string buf;
+		toUtf8(u"Speakers", buf);
+		CHECK(buf == "Speakers");
+	}
+}
@@ -1,18 +1,11 @@
 #pragma once
-#include <math.hpp>
+#include "util.hpp"
 
-#define WIN32_LEAN_AND_MEAN
-#include <Windows.h>
-#include <mmdeviceapi.h>
-#include <audiopolicy.h>
-#include <endpointvolume.h>
+#include <math.hpp>
 
 #include <typeinfo>
 
 namespace vccli {
-	/// @brief	GUID to use as 'context' parameter in setter functions.
-	inline static constexpr GUID default_context{};
-
 	struct Volume {
 		std::string resolved_name, identifier;
 		EDataFlow flow_type;
@@ -63,87 +56,125 @@ namespace vccli {
 		template<std::derived_from<Volume> T>
 		constexpr bool is_derived_type() const
 		{
-			return typeid(*this) == typeid(T);
+			return dynamic_cast<const T*>(this) != nullptr;
 		}
 	};
 
-	template<std::derived_from<IUnknown> T>
-	struct VolumeController : Volume {
-	protected:
-		using base = VolumeController<T>;
+	/**
+	 * @struct	ApplicationVolume
+	 * @brief	Backend-independent base for volume objects that control a single audio session.
+	 */
+	struct ApplicationVolume : Volume {
+		std::string dev_id, sessionIdentifier, sessionInstanceIdentifier;
 
-		T* vol;
+		ApplicationVolume(std::string const& resolved_name, const DWORD pid, const EDataFlow flow_type, std::string const& deviceID, std::string const& sessionIdentifier, std::string const& sessionInstanceIdentifier) : Volume(resolved_name, std::to_string(pid), flow_type), dev_id{ deviceID }, sessionIdentifier{ sessionIdentifier }, sessionInstanceIdentifier{ sessionInstanceIdentifier } {}
 
-		constexpr VolumeController(T* vol, std::string const& resolved_name, std::string const& identifier, const EDataFlow flow_type) : Volume(resolved_name, identifier, flow_type), vol{ vol } {}
+		/// @brief	Checks if the session has expired, after which changes to its volume & mute state don't have any effect.
+		virtual bool isExpired() const { return false; }
 
-	public:
-		virtual ~VolumeController()
+		constexpr std::optional<std::string> type_name() const override
 		{
-			if (this->vol) ((IUnknown*)this->vol)->Release();
+			return{ "Session" };
 		}
 	};
 
-	struct ApplicationVolume : public VolumeController<ISimpleAudioVolume> {
-		std::string dev_id, sessionIdentifier, sessionInstanceIdentifier;
+	/**
+	 * @struct	EndpointVolume
+	 * @brief	Backend-independent base for volume objects that control an audio endpoint device.
+	 */
+	struct EndpointVolume : Volume {
+		bool isDefault;
 
-		constexpr ApplicationVolume(ISimpleAudioVolume* vol, std::string const& resolved_name, const DWORD pid, const EDataFlow flow_type, std::string const& deviceID, std::string const& sessionIdentifier, std::string const& sessionInstanceIdentifier) : base(vol, resolved_name, std::to_string(pid), flow_type), dev_id{ deviceID }, sessionIdentifier{ sessionIdentifier }, sessionInstanceIdentifier{ sessionInstanceIdentifier } {}
+		constexpr EndpointVolume(std::string const& resolved_name, std::string const& dGuid, const EDataFlow flow_type, const bool isDefault) : Volume(resolved_name, dGuid, flow_type), isDefault{ isDefault } {}
+
+		constexpr std::optional<std::string> type_name() const override
+		{
+			return{ "Device" };
+		}
+	};
+
+#ifdef OS_WIN
+	/// @brief	GUID to use as 'context' parameter in setter functions.
+	inline static constexpr GUID default_context{};
+
+	template<std::derived_from<IUnknown> T, std::derived_from<Volume> TBase>
+	struct VolumeController : TBase {
+	protected:
+		using base = VolumeController<T, TBase>;
+
+		ComPtr<T> vol;
+
+		template<typename... Ts>
+		VolumeController(ComPtr<T>&& vol, Ts&&... baseArgs) : TBase(std::forward<Ts>(baseArgs)...), vol{ std::move(vol) } {}
+	};
+
+	struct ApplicationVolumeController : public VolumeController<ISimpleAudioVolume, ApplicationVolume> {
+		ApplicationVolumeController(ComPtr<ISimpleAudioVolume>&& vol, std::string const& resolved_name, const DWORD pid, const EDataFlow flow_type, std::string const& deviceID, std::string const& sessionIdentifier, std::string const& sessionInstanceIdentifier) : base(std::move(vol), resolved_name, pid, flow_type, deviceID, sessionIdentifier, sessionInstanceIdentifier) {}
 
 		bool getMuted() const override
 		{
+			$trace("ApplicationVolumeController::getMuted");
 			BOOL muted;
 			vol->GetMute(&muted);
 			return static_cast<bool>(muted);
 		}
 		void setMuted(const bool state) const override
 		{
+			$trace("ApplicationVolumeController::setMuted");
 			vol->SetMute(static_cast<BOOL>(state), &default_context);
 		}
 
 		float getVolume() const override
 		{
+			$trace("ApplicationVolumeController::getVolume");
 			float level;
 			vol->GetMasterVolume(&level);
 			return level;
 		}
 		void setVolume(const float& level) const override
 		{
+			$trace("ApplicationVolumeController::setVolume");
 			vol->SetMasterVolume(level, &default_context);
 		}
-		constexpr std::optional<std::string> type_name() const override
+
+		bool isExpired() const override
 		{
-			return{ "Session" };
+			$trace("ApplicationVolumeController::isExpired");
+			// the session control is the same object as the volume, so this doesn't activate anything
+			const auto& control{ vol.as<IAudioSessionControl>() };
+			AudioSessionState state;
+			return !control || control->GetState(&state) != S_OK || state == AudioSessionStateExpired;
 		}
 	};
 
-	struct EndpointVolume : VolumeController<IAudioEndpointVolume> {
-		bool isDefault;
-
-		constexpr EndpointVolume(IAudioEndpointVolume* vol, std::string const& resolved_name, std::string const& dGuid, const EDataFlow flow_type, const bool isDefault) : base(vol, resolved_name, dGuid, flow_type), isDefault{ isDefault } {}
+	struct EndpointVolumeController : VolumeController<IAudioEndpointVolume, EndpointVolume> {
+		EndpointVolumeController(ComPtr<IAudioEndpointVolume>&& vol, std::string const& resolved_name, std::string const& dGuid, const EDataFlow flow_type, const bool isDefault) : base(std::move(vol), resolved_name, dGuid, flow_type, isDefault) {}
 
 		bool getMuted() const override
 		{
+			$trace("EndpointVolumeController::getMuted");
 			BOOL isMuted;
 			vol->GetMute(&isMuted);
 			return static_cast<bool>(isMuted);
 		}
 		void setMuted(const bool state) const override
 		{
+			$trace("EndpointVolumeController::setMuted");
 			vol->SetMute(static_cast<BOOL>(state), &default_context);
 		}
 
 		float getVolume() const override
 		{
+			$trace("EndpointVolumeController::getVolume");
 			float level;
 			vol->GetMasterVolumeLevelScalar(&level);
 			return level;
 		}
 		void setVolume(const float& level) const override
 		{
+			$trace("EndpointVolumeController::setVolume");
 			vol->SetMasterVolumeLevelScalar(level, &default_context);
 		}
-		constexpr std::optional<std::string> type_name() const override
-		{
-			return{ "Device" };
-		}
 	};
+#endif
 }
@@ -1,9 +1,14 @@
 #pragma once
 #include <sysarch.h>
 #include <str.hpp>
+#include <make_exception.hpp>
+
+#include "ComHandle.hpp"
+#include "Match.hpp"
+#include "Trace.hpp"
+#include "Utf.hpp"
 
 #include <algorithm>
-#include <codecvt>
 #include <concepts>
 #include <filesystem>
 #include <functional>
@@ -14,6 +19,7 @@
 
 #include <doctest/doctest.h>
 
+#ifdef OS_WIN
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 #include <audiopolicy.h>
@@ -22,22 +28,79 @@
 #include <psapi.h>
 #include <endpointvolume.h>
 #include <Functiondiscoverykeys_devpkey.h>
+#else
+#include <cstdint>
+
+// Stand-ins for the Windows types that are used by the platform-independent parts of vccli (the backend interface, the simulated backend, etc.)
+using DWORD = std::uint32_t;
+using UINT = unsigned int;
+enum EDataFlow { eRender, eCapture, eAll, EDataFlow_enum_count };
+enum ERole { eConsole, eMultimedia, eCommunications, ERole_enum_count };
+#endif
 
 namespace vccli {
-	/// @brief	( std::wstring <=> std::string ) converter object with UTF8/UTF16 (Windows) encoding.
-	inline static std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>, wchar_t> w_converter;
+	/**
+	 * @brief		Compares two given strings by comparing them as extentionless filenames using case-insensitive matching.
+	 * @param l		Left-side comparison string
+	 * @param r		Right-side comparison string
+	 * @returns		true when the extentionless filename of l is equal to the extentionless filename of r; otherwise false.
+	 */
+	inline bool CompareProcessName(std::string const& l, std::string const& r)
+	{
+		// strip the extension the same way std::filesystem::path::replace_extension() does, without allocating
+		const auto& removeExtension{ [](const std::string_view s) -> std::string_view {
+			const auto filenamePos{ s.find_last_of("/\\") + 1 }; //< npos + 1 == 0
+			const auto& filename{ s.substr(filenamePos) };
+			if (filename == "." || filename == "..")
+				return s;
+			if (const auto dotPos{ filename.rfind('.') }; dotPos != std::string_view::npos && dotPos != 0)
+				return s.substr(0, filenamePos + dotPos);
+			return s;
+		} };
+		return match::equalsIgnoreCase(removeExtension(l), removeExtension(r));
+	}
+
+	TEST_CASE("CompareProcessName")
+	{
+		CHECK(CompareProcessName("Chrome.exe", "chrome"));
+		CHECK(CompareProcessName("C:\\Program Files\\app.v2\\Discord.exe", "c:\\program files\\app.v2\\discord"));
+		CHECK(!CompareProcessName("app.v2\\discord", "app"));
+		CHECK(CompareProcessName(".hidden", ".HIDDEN"));
+		CHECK(!CompareProcessName("chrome.exe", "chromium.exe"));
+	}
+
+	/**
+	 * @brief			Convert the given EDataFlow enumeration to a string representation.
+	 * @param dataflow	An EDataFlow enum value.
+	 * @returns			std::string
+	 */
+	constexpr std::string DataFlowToString(EDataFlow const& dataflow)
+	{
+		switch (dataflow) {
+		case EDataFlow::eRender:
+			return "Output";
+		case EDataFlow::eCapture:
+			return "Input";
+		case EDataFlow::eAll:
+			return "In/Out";
+		default:
+			return{};
+		}
+	}
 
+#ifdef OS_WIN
 	/**
 	 * @brief		Uses the FormatMessage function to get a description of the given error code.
 	 * @param err	The error ID number; either an HRESULT or another type of windows system error code.
 	 * @returns		String containing a description of the error.
 	 */
 	template<std::integral T>
-	WINCONSTEXPR std::string GetErrorMessageFrom(T const& err)
+	inline std::string GetErrorMessageFrom(T const& err)
 	{
-		LPVOID lpMsgBuf{};
-		FormatMessageA(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, NULL, static_cast<DWORD>(err), MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), (LPTSTR)&lpMsgBuf, 0, NULL);
-		return{ (char*)lpMsgBuf };
+		LocalMemory msgBuf;
+		if (FormatMessageA(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, NULL, static_cast<DWORD>(err), MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), (LPSTR)msgBuf.put(), 0, NULL) == 0)
+			return{};
+		return{ static_cast<const char*>(msgBuf.get()) };
 	}
 
 	TEST_CASE("GetErrorMessageFrom")
@@ -45,67 +108,55 @@ namespace vccli {
 		CHECK(GetErrorMessageFrom(0) == "The operation completed successfully.\r\n");
 	}
 
-	/**
-	 * @brief		Compares two given strings by comparing them as extentionless filenames using case-insensitive matching.
-	 * @param l		Left-side comparison string
-	 * @param r		Right-side comparison string
-	 * @returns		true when the extentionless filename of l is equal to the extentionless filename of r; otherwise false.
-	 */
-	bool CompareProcessName(std::string const& l, std::string const& r)
-	{
-		return str::tolower(std::filesystem::path{ l }.replace_extension().generic_string()) == str::tolower(std::filesystem::path{ r }.replace_extension().generic_string());
-	}
-
 	inline std::optional<std::string> GetProcessNameFrom(DWORD const& pid)
 	{
-		if (HANDLE hProc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid)) {
+		$trace("GetProcessNameFrom");
+		if (const KernelHandle hProc{ OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid) }) {
 			DWORD len{ 260 };
 			CHAR sbuf[260];
-			if (QueryFullProcessImageNameA(hProc, PROCESS_NAME_NATIVE, sbuf, &len) != 0) {
-				CloseHandle(hProc);
+			if (QueryFullProcessImageNameA(hProc.get(), PROCESS_NAME_NATIVE, sbuf, &len) != 0)
 				return std::filesystem::path{ sbuf }.filename().replace_extension().generic_string();
-			}
-			else {
-				const auto hr{ GetLastError() };
-				CloseHandle(hProc);
-				throw make_exception("GetProcessName failed:  ", GetErrorMessageFrom(hr), " (code: ", hr, ')');
-			}
+
+			const auto hr{ GetLastError() };
+			throw make_exception("GetProcessName failed:  ", GetErrorMessageFrom(hr), " (code: ", hr, ')');
 		}
 		return std::nullopt;
 	}
 
 	inline std::string getSessionInstanceIdentifier(IAudioSessionControl2* session)
 	{
-		LPWSTR sbuf;
-		session->GetSessionInstanceIdentifier(&sbuf);
-		return w_converter.to_bytes(sbuf);
+		$trace("getSessionInstanceIdentifier");
+		CoTaskMemString sbuf;
+		session->GetSessionInstanceIdentifier(sbuf.put());
+		return utf::toUtf8(sbuf.get());
 	}
 	inline std::string getSessionIdentifier(IAudioSessionControl2* session)
 	{
-		LPWSTR sbuf;
-		session->GetSessionIdentifier(&sbuf);
-		return w_converter.to_bytes(sbuf);
+		$trace("getSessionIdentifier");
+		CoTaskMemString sbuf;
+		session->GetSessionIdentifier(sbuf.put());
+		return utf::toUtf8(sbuf.get());
 	}
 
 	inline std::string getDeviceID(IMMDevice* dev)
 	{
-		LPWSTR sbuf;
-		dev->GetId(&sbuf);
-		return w_converter.to_bytes(sbuf);
+		$trace("getDeviceID");
+		CoTaskMemString sbuf;
+		dev->GetId(sbuf.put());
+		return utf::toUtf8(sbuf.get());
 	}
 	/**
 	 * @brief		Retrieves the specified property value from the given device's property store.
 	 * @param dev	The IMMDevice to retrieve properties from.
 	 * @param pkey	The PROPERTYKEY structure to target.
-	 * @returns		PROPVARIANT
+	 * @returns		PropVariant; empty when the property couldn't be read.
 	 */
-	inline PROPVARIANT getDeviceProperty(IMMDevice* dev, const PROPERTYKEY& pkey)
+	inline PropVariant getDeviceProperty(IMMDevice* dev, const PROPERTYKEY& pkey)
 	{
-		PROPVARIANT pv{};
-		if (IPropertyStore* properties; dev->OpenPropertyStore(STGM_READ, &properties) == S_OK) {
-			properties->GetValue(pkey, &pv);
-			properties->Release();
-		}
+		$trace("getDeviceProperty");
+		PropVariant pv;
+		if (ComPtr<IPropertyStore> properties; dev->OpenPropertyStore(STGM_READ, properties.put()) == S_OK)
+			properties->GetValue(pkey, pv.put());
 		return pv;
 	}
 	/**
@@ -116,7 +167,8 @@ namespace vccli {
 	 */
 	inline std::string getDeviceFriendlyName(IMMDevice* dev)
 	{
-		return w_converter.to_bytes(getDeviceProperty(dev, PKEY_DeviceInterface_FriendlyName).pwszVal);
+		$trace("getDeviceFriendlyName");
+		return getDeviceProperty(dev, PKEY_DeviceInterface_FriendlyName).toUtf8();
 	}
 	/**
 	 * @brief		Retrieve the name of the given device from its properties.
@@ -126,7 +178,8 @@ namespace vccli {
 	 */
 	inline std::string getDeviceName(IMMDevice* dev)
 	{
-		return w_converter.to_bytes(getDeviceProperty(dev, PKEY_Device_FriendlyName).pwszVal);
+		$trace("getDeviceName");
+		return getDeviceProperty(dev, PKEY_Device_FriendlyName).toUtf8();
 	}
 	/**
 	 * @brief		Retrieve the description of the given device from its properties.
@@ -136,7 +189,8 @@ namespace vccli {
 	 */
 	inline std::string getDeviceDesc(IMMDevice* dev)
 	{
-		return w_converter.to_bytes(getDeviceProperty(dev, PKEY_Device_DeviceDesc).pwszVal);
+		$trace("getDeviceDesc");
+		return getDeviceProperty(dev, PKEY_Device_DeviceDesc).toUtf8();
 	}
 	/**
 	 * @brief		Queries the given device to determine whether it is an input or output device.
@@ -145,29 +199,11 @@ namespace vccli {
 	 */
 	inline EDataFlow getDeviceDataFlow(IMMDevice* dev)
 	{
-		IMMEndpoint* endpoint;
-		dev->QueryInterface<IMMEndpoint>(&endpoint);
-		EDataFlow flow;
-		endpoint->GetDataFlow(&flow);
-		endpoint->Release();
+		$trace("getDeviceDataFlow");
+		EDataFlow flow{ EDataFlow::eAll };
+		if (ComPtr<IMMEndpoint> endpoint; dev->QueryInterface(__uuidof(IMMEndpoint), endpoint.putVoid()) == S_OK)
+			endpoint->GetDataFlow(&flow);
 		return flow;
 	}
-	/**
-	 * @brief			Convert the given EDataFlow enumeration to a string representation.
-	 * @param dataflow	An EDataFlow enum value.
-	 * @returns			std::string
-	 */
-	constexpr std::string DataFlowToString(EDataFlow const& dataflow)
-	{
-		switch (dataflow) {
-		case EDataFlow::eRender:
-			return "Output";
-		case EDataFlow::eCapture:
-			return "Input";
-		case EDataFlow::eAll:
-			return "In/Out";
-		default:
-			return{};
-		}
-	}
+#endif
 }
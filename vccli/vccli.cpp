@@ -1,9 +1,28 @@
 ﻿#include "rc/version.h"
 #include "AudioAPI.hpp"
+#include "QueryPlanner.hpp"
+#include "CoreAudioBackend.hpp"
+#include "SimulatedBackend.hpp"
+#include "IPC.hpp"
+#include "Batch.hpp"
+#include "ThreadPool.hpp"
+#include "AudioWatcher.hpp"
+#include "FadeScheduler.hpp"
+#include "RecordWriter.hpp"
+#include "Output.hpp"
+#include "Arguments.hpp"
 
 #include <TermAPI.hpp>
 #include <opt3.hpp>
 
+#ifdef OS_WIN
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
 #include <typeinfo>
 
 struct PrintHelp {
@@ -14,7 +33,7 @@ struct PrintHelp {
 			<< "  Volume Control CLI allows you to control audio endpoints (Devices) & audio sessions (Sessions) from the commandline.\n"
 			<< '\n'
 			<< "USAGE:\n"
-			<< "  vccli [TARGET] [OPTIONS]" << '\n'
+			<< "  vccli [TARGET...] [OPTIONS]" << '\n'
 			<< '\n'
 			<< "  The '[TARGET]' field determines which device or session to target with commands, and accepts a variety of inputs:" << '\n'
 			<< "    - Device ID                    (DGUID)      Selects an audio device using the string representation of its GUID." << '\n'
@@ -25,8 +44,11 @@ struct PrintHelp {
 			<< "    - Session Instance Identifier  (SGUID)      Selects a specific audio session using its Session Instance Identifier." << '\n'
 			<< "    - Blank                                     Gets the default audio endpoint for the type specified by '-d'|'--dev'." << '\n'
 			<< '\n'
+			<< "  Any number of TARGETs can be specified; they're all resolved from one enumeration, and the options are applied to" << '\n'
+			<< "   everything that any of them selected.  TARGETs that didn't select anything are reported before the output." << '\n'
+			<< '\n'
 			<< "  Certain device endpoint names (DNAME) that are built-in to Windows contain trailing whitespace, such as" << '\n'
-			<< "   'USB Audio Codec '; keep this in mind when searching for devices by name, and/or use the ('-f'|'--fuzzy') option." << '\n'
+			<< "   'USB Audio Codec '; whitespace surrounding the TARGET & the names it is compared to is ignored." << '\n'
 			<< '\n'
 			<< "OPTIONS:\n"
 			<< "  -h, --help                   Shows this help display, then exits." << '\n'
@@ -35,19 +57,66 @@ struct PrintHelp {
 			<< "  -n, --no-color               Disables ANSI color sequences; this option is implied when '-q'|'--quiet' is specified." << '\n'
 			<< "  -d, --dev <i|o>              Selects input or output devices.  When targeting an endpoint, this determines the type" << '\n'
 			<< "                                of device to use; when targeting a session, limits the search to devices of this type." << '\n'
-			<< "  -f, --fuzzy                  Fuzzy search; allows partial matches instead of requiring a full match." << '\n'
+			<< "  -f, --fuzzy                  Fuzzy search; allows partial matches & typos instead of requiring a full match.  Names" << '\n'
+			<< "                                are ranked by how closely they match, and only the best match is selected." << '\n'
+			<< "      --fuzzy-limit <N>        Selects the N best matching names (or IDs) when using '-f'|'--fuzzy', or every match" << '\n'
+			<< "                                when N is 0.  Defaults to 1." << '\n'
 			<< "  -e, --extended               Shows additional fields when used with the query or list options." << '\n'
+			<< "      --format <FORMAT>        Sets the output format of the query, list & watch options; 'text' (default), 'ndjson'" << '\n'
+			<< "                                (one JSON object per line), or 'binary' (length-prefixed records)." << '\n'
+			<< "      --simulate <DxS[:US]>    Uses a simulated audio system with D devices & S sessions per device instead of the real" << '\n'
+			<< "                                one.  US is an optional latency (in microseconds) to add to each call.  (For testing)" << '\n'
+			<< "      --batch <FILE|->         Executes each line of FILE (or STDIN when '-' is specified) as a separate command, with" << '\n'
+			<< "                                all targets resolved from one enumeration.  Each line contains a TARGET & OPTIONS, and" << '\n'
+			<< "                                is followed by a status line:  'LINE;0' on success, or 'LINE;1;MESSAGE' on failure." << '\n'
+			<< "      --trace <FILE>           Records how long each phase & backend call takes, and writes them to FILE as Chrome" << '\n'
+			<< "                                trace JSON when vccli exits.  Open FILE with chrome://tracing or ui.perfetto.dev." << '\n'
+			<< "      --device-cache           Reads device names from a cache file instead of from each device.  The cache is checked" << '\n'
+			<< "                                against the devices that exist, & rebuilt when one was added or removed.  Use" << '\n'
+			<< "                                '--refresh' to pick up a device that was renamed." << '\n'
+			<< "      --cache-file <FILE>      Sets the path of the device cache file & implies '--device-cache'.  Defaults to" << '\n'
+			<< "                                '%LOCALAPPDATA%\\vccli\\devices.cache'." << '\n'
+			<< "      --explain                Prints how the TARGET was resolved & how many backend calls it took, before the output" << '\n'
+			<< "                                of the command.  IDs are resolved without enumerating everything when possible." << '\n'
+			<< '\n'
+			<< "      --watch                  Streams changes to the volume & mute state of the target (or of everything when there is" << '\n'
+			<< "                                no target) as they happen, one line per change, until interrupted.  Sessions that are" << '\n'
+			<< "                                created or expire are reported too.  Lines are 'NAME=VALUE' fields separated by ';'." << '\n'
+			<< '\n'
+			<< "OPTIONS - Daemon:\n"
+			<< "      --daemon                 Runs in the background & serves commands sent by '--client' until '--shutdown' is sent." << '\n'
+			<< "                                The daemon keeps devices & sessions warm between commands, which makes them faster." << '\n'
+			<< "      --client                 Sends the rest of the commandline to the daemon instead of executing it directly." << '\n'
+			<< "      --ipc <NAME>             Overrides the name of the pipe/socket used by '--daemon' & '--client'." << '\n'
+			<< "      --refresh                Rebuilds the device cache, & (with '--client') discards the daemon's cached devices &" << '\n'
+			<< "                                sessions, before executing the command." << '\n'
+			<< "      --shutdown               (Client) Stops the daemon." << '\n'
 			<< '\n'
 			<< "OPTIONS - Modes, Getters, & Setters:\n"
 			<< "  -Q, --query                  Shows information about the specified TARGET if it exists; otherwise shows an error." << '\n'
 			<< "  -l, --list                   Prints a list (sorted by PID) of all processes with an active audio session, then exits." << '\n'
 			<< "  -L, --list-dev               Prints a list of all audio endpoints that aren't unplugged or disabled, then exits." << '\n'
+			<< "      --sort <KEYS>            Sets the order of '-l'|'--list' & '-L'|'--list-dev' to a comma-separated list of keys;" << '\n'
+			<< "                                'pid', 'name', 'device', 'io', 'default', 'volume' & 'muted'.  Prefix a key with '-'" << '\n'
+			<< "                                to reverse it.  Rows with equal keys keep their order.  Defaults to 'io,pid' for" << '\n'
+			<< "                                sessions & 'io,name' for devices; without it, '--format' lists aren't sorted." << '\n'
+			<< "      --stream                 Prints the rows of '-l'|'--list' & '-L'|'--list-dev' as soon as they're enumerated," << '\n'
+			<< "                                in enumeration order, instead of sorting the whole list first.  Can't be combined" << '\n'
+			<< "                                with '--sort'." << '\n'
+			<< "      --where <FILTER>         Only selects (or lists) the devices & sessions that match FILTER; without a TARGET, the" << '\n'
+			<< "                                options are applied to everything that matches.  FILTER compares the fields 'type'," << '\n'
+			<< "                                'pid', 'pname', 'dname', 'dguid', 'suid', 'sguid', 'flow', 'default', 'volume' &" << '\n'
+			<< "                                'muted' with '==', '!=', '<', '<=', '>', '>=', '~' (contains) or '!~', & combines" << '\n'
+			<< "                                them with '&&', '||', '!' & parentheses.  Example:  'flow==in && volume<50'" << '\n'
 			<< "  -v, --volume [0-100]         Gets or sets (when a number is specified) the volume of the target." << '\n'
 			<< "  -I, --increment <0-100>      Increments the volume of the target by the specified number." << '\n'
 			<< "  -D, --decrement <0-100>      Decrements the volume of the target by the specified number." << '\n'
 			<< "  -m, --is-muted [true|false]  Gets or sets (when a boolean is specified) the mute state of the target." << '\n'
 			<< "  -M, --mute                   Mutes the target.    (Equivalent to '-m=true'|'--is-muted=true')" << '\n'
 			<< "  -U, --unmute                 Unmutes the target.  (Equivalent to '-m=false'|'--is-muted=false')" << '\n'
+			<< "      --fade <0-100>           Gradually changes the volume of the target to the specified number." << '\n'
+			<< "      --over <DURATION>        Sets the length of '--fade', in 'ms' (default), 's', or 'm'.  Defaults to '500ms'." << '\n'
+			<< "      --curve <CURVE>          Sets the shape of '--fade'; 'linear' (default), 'log', or 'scurve'." << '\n'
 			;
 	}
 };
@@ -55,354 +124,894 @@ struct PrintHelp {
 // Define exception type "except_showhelp":
 $DefineExcept(showhelp)
 
-// Globals:
-static bool quiet{ false };
-static bool extended{ false };
-
-enum class COLOR {
-	HEADER,
-	VALUE,
-	HIGHLIGHT,
-	LOWLIGHT,
-	WARN,
-	ERR,
-	DEVICE,
-	SESSION,
-	INPUT,
-	OUTPUT,
-};
-term::palette<COLOR> colors{
-	std::make_pair(COLOR::HEADER, term::setcolor(term::make_sequence(color::FormatFlag::Bold))),
-	std::make_pair(COLOR::VALUE, color::setcolor(1, 4, 1)),
-	std::make_pair(COLOR::HIGHLIGHT, color::cyan),
-	std::make_pair(COLOR::LOWLIGHT, color::light_gray),
-	std::make_pair(COLOR::WARN, color::yellow),
-	std::make_pair(COLOR::ERR, color::orange),
-	std::make_pair(COLOR::DEVICE, color::setcolor(term::make_sequence(color::setcolor(color::lighter_purple), color::FormatFlag::Bold))),
-	std::make_pair(COLOR::SESSION, color::light_blue),
-	std::make_pair(COLOR::INPUT, color::pink),
-	std::make_pair(COLOR::OUTPUT, color::setcolor(4, 4, 0)),
-};
-size_t MARGIN_WIDTH{ 12ull };
-
 // Forward Declarations:
-inline std::string getTargetAndValidateParams(const opt3::ArgManager&);
+inline std::vector<std::string> getTargets(const opt3::ArgManager&);
 inline EDataFlow getTargetDataFlow(const opt3::ArgManager&);
-inline void handleVolumeArgs(const opt3::ArgManager&, const vccli::Volume*);
-inline void handleMuteArgs(const opt3::ArgManager&, const vccli::Volume*);
+inline size_t getFuzzyLimit(const opt3::ArgManager&);
+inline std::shared_ptr<vccli::AudioBackend> makeBackend(const opt3::ArgManager&);
+inline void handleVolumeArgs(const opt3::ArgManager&, const vccli::Volume*, std::ostream&);
+inline void handleMuteArgs(const opt3::ArgManager&, const vccli::Volume*, std::ostream&);
 
 
 /**
- * @struct	VolumeObjectPrinter
- * @brief	Stream functor that pretty-prints a vccli::Volume object.
+ * @struct	CommandContext
+ * @brief	State that is shared between all of the commands executed by this process.
+ *\n		In daemon mode this keeps the snapshot & the activated volume objects warm between requests.
  */
-struct VolumeObjectPrinter {
-	vccli::Volume* obj;
+struct CommandContext {
+	/// @brief	The cache of device names that snapshots are captured with, when '--device-cache' is specified.
+	std::unique_ptr<vccli::DeviceCache> deviceCache;
+	std::unique_ptr<vccli::AudioSnapshot> snapshot;
+	/// @brief	Activated volume objects, keyed by the flow filter, fuzzy limit & target string that they were resolved from.
+	std::unordered_map<std::string, std::vector<std::unique_ptr<vccli::Volume>>> objects;
+	/// @brief	The targets that didn't match anything, for each key in objects that was resolved from several targets.
+	std::unordered_map<std::string, std::vector<std::string>> unmatchedTargets;
+	/// @brief	True when the snapshot was captured before the current command started.
+	bool snapshotIsStale{ false };
 
 	/**
-	 * @brief		Creates a new VolumeObjectPrinter instance with the given Volume object pointer.
-	 * @param obj	A pointer to a valid Volume object to print.
+	 * @struct	Resolution
+	 * @brief	Describes how the most recent call to resolve() found its targets.  (See '--explain')
 	 */
-	constexpr VolumeObjectPrinter(vccli::Volume* obj) : obj{ obj } {}
+	struct Resolution {
+		vccli::QueryPlan plan{ "", false };
+		/// @brief	What resolve() actually did; this is different from the plan when the plan needed a snapshot or didn't find anything.
+		std::string_view method;
+		/// @brief	The number of backend calls that resolve() made.
+		size_t backendCalls{ 0 };
+		/// @brief	The number of targets that were resolved; the plan is only used when there is one.
+		size_t targetCount{ 1 };
+	} lastResolution;
+	/// @brief	Worker threads used to apply commands to multiple targets at once.
+	std::unique_ptr<vccli::ThreadPool> pool;
 
-	friend std::ostream& operator<<(std::ostream& os, const VolumeObjectPrinter& p)
+	/// @brief	The maximum number of targets that are applied to concurrently.
+	static constexpr size_t MAX_APPLY_THREADS{ 32 };
+	/// @brief	The maximum number of keys in objects; the cache is emptied when a new key would exceed this.
+	static constexpr size_t MAX_CACHED_TARGETS{ 64 };
+
+	/// @brief	Gets the thread pool, creating it if necessary.
+	vccli::ThreadPool& getPool()
 	{
-		if (p.obj) {
-			const bool is_session{ p.obj->is_derived_type<vccli::ApplicationVolume>() }, is_device{ !is_session };
-
-			if (quiet) {
-				if (extended) {
-					os
-						<< (is_session ? 'P' : 'D') << "NAME: " << p.obj->resolved_name << '\n'
-						<< (is_session ? "P" : "DGU") << "ID: " << p.obj->identifier << '\n'
-						<< "TYPENAME: " << p.obj->type_name().value() << '\n'
-						<< "DATAFLOW: " << p.obj->getFlowTypeName() << '\n'
-						<< "VOLUME: " << p.obj->getVolumeScaled() << '\n'
-						<< "IS_MUTED: " << std::boolalpha << p.obj->getMuted() << std::noboolalpha << '\n'
-						;
-					if (is_session) {
-						auto* app = (vccli::ApplicationVolume*)p.obj;
-						os
-							<< "SUID: " << app->sessionIdentifier << '\n'
-							<< "SGUID: " << app->sessionInstanceIdentifier << '\n';
-					}
-					else if (is_device)
-						os << "IS_DEFAULT: " << std::boolalpha << ((vccli::EndpointVolume*)p.obj)->isDefault << std::noboolalpha << '\n';
-				}
-				else os << p.obj->type_name().value_or("null");
+		if (!pool)
+			pool = std::make_unique<vccli::ThreadPool>(MAX_APPLY_THREADS);
+		return *pool;
+	}
+
+	/// @brief	Timer thread that drives all active fades.
+	std::unique_ptr<vccli::FadeScheduler> fadeScheduler;
+
+	/// @brief	Gets the fade scheduler, creating it if necessary.
+	vccli::FadeScheduler& getFadeScheduler()
+	{
+		if (!fadeScheduler)
+			fadeScheduler = std::make_unique<vccli::FadeScheduler>(std::chrono::milliseconds{ 10 }, &getPool());
+		return *fadeScheduler;
+	}
+
+	/**
+	 * @brief						Discards all of the cached state & captures a new snapshot.
+	 * @param rebuildDeviceCache	When true, the device cache is rebuilt too, which picks up devices that were renamed.
+	 */
+	void refresh(const bool rebuildDeviceCache = false)
+	{
+		$trace("CommandContext::refresh");
+		objects.clear();
+		unmatchedTargets.clear();
+		if (rebuildDeviceCache && deviceCache)
+			deviceCache->invalidate();
+		// devices are enumerated on the pool, since each one has to be activated & enumerated separately
+		snapshot = std::make_unique<vccli::AudioSnapshot>(vccli::AudioAPI::getBackend(), deviceCache.get(), &getPool());
+		snapshotIsStale = false;
+	}
+	/**
+	 * @brief				Gets the current snapshot, capturing one if necessary.
+	 * @param requireFresh	When true, a snapshot that was captured by a previous command is replaced.
+	 */
+	const vccli::AudioSnapshot& getSnapshot(const bool requireFresh = false)
+	{
+		if (!snapshot || (requireFresh && snapshotIsStale))
+			refresh();
+		return *snapshot;
+	}
+	/**
+	 * @brief		Finds the cached volume objects with the given key, for resolve().
+	 *\n			When one of them is a session that expired since it was resolved, the snapshot is out of date too, so it's
+	 *				 refreshed & nothing is returned.  When the key isn't cached & the cache is full, the cache is emptied.
+	 * @returns		An iterator to the cached objects; or objects.end() when they have to be resolved.
+	 */
+	auto findCached(std::string const& key)
+	{
+		auto it{ objects.find(key) };
+		if (it == objects.end()) {
+			if (objects.size() >= MAX_CACHED_TARGETS) {
+				objects.clear();
+				unmatchedTargets.clear();
 			}
-			else {
-				const auto& typecolor{ is_session ? COLOR::SESSION : COLOR::DEVICE };
-				os
-					<< "              " << colors(typecolor) << p.obj->resolved_name << colors() << '\n'
-					<< "Typename:     " << colors(typecolor) << p.obj->type_name().value_or("null") << colors();
-				if (is_device && ((vccli::EndpointVolume*)p.obj)->isDefault) os << ' ' << colors(COLOR::LOWLIGHT) << "(Default)" << colors() << '\n';
-				if (is_session)
-					os << '\n'
-					<< "PID:          " << colors(COLOR::LOWLIGHT) << p.obj->identifier << colors() << '\n';
-				os
-					<< "Direction:    " << colors(p.obj->flow_type == EDataFlow::eRender ? COLOR::OUTPUT : COLOR::INPUT) << p.obj->getFlowTypeName() << colors() << '\n'
-					<< "Volume:       " << colors(COLOR::VALUE) << p.obj->getVolumeScaled() << colors() << '\n'
-					<< "Muted:        " << colors(COLOR::VALUE) << std::boolalpha << p.obj->getMuted() << std::noboolalpha << colors() << '\n'
-					;
-
-				if (extended) {
-					if (is_session) {
-						auto* app{ (vccli::ApplicationVolume*)p.obj };
-						os
-							<< "Session ID:   " << colors(COLOR::VALUE) << app->sessionIdentifier << colors() << '\n'
-							<< "Instance ID:  " << colors(COLOR::VALUE) << app->sessionInstanceIdentifier << colors() << '\n'
-							;
-					}
+			return objects.end();
+		}
+		if (std::any_of(it->second.begin(), it->second.end(), [](auto&& obj) {
+			const auto* app{ dynamic_cast<const vccli::ApplicationVolume*>(obj.get()) };
+			return app != nullptr && app->isExpired();
+		})) {
+			refresh();
+			return objects.end();
+		}
+		return it;
+	}
+	/**
+	 * @brief				Gets the volume objects that match the given target, activating them if they aren't cached yet.
+	 *\n					When nothing matches & the snapshot is stale, a new snapshot is captured & the target is resolved again.
+	 *\n					Cached objects are checked first, & resolved again when one of them is a session that expired.
+	 * @param fuzzyLimit	The number of names that a fuzzy search selects; see AudioAPI::getObjects.
+	 * @returns				Pointers to the matching volume objects. These remain valid until the next refresh.
+	 */
+	std::vector<vccli::Volume*> resolve(std::string const& target, const bool fuzzy, const EDataFlow flow, const size_t fuzzyLimit = vccli::AudioAPI::DEFAULT_FUZZY_LIMIT)
+	{
+		$trace("CommandContext::resolve");
+		const std::string key{ std::to_string(static_cast<int>(flow)) + (fuzzy ? 'f' + std::to_string(fuzzyLimit) + ':' : std::string{ 'e' }) + target };
+
+		auto& backend{ vccli::AudioAPI::getBackend() };
+		const auto callsBefore{ backend.getCallCount() };
+		lastResolution.plan = vccli::QueryPlan{ target, fuzzy };
+		lastResolution.method = "cached volume objects";
+		lastResolution.targetCount = 1;
+
+		auto it{ findCached(key) };
+		if (it == objects.end() || it->second.empty()) {
+			std::vector<std::unique_ptr<vccli::Volume>> found;
+			// Until something needs a snapshot, targets that are IDs are cheaper to resolve with a plan
+			if (!snapshot && !lastResolution.plan.needsSnapshot()) {
+				lastResolution.method = vccli::QueryPlan::toString(lastResolution.plan.strategy);
+				found = lastResolution.plan.execute(backend, flow);
+			}
+			if (found.empty()) {
+				lastResolution.method = vccli::QueryPlan::toString(vccli::QueryPlan::Strategy::Snapshot);
+				found = vccli::AudioAPI::getObjects(getSnapshot(), target, fuzzy, flow, true, fuzzyLimit);
+				if (found.empty() && snapshotIsStale) {
+					refresh();
+					found = vccli::AudioAPI::getObjects(getSnapshot(), target, fuzzy, flow, true, fuzzyLimit);
 				}
 			}
+			it = objects.insert_or_assign(key, std::move(found)).first;
 		}
-		return os;
+		lastResolution.backendCalls = backend.getCallCount() - callsBefore;
+
+		std::vector<vccli::Volume*> vec;
+		vec.reserve(it->second.size());
+		for (const auto& obj : it->second)
+			vec.emplace_back(obj.get());
+		return vec;
 	}
-};
+	/**
+	 * @brief				Gets the volume objects that match any of the given targets, resolving all of them against one snapshot.
+	 *\n					When some of the targets don't match anything & the snapshot is stale, a new snapshot is captured & the
+	 *						 targets are resolved again.  Expired sessions are handled like they are by the other overload.
+	 * @param unmatched		Receives the targets that didn't match anything.
+	 * @param filter		When not nullptr, only the devices & sessions that match the filter are selected.  When the only target
+	 *						 is blank, everything that matches the filter is selected instead of the default device.
+	 * @returns				Pointers to the union of the matching volume objects. These remain valid until the next refresh.
+	 */
+	std::vector<vccli::Volume*> resolve(std::vector<std::string> const& targets, const bool fuzzy, const EDataFlow flow, const size_t fuzzyLimit, std::vector<std::string>& unmatched, vccli::Filter const* filter = nullptr)
+	{
+		if (targets.size() == 1 && !filter) {
+			auto vec{ resolve(targets.front(), fuzzy, flow, fuzzyLimit) };
+			unmatched.clear();
+			if (vec.empty())
+				unmatched = targets;
+			return vec;
+		}
 
-namespace vccli_operators {
-	inline constexpr auto SEP{ ';' };
-	inline constexpr auto COLSZ_DNAME{ 30 };
-	inline constexpr auto COLSZ_DGUID{ 57 };
-	inline constexpr auto COLSZ_IO{ 9 };
-	inline constexpr auto COLSZ_DEFAULT{ 9 };
+		$trace("CommandContext::resolve");
+		std::string key{ std::to_string(static_cast<int>(flow)) + (fuzzy ? 'f' + std::to_string(fuzzyLimit) + ':' : std::string{ 'e' }) };
+		for (const auto& target : targets)
+			(key += '\n') += target; //< targets can't contain newlines, since batch lines can't
+		if (filter)
+			(key += "\nwhere ") += filter->getExpression();
+		const bool selectByFilter{ filter && targets.size() == 1 && targets.front().empty() };
+		// the volume & mute state can change between commands, so a filter that tests them is evaluated again every time
+		const bool isVolatile{ filter && (filter->uses(vccli::FilterField::VOLUME) || filter->uses(vccli::FilterField::MUTED)) };
+		const auto& find{ [&]() {
+			if (selectByFilter)
+				return vccli::AudioAPI::TargetSetObjects{ vccli::AudioAPI::getObjectsWhere(getSnapshot(), *filter, flow), {} };
+			return vccli::AudioAPI::getObjectsForTargets(getSnapshot(), targets, fuzzy, flow, true, fuzzyLimit, filter);
+		} };
 
-	inline std::ostream& operator<<(std::ostream& os, const vccli::DeviceInfo& di)
-	{ // DEVICE INFO
-		using namespace vccli;
+		auto& backend{ vccli::AudioAPI::getBackend() };
+		const auto callsBefore{ backend.getCallCount() };
+		lastResolution.plan = vccli::QueryPlan{ "", fuzzy };
+		lastResolution.method = "cached volume objects";
+		lastResolution.targetCount = targets.size();
 
+		auto it{ findCached(key) };
+		if (it == objects.end() || it->second.empty() || unmatchedTargets.contains(key) || isVolatile) {
+			lastResolution.method = vccli::QueryPlan::toString(vccli::QueryPlan::Strategy::Snapshot);
+			auto found{ find() };
+			if ((found.objects.empty() || !found.unmatched.empty()) && snapshotIsStale) {
+				refresh();
+				found = find();
+			}
+			if (found.unmatched.empty())
+				unmatchedTargets.erase(key);
+			else unmatchedTargets.insert_or_assign(key, std::move(found.unmatched));
+			it = objects.insert_or_assign(key, std::move(found.objects)).first;
+		}
+		lastResolution.backendCalls = backend.getCallCount() - callsBefore;
+
+		if (const auto& unmatchedIt{ unmatchedTargets.find(key) }; unmatchedIt != unmatchedTargets.end())
+			unmatched = unmatchedIt->second;
+		else unmatched.clear();
+
+		std::vector<vccli::Volume*> vec;
+		vec.reserve(it->second.size());
+		for (const auto& obj : it->second)
+			vec.emplace_back(obj.get());
+		return vec;
+	}
+};
+
+/// @brief	Prints how a target was resolved, for '--explain'.
+inline void printResolution(CommandContext::Resolution const& resolution, std::ostream& os)
+{
+	using vccli::QueryPlan;
+	if (resolution.targetCount > 1) {
+		// every target is resolved through one snapshot, so there's no plan to show
 		if (quiet) {
 			os
-				<< di.dname << SEP
-				<< DataFlowToString(di.flow) << SEP
-				<< std::boolalpha << di.isDefault << std::noboolalpha;
-			if (extended)
-				os << SEP << di.dguid;
+				<< "TARGETS: " << resolution.targetCount << '\n'
+				<< "RESOLVED_BY: " << resolution.method << '\n'
+				<< "BACKEND_CALLS: " << resolution.backendCalls << '\n';
+			return;
 		}
-		else {
-			const auto& flow_s{ DataFlowToString(di.flow) };
-			const auto& def_s{ str::stringify(std::boolalpha, di.isDefault) };
-			os
-				<< colors(COLOR::DEVICE) << di.dname << colors() << indent(COLSZ_DNAME, di.dname.size())
-				<< colors(COLOR::VALUE) << flow_s << colors() << indent(COLSZ_IO, flow_s.size())
-				<< colors(COLOR::LOWLIGHT) << def_s << colors();
-			if (extended) os
-				<< indent(COLSZ_DEFAULT, def_s.size()) << di.dguid;
+		os
+			<< "Targets:      " << colors(COLOR::HIGHLIGHT) << resolution.targetCount << colors() << '\n'
+			<< "Resolved By:  " << colors(COLOR::VALUE) << resolution.method << colors() << '\n'
+			<< "Calls:        " << colors(COLOR::VALUE) << resolution.backendCalls << colors() << '\n'
+			<< '\n';
+		return;
+	}
+	if (quiet) {
+		os
+			<< "TARGET_KIND: " << QueryPlan::toString(resolution.plan.kind) << '\n'
+			<< "PLAN: " << QueryPlan::toString(resolution.plan.strategy) << '\n'
+			<< "RESOLVED_BY: " << resolution.method << '\n'
+			<< "AT_MOST_ONE: " << std::boolalpha << resolution.plan.atMostOne << std::noboolalpha << '\n'
+			<< "BACKEND_CALLS: " << resolution.backendCalls << '\n';
+		return;
+	}
+	os
+		<< "Target Kind:  " << colors(COLOR::HIGHLIGHT) << QueryPlan::toString(resolution.plan.kind) << colors() << '\n'
+		<< "Plan:         " << colors(COLOR::VALUE) << QueryPlan::toString(resolution.plan.strategy) << colors();
+	if (resolution.plan.atMostOne) os << ' ' << colors(COLOR::LOWLIGHT) << "(stops at the first match)" << colors();
+	os << '\n';
+	if (resolution.method != QueryPlan::toString(resolution.plan.strategy))
+		os << "Resolved By:  " << colors(COLOR::WARN) << resolution.method << colors() << '\n';
+	os
+		<< "Calls:        " << colors(COLOR::VALUE) << resolution.backendCalls << colors() << '\n'
+		<< '\n';
+}
+
+/// @brief	Prints the targets that didn't match anything, when some of the targets of a command did.
+inline void printUnmatched(std::vector<std::string> const& unmatched, std::ostream& os)
+{
+	using vccli::Field;
+	if (format != vccli::OutputFormat::Text) {
+		vccli::RecordWriter writer{ os, format };
+		for (const auto& target : unmatched)
+			writer.begin().field(Field::TYPENAME, "Unmatched").field(Field::TARGET, target).end();
+		return;
+	}
+	for (const auto& target : unmatched) {
+		if (quiet) os << "UNMATCHED: " << target << '\n';
+		else os << "No Matches:" << indent(MARGIN_WIDTH, 11ull) << colors(COLOR::ERR) << target << colors() << '\n';
+	}
+}
+
+/// @brief	Applies the output-related arguments (quiet, no-color & extended) to the global output state.
+inline void applyOutputArgs(const opt3::ArgManager& args)
+{
+	quiet = args.check_any<opt3::Flag, opt3::Option>('q', "quiet");
+	colors.setActive(!quiet && !args.check_any<opt3::Flag, opt3::Option>('n', "no-color"));
+	extended = args.check_any<opt3::Flag, opt3::Option>('e', "extended");
+	format = vccli::ParseOutputFormat(args.getv_any<opt3::Option>("format").value_or("text"));
+}
+
+/**
+ * @brief		Calls the given function & prints any exceptions that it throws to the given stream.
+ * @param err	The stream to print error messages to.
+ * @param func	The function to call.
+ * @returns		0 when the function returned normally; otherwise 1.
+ */
+template<std::invocable F>
+inline int catchExceptions(std::ostream& err, F&& func)
+{
+	try {
+		func();
+		return 0;
+	} catch (const showhelp& ex) {
+		err << PrintHelp{} << '\n' << colors.get_fatal() << ex.what() << '\n';
+	} catch (const std::exception& ex) {
+		err << colors.get_fatal() << ex.what() << '\n';
+	} catch (...) {
+		err << colors.get_fatal() << "An undefined exception occurred!" << '\n';
+	}
+	return 1;
+}
+
+/**
+ * @brief		Executes the command specified by the given arguments.
+ * @param args	The parsed arguments of the command.
+ * @param ctx	The command context to resolve targets with.
+ * @param os	The stream to write output to.
+ */
+inline void executeCommand(const opt3::ArgManager& args, CommandContext& ctx, std::ostream& os)
+{
+	using namespace vccli;
+	$trace("executeCommand");
+
+	// Get the target strings
+	const auto& targets{ getTargets(args) };
+	EDataFlow flow{ getTargetDataFlow(args) };
+
+	const bool
+		listSessions{ args.check_any<opt3::Flag, opt3::Option>('l', "list") },
+		listDevices{ args.check_any<opt3::Flag, opt3::Option>('L', "list-dev") };
+
+	// --where
+	std::optional<Filter> where;
+	if (const auto& expression{ args.getv_any<opt3::Option>("where") }; expression.has_value())
+		where.emplace(expression.value());
+	// lists apply the filter to their rows instead of to the targets
+	const Filter* selector{ listSessions || listDevices || !where.has_value() ? nullptr : &where.value() };
+
+	// Get controllers:
+	std::vector<std::string> unmatched;
+	const auto& targetControllers{ ctx.resolve(targets, args.check_any<opt3::Flag, opt3::Option>('f', "fuzzy"), flow, getFuzzyLimit(args), unmatched, selector) };
+
+	// --explain
+	if (args.check_any<opt3::Option>("explain"))
+		printResolution(ctx.lastResolution, os);
+
+	if (targetControllers.empty() && selector && targets.size() == 1 && targets.front().empty())
+		throw make_exception(
+			"Couldn't locate anything matching the given filter!\n",
+			indent(10), colors(COLOR::HEADER), "Filter", colors(), ":         ", colors(COLOR::ERR), selector->getExpression(), colors(), '\n',
+			indent(10), colors(COLOR::HEADER), "Device Filter", colors(), ":  ", colors(COLOR::ERR), DataFlowToString(flow), colors()
+		);
+	else if (targetControllers.empty())
+		throw make_exception(
+			"Couldn't locate anything matching the given search term", (targets.size() == 1 ? "" : "s"), "!\n",
+			indent(10), colors(COLOR::HEADER), "Search Term", colors(), ":    ", colors(COLOR::ERR), str::join(targets, ", "), colors(), '\n',
+			indent(10), colors(COLOR::HEADER), "Device Filter", colors(), ":  ", colors(COLOR::ERR), DataFlowToString(flow), colors()
+		);
+	// Report the targets that didn't match anything; the command is still applied to the rest
+	if (!unmatched.empty())
+		printUnmatched(unmatched, os);
+
+	// -Q | --query
+	if (args.check_any<opt3::Flag, opt3::Option>('Q', "query")) {
+		$trace("print");
+		if (format != OutputFormat::Text) {
+			RecordWriter writer{ os, format };
+			for (const auto& it : targetControllers)
+				writeRecord(writer, it);
+			return;
+		}
+		bool fst{ true };
+		for (const auto& it : targetControllers) {
+			if (fst) fst = false;
+			else os << '\n';
+			os << VolumeObjectPrinter(it);
+		}
+	}
+	// list
+	else if (listSessions || listDevices) {
+		// --sort
+		std::optional<std::vector<SortKey>> sortKeys;
+		if (const auto& sort{ args.getv_any<opt3::Option>("sort") }; sort.has_value())
+			sortKeys = ParseSortKeys(sort.value());
+		const Filter* filter{ where.has_value() ? &where.value() : nullptr };
+		// --stream
+		if (args.check_any<opt3::Option>("stream")) {
+			if (sortKeys.has_value())
+				throw make_exception("'--stream' can't be combined with '--sort'!");
+			$trace("print");
+			// rows are read straight from the backend, so there's no snapshot to wait for
+			auto& backend{ AudioAPI::getBackend() };
+			if (format != OutputFormat::Text) {
+				RecordWriter writer{ os, format };
+				if (listSessions)
+					streamSessionRecords(writer, backend, flow, filter);
+				if (listDevices)
+					streamDeviceRecords(writer, backend, flow, filter);
+				return;
+			}
+			if (listSessions) {
+				streamSessionList(os, backend, flow, filter);
+				if (listDevices) os << '\n';
+			}
+			if (listDevices)
+				streamDeviceList(os, backend, flow, filter);
+			return;
+		}
+		const auto& snapshot{ ctx.getSnapshot(true) };
+		// read every row's properties on the pool up front; unless there's a filter, which avoids reading most of them
+		if (filter == nullptr)
+			snapshot.prefetch(ctx.getPool(), flow, extended || format != OutputFormat::Text);
+		$trace("print");
+		if (format != OutputFormat::Text) {
+			RecordWriter writer{ os, format };
+			if (sortKeys.has_value()) {
+				if (listSessions)
+					writeSessionRecords(writer, AudioAPI::GetAllAudioProcessesSorted(snapshot, sortKeys.value(), flow, true, filter));
+				if (listDevices)
+					writeDeviceRecords(writer, AudioAPI::GetAllAudioDevicesSorted(snapshot, sortKeys.value(), flow, filter));
+				return;
+			}
+			// stream the records straight from the snapshot, in enumeration order
+			if (listSessions)
+				writeSessionRecords(writer, snapshot, flow, filter);
+			if (listDevices)
+				writeDeviceRecords(writer, snapshot, flow, filter);
+			return;
 		}
-		return os;
+		// -l | --list
+		if (listSessions) {
+			os << make_printable_list(AudioAPI::GetAllAudioProcessesSorted(snapshot, sortKeys.value_or(AudioAPI::DEFAULT_SESSION_SORT), flow, extended, filter));
+			if (listDevices) os << '\n';
+		}
+		// -L | --list-dev
+		if (listDevices)
+			os << make_printable_list(AudioAPI::GetAllAudioDevicesSorted(snapshot, sortKeys.value_or(AudioAPI::DEFAULT_DEVICE_SORT), flow, filter));
 	}
+	// --fade
+	else if (const auto& fade{ args.getv_any<opt3::Option>("fade") }; fade.has_value()) {
+		const auto& value{ fade.value() };
+		if (value.empty() || !std::all_of(value.begin(), value.end(), str::stdpred::isdigit))
+			throw make_exception("Invalid Number Specified:  ", value);
+		const float tgtVolume{ std::clamp(str::stof(value), 0.0f, 100.0f) };
+		const auto& duration{ ParseDuration(args.getv_any<opt3::Option>("over").value_or("500ms")) };
+		const auto& curve{ ParseFadeCurve(args.getv_any<opt3::Option>("curve").value_or("linear")) };
+		$trace("fade");
 
-	inline constexpr auto COLSZ_PNAME{ 24 };
-	inline constexpr auto COLSZ_PID{ 10 };
+		// Start all of the fades at once, then wait for them to finish
+		auto& scheduler{ ctx.getFadeScheduler() };
+		std::vector<std::future<void>> fades;
+		fades.reserve(targetControllers.size());
+		for (const auto& it : targetControllers)
+			fades.emplace_back(scheduler.fade(it, tgtVolume / 100.0f, duration, curve));
+		for (auto& it : fades)
+			it.wait();
 
-	inline std::ostream& operator<<(std::ostream& os, const vccli::ProcessInfo& pi)
-	{ // PROCESS INFO
-		using namespace vccli;
+		if (!quiet) os << "Volume =" << indent(MARGIN_WIDTH, 8ull) << colors(COLOR::VALUE) << static_cast<int>(tgtVolume) << colors() << '\n';
+	}
+	// Non-blocking options:
+	else if (targetControllers.size() == 1) {
+		$trace("apply");
+		// Handle Volume Args:
+		handleVolumeArgs(args, targetControllers.front(), os);
 
-		if (quiet) {
-			os
-				<< pi.pid << SEP
-				<< pi.pname << SEP
-				;
+		// Handle Mute Args:
+		handleMuteArgs(args, targetControllers.front(), os);
+	}
+	else {
+		// Apply to all targets in parallel, then print the results in the original order
+		$trace("apply");
+		std::vector<std::stringstream> outputs(targetControllers.size());
+		std::vector<std::future<void>> results;
+		results.reserve(targetControllers.size());
+
+		auto& pool{ ctx.getPool() };
+		for (size_t i{ 0 }; i < targetControllers.size(); ++i) {
+			results.emplace_back(pool.submit([&args, controller = targetControllers[i], &out = outputs[i]]() {
+				$trace("applyTarget");
+				// Handle Volume Args:
+				handleVolumeArgs(args, controller, out);
+
+				// Handle Mute Args:
+				handleMuteArgs(args, controller, out);
+			}));
 		}
-		else {
-			const auto& flow_s{ DataFlowToString(pi.flow) };
-			const auto& pid_s{ std::to_string(pi.pid) };
-			os
-				<< '[' << colors(COLOR::SESSION) << pid_s << colors() << ']' << indent(COLSZ_PID, pid_s.size() + 2)
-				<< colors(COLOR::SESSION) << pi.pname << colors() << indent(COLSZ_PNAME, pi.pname.size())
-				;
+
+		// wait for every task before rethrowing, since they reference locals
+		std::exception_ptr error;
+		for (auto& result : results) {
+			try {
+				result.get();
+			} catch (...) {
+				if (!error) error = std::current_exception();
+			}
 		}
+		// print the output of every target that was applied, even when another one failed
+		for (const auto& out : outputs)
+			os << out.str(); //< inserting an empty rdbuf() would set failbit on os
+		if (error)
+			std::rethrow_exception(error);
+	}
+}
 
-		os << static_cast<DeviceInfo>(pi);
+/**
+ * @brief		Streams changes to the target (or to everything when there's no target) until the output stream is closed.
+ *\n			Each change is written as one line of SEP-separated 'NAME=VALUE' fields, using the same field names as the quiet output format.
+ *\n			When a process name is targeted, sessions that are created for that process later on are watched too.
+ * @param args	The parsed arguments of the command.
+ * @param ctx	The command context to resolve targets with.
+ * @param os	The stream to write records to.
+ */
+inline void runWatch(const opt3::ArgManager& args, CommandContext& ctx, std::ostream& os)
+{
+	using namespace vccli;
 
-		if (extended) {
-			if (quiet) os
-				<< SEP
-				<< pi.suid << SEP
-				<< pi.sguid
-				;
-			else os
-				<< indent(2)
-				<< colors(COLOR::DEVICE) << pi.dguid << colors() << SEP
-				<< pi.suid << SEP
-				<< pi.sguid
-				;
+	const auto& targets{ getTargets(args) };
+	const bool fuzzy{ args.check_any<opt3::Flag, opt3::Option>('f', "fuzzy") };
+	const EDataFlow flow{ getTargetDataFlow(args) };
+
+	AudioWatcher::filter_t filter;
+	if (targets.size() > 1 || !targets.front().empty()) {
+		// DGUIDs of targeted devices, SGUIDs & PIDs of targeted sessions
+		std::unordered_set<std::string> keys;
+		std::vector<std::string> unmatched;
+		for (const auto* obj : ctx.resolve(targets, fuzzy, flow, getFuzzyLimit(args), unmatched)) {
+			keys.emplace(obj->identifier);
+			if (const auto* app{ dynamic_cast<const ApplicationVolume*>(obj) })
+				keys.emplace(app->sessionInstanceIdentifier);
 		}
-		return os;
+
+		std::vector<match::TargetMatcher> matchers;
+		matchers.reserve(targets.size());
+		for (const auto& target : targets)
+			matchers.emplace_back(target, fuzzy);
+
+		filter = [keys = std::move(keys), matchers = std::move(matchers)](const WatchRecord& r) {
+			if (!r.isSession)
+				return keys.contains(r.dguid);
+			if (keys.contains(r.sguid) || keys.contains(std::to_string(r.pid)))
+				return true;
+			return std::any_of(matchers.begin(), matchers.end(), [&r](auto&& matcher) { return matcher(r.pname); });
+		};
 	}
 
-	template<std::derived_from<vccli::basic_info> T>
-	struct InfoLister {
-		std::vector<T> vec;
+	using namespace vccli_operators;
 
-		InfoLister(std::vector<T>&& vec) : vec{ std::forward<std::vector<T>>(vec) } {}
+	AudioWatcher watcher{ ctx.getSnapshot(true), AudioAPI::getBackend(), flow, std::move(filter) };
 
-		friend std::ostream& operator<<(std::ostream& os, const InfoLister<T>& p)
-		{
-			std::vector<std::string> columns;
+	if (format != OutputFormat::Text) {
+		// write each record as soon as it arrives
+		RecordWriter writer{ os, format, 0 };
+		while (const auto& record{ watcher.wait() }) {
+			writeRecord(writer, record.value());
+			if (!os) break; //< the reader went away
+		}
+		return;
+	}
 
-			if (quiet) {
-				if constexpr (std::same_as<T, vccli::DeviceInfo>) {
-					os << "DNAME" << SEP << "I/O" << SEP << "IS_DEFAULT";
-					if (extended) os << SEP << "DGUID";
-				}
-				else if constexpr (std::same_as<T, vccli::ProcessInfo>) {
-					os << "PID" << SEP << "PNAME" << SEP << "DNAME" << SEP << "I/O" << SEP << "IS_DEFAULT";
-					if (extended) os << SEP << "DGUID" << SEP << "SUID" << SEP << "SGUID";
+	while (const auto& record{ watcher.wait() }) {
+		os << record.value() << std::endl;
+		if (!os) break; //< the reader went away
+	}
+}
+
+/**
+ * @brief		Executes every command in a batch script against one snapshot.
+ *\n			Each command's output is followed by a status line in the quiet output format:
+ *\n			 "LINE;0" when the command succeeded, or "LINE;1;MESSAGE" when it failed.
+ * @param is	The stream to read the batch script from.
+ * @param ctx	The command context to execute commands with.
+ * @param os	The stream to write output & status lines to.
+ * @returns		0 when every command succeeded; otherwise 1.
+ */
+inline int runBatch(std::istream& is, CommandContext& ctx, std::ostream& os)
+{
+	const auto& commands{ vccli::readBatchCommands(is) };
+
+	// Resolve everything against the same snapshot
+	ctx.getSnapshot();
+
+	int rc{ 0 };
+	for (const auto& command : commands) {
+		$trace("batchCommand");
+		std::stringstream out;
+		std::string message;
+		try {
+			if (!command.error.empty())
+				throw make_exception(command.error);
+			const auto& args{ parseArgs(command.args) };
+			applyOutputArgs(args);
+			// status lines use the quiet output format, so the output of each command does too
+			quiet = true;
+			colors.setActive(false);
+
+			if (args.check_any<opt3::Option>("batch", "daemon", "client", "shutdown", "watch"))
+				throw make_exception("This option can't be used in a batch script!");
+
+			executeCommand(args, ctx, out);
+		} catch (const std::exception& ex) {
+			message = ex.what();
+		} catch (...) {
+			message = "An undefined exception occurred!";
+		}
+
+		// quiet getters don't end their output with a newline
+		if (const auto& output{ out.str() }; !output.empty()) {
+			os << output;
+			if (output.back() != '\n') os << '\n';
+		}
+
+		os << command.line << ';';
+		if (message.empty())
+			os << 0 << '\n';
+		else {
+			rc = 1;
+			// collapse multi-line messages onto the status line
+			std::string flat;
+			bool space{ false };
+			for (const char c : message) {
+				if (c == '\n' || c == '\r' || c == '\t' || c == ' ') space = true;
+				else {
+					if (space && !flat.empty()) flat += ' ';
+					space = false;
+					flat += c;
 				}
 			}
-			else {
-				if constexpr (std::same_as<T, vccli::DeviceInfo>) {
-					os
-						<< colors(COLOR::HEADER)
-						<< "Device Name (DNAME)" << indent(COLSZ_DNAME - 19)
-						<< "I/O" << indent(COLSZ_IO - 3)
-						<< "Default";
-					;
-					if (extended) os << indent(COLSZ_DEFAULT - 7) << "Device ID (DGUID)";
-				}
-				else if constexpr (std::same_as<T, vccli::ProcessInfo>) {
-					os
-						<< colors(COLOR::HEADER)
-						<< "PID" << indent(COLSZ_PID - 3)
-						<< "Process Name (PNAME)" << indent(COLSZ_PNAME - 20)
-						<< "Device Name (DNAME)" << indent(COLSZ_DNAME - 19)
-						<< "I/O" << indent(COLSZ_IO - 3)
-						<< "Default";
-					if (extended) os << indent(COLSZ_DEFAULT - 7)
-						<< "Device ID (DGUID)" << indent(COLSZ_DGUID - 17)
-						<< "Session ID" << SEP
-						<< "Instance ID";
-					os << colors();
+			os << 1 << ';' << flat << '\n';
+		}
+	}
+	return rc;
+}
+
+/**
+ * @brief		Serves commands sent by clients over the IPC channel until a client sends '--shutdown'.
+ * @param name	The name of the pipe/socket to listen on.
+ * @param ctx	The command context to execute commands with. This is kept for the lifetime of the daemon.
+ */
+inline void runDaemon(std::string const& name, CommandContext& ctx)
+{
+	if (vccli::ipc::connect(name, std::chrono::milliseconds{ 0 }).has_value())
+		throw make_exception("A daemon is already listening on '", name, "'!");
+
+	vccli::ipc::Server server{ name };
+
+	// Warm up the snapshot before the first request arrives
+	ctx.refresh();
+
+	for (bool running{ true }; running; ) {
+		auto conn{ server.accept() };
+
+		while (const auto& request{ conn.receive() }) {
+			$trace("request");
+			std::stringstream out, err;
+			const int rc{ catchExceptions(err, [&]() {
+				const auto& args{ parseArgs(vccli::ipc::unpackArguments(request.value())) };
+				applyOutputArgs(args);
+
+				if (args.check_any<opt3::Option>("batch"))
+					throw make_exception("Batch scripts can't be sent to the daemon!");
+				else if (args.check_any<opt3::Option>("watch"))
+					throw make_exception("'--watch' can't be sent to the daemon!");
+				else if (args.check_any<opt3::Option>("shutdown"))
+					running = false;
+				else {
+					if (args.check_any<opt3::Option>("refresh"))
+						ctx.refresh(true);
+					executeCommand(args, ctx, out);
 				}
-			}
-			os << "\n\n";
+			}) };
+			ctx.snapshotIsStale = true;
 
-			for (const auto& obj : p.vec)
-				os << obj << '\n';
+			conn.send(out.str());
+			conn.send(err.str());
+			conn.send(std::to_string(rc));
 
-			return os;
+			if (!running) break;
 		}
-	};
+	}
 }
 
-template<std::derived_from<vccli::basic_info> T>
-vccli_operators::InfoLister<T> make_printable_list(std::vector<T>&& vec)
+/**
+ * @brief		Sends the given command to the daemon & prints its response.
+ * @param name	The name of the pipe/socket that the daemon is listening on.
+ * @param argc	The argument count of this process.
+ * @param argv	The arguments of this process. '--client' & '--ipc' are removed before the command is sent.
+ * @returns		The exit code of the command.
+ */
+inline int runClient(std::string const& name, const int argc, char** argv)
 {
-	return vccli_operators::InfoLister<T>{ std::forward<std::vector<T>>(vec) };
+	std::vector<std::string> forwardedArgs;
+	forwardedArgs.reserve(argc);
+	for (int i{ 1 }; i < argc; ++i) {
+		const std::string_view arg{ argv[i] };
+		if (arg == "--client")
+			continue;
+		else if (arg == "--ipc") {
+			++i; //< skip the captured name
+			continue;
+		}
+		else if (arg.starts_with("--ipc="))
+			continue;
+		forwardedArgs.emplace_back(arg);
+	}
+
+	auto conn{ vccli::ipc::connect(name) };
+	if (!conn.has_value())
+		throw make_exception("Couldn't connect to a daemon on '", name, "'!  (Start one with 'vccli --daemon')");
+
+	conn->send(vccli::ipc::packArguments(forwardedArgs));
+
+	const auto& out{ conn->receive() }, & err{ conn->receive() }, & rc{ conn->receive() };
+	if (!out.has_value() || !err.has_value() || !rc.has_value())
+		throw make_exception("The daemon closed the connection unexpectedly!");
+
+	std::cout << out.value() << std::flush;
+	std::cerr << err.value() << std::flush;
+	return std::stoi(rc.value());
+}
+
+TEST_CASE("runBatch")
+{
+	using namespace vccli;
+	const auto& sim{ std::make_shared<SimulatedBackend>() };
+	auto& dev{ sim->addDevice("Speakers", EDataFlow::eRender) };
+	auto& chrome{ sim->addSession(dev, 1000, "chrome") };
+	auto& discord{ sim->addSession(dev, 1004, "discord") };
+	AudioAPI::setBackend(sim);
+
+	// an unterminated quote only fails its own line
+	std::stringstream script{ "chrome -v 50\n\"spotify -v 10\ndiscord -v 25\n" }, out;
+	CommandContext ctx;
+	CHECK(runBatch(script, ctx, out) == 1);
+	CHECK(out.str() == "1;0\n2;1;Unterminated quote in line: \"spotify -v 10\n3;0\n");
+	CHECK(chrome.level.load() == doctest::Approx(0.5f));
+	CHECK(discord.level.load() == doctest::Approx(0.25f));
+
+	AudioAPI::setBackend(nullptr);
 }
 
+TEST_CASE("daemon")
+{
+	using namespace vccli;
+#ifdef OS_WIN
+	const std::string name{ R"(\\.\pipe\vccli-daemon-test-)" + std::to_string(GetCurrentProcessId()) };
+#else
+	const std::string name{ "/tmp/vccli-daemon-test-" + std::to_string(getpid()) + ".sock" };
+#endif
+	const auto& sim{ std::make_shared<SimulatedBackend>() };
+	auto& dev{ sim->addDevice("Speakers", EDataFlow::eRender) };
+	auto& chrome{ sim->addSession(dev, 1000, "chrome") };
+	AudioAPI::setBackend(sim);
 
+	CommandContext ctx;
+	std::thread daemon{ [&]() { runDaemon(name, ctx); } };
+	const auto& send{ [&name](std::vector<std::string> const& args) {
+		auto conn{ ipc::connect(name, std::chrono::seconds{ 5 }) };
+		REQUIRE(conn.has_value());
+		conn->send(ipc::packArguments(args));
+		const auto& out{ conn->receive() }, & err{ conn->receive() }, & rc{ conn->receive() };
+		REQUIRE((out.has_value() && err.has_value() && rc.has_value()));
+		return std::stoi(rc.value());
+	} };
+
+	CHECK(send({ "chrome", "-v", "50" }) == 0);
+	CHECK(chrome.level.load() == doctest::Approx(0.5f));
+
+	// the cached session expired, so the target is resolved again instead of being applied to the dead session
+	sim->removeSession(dev, chrome);
+	auto& restarted{ sim->addSession(dev, 1004, "chrome") };
+	CHECK(send({ "chrome", "-v", "25" }) == 0);
+	CHECK(restarted.level.load() == doctest::Approx(0.25f));
+
+	send({ "--shutdown" });
+	daemon.join();
+	AudioAPI::setBackend(nullptr);
+}
 
 int main(const int argc, char** argv)
 {
 	using namespace vccli;
 	int rc{ 0 };
-	try {
-		opt3::ArgManager args{ argc, argv,
-			opt3::make_template(opt3::CaptureStyle::Optional, 'v', "volume"),
-			opt3::make_template(opt3::CaptureStyle::Optional, 'm', "mute", "muted", "is-muted"),
-			opt3::make_template(opt3::CaptureStyle::Required, 'I', "increment"),
-			opt3::make_template(opt3::CaptureStyle::Required, 'D', "decrement"),
-			opt3::make_template(opt3::CaptureStyle::Required, 'd', "dev"),
-		};
+	std::optional<std::string> traceFile;
+	if (catchExceptions(std::cerr, [&]() {
+		const auto& args{ parseArgs(argc, argv) };
+
+		// --trace
+		if (traceFile = args.getv_any<opt3::Option>("trace"); traceFile.has_value())
+			trace::Recorder::get().start();
 
 		// handle important general args
-		quiet = args.check_any<opt3::Flag, opt3::Option>('q', "quiet");
-		colors.setActive(!quiet && !args.check_any<opt3::Flag, opt3::Option>('n', "no-color"));
-		extended = args.check_any<opt3::Flag, opt3::Option>('e', "extended");
+		applyOutputArgs(args);
+
+	#ifdef OS_WIN
+		// Don't let the CRT translate '\n' to '\r\n' in binary records
+		if (format == OutputFormat::Binary)
+			_setmode(_fileno(stdout), _O_BINARY);
+	#endif
 
 		if (args.empty() || args.check_any<opt3::Flag, opt3::Option>('h', "help")) {
 			std::cout << PrintHelp{};
-			return 0;
+			return;
 		}
 		else if (args.checkopt("version")) {
 			if (!quiet) std::cout << "vccli v";
 			std::cout << vccli_VERSION_EXTENDED << '\n';
-			return 0;
+			return;
 		}
 
-		// Get the target string
-		const std::string target{ getTargetAndValidateParams(args) };
-		EDataFlow flow{ getTargetDataFlow(args) };
+		const std::string ipcName{ args.getv_any<opt3::Option>("ipc").value_or(ipc::getDefaultEndpointName()) };
 
-		// Initialize Windows API
-		if (const auto& hr{ CoInitializeEx(NULL, COINIT::COINIT_MULTITHREADED) }; hr != S_OK)
-			throw make_exception("Failed to initialize COM interface with error code ", hr, ": '", GetErrorMessageFrom(hr), "'!");
-
-		// Get controller:
-		const auto& targetControllers{ AudioAPI::getObjects(target, args.check_any<opt3::Flag, opt3::Option>('f', "fuzzy"), flow) };
-
-		if (targetControllers.empty())
-			throw make_exception(
-				"Couldn't locate anything matching the given search term!\n",
-				indent(10), colors(COLOR::HEADER), "Search Term", colors(), ":    ", colors(COLOR::ERR), target, colors(), '\n',
-				indent(10), colors(COLOR::HEADER), "Device Filter", colors(), ":  ", colors(COLOR::ERR), DataFlowToString(flow), colors()
-			);
-
-		const bool
-			listSessions{ args.check_any<opt3::Flag, opt3::Option>('l', "list") },
-			listDevices{ args.check_any<opt3::Flag, opt3::Option>('L', "list-dev") };
-
-		// -Q | --query
-		if (args.check_any<opt3::Flag, opt3::Option>('Q', "query")) {
-			bool fst{ true };
-			for (const auto& it : targetControllers) {
-				if (fst) fst = false;
-				else std::cout << '\n';
-				std::cout << VolumeObjectPrinter(it.get());
-			}
+		// --client
+		if (args.check_any<opt3::Option>("client")) {
+			rc = runClient(ipcName, argc, argv);
+			return;
 		}
-		// list
-		else if (listSessions || listDevices) {
-			// -l | --list
-			if (listSessions) {
-				std::cout << make_printable_list(AudioAPI::GetAllAudioProcessesSorted(flow));
-				if (listDevices) std::cout << '\n';
-			}
-			// -L | --list-dev
-			if (listDevices)
-				std::cout << make_printable_list(AudioAPI::GetAllAudioDevicesSorted(flow));
+
+	#ifdef OS_WIN
+		// Initialize Windows API
+		{
+			$trace("CoInitializeEx");
+			if (const auto& hr{ CoInitializeEx(NULL, COINIT::COINIT_MULTITHREADED) }; hr != S_OK)
+				throw make_exception("Failed to initialize COM interface with error code ", hr, ": '", GetErrorMessageFrom(hr), "'!");
 		}
-		// Non-blocking options:
-		else {
-			for (const auto& it : targetControllers) {
-				// Handle Volume Args:
-				handleVolumeArgs(args, it.get());
+	#endif
 
-				// Handle Mute Args:
-				handleMuteArgs(args, it.get());
+		// Select the audio backend:
+		AudioAPI::setBackend(makeBackend(args));
+
+		// The snapshot is captured once & shared by every command that this process executes
+		CommandContext ctx;
+		// --device-cache | --cache-file
+		if (const auto& cacheFile{ args.getv_any<opt3::Option>("cache-file") }; cacheFile.has_value())
+			ctx.deviceCache = std::make_unique<DeviceCache>(cacheFile.value());
+		else if (args.check_any<opt3::Option>("device-cache"))
+			ctx.deviceCache = std::make_unique<DeviceCache>(DeviceCache::getDefaultPath());
+		// --refresh
+		if (ctx.deviceCache && args.check_any<opt3::Option>("refresh"))
+			ctx.deviceCache->invalidate();
+
+		// --daemon
+		if (args.check_any<opt3::Option>("daemon"))
+			runDaemon(ipcName, ctx);
+		// --watch
+		else if (args.check_any<opt3::Option>("watch"))
+			runWatch(args, ctx, std::cout);
+		// --batch
+		else if (const auto& batchFile{ args.getv_any<opt3::Option>("batch") }; batchFile.has_value()) {
+			if (batchFile.value() == "-") {
+				if (runBatch(std::cin, ctx, std::cout) != 0) rc = 1;
+			}
+			else {
+				std::ifstream ifs{ batchFile.value() };
+				if (!ifs)
+					throw make_exception("Couldn't open batch script '", batchFile.value(), "'!");
+				if (runBatch(ifs, ctx, std::cout) != 0) rc = 1;
 			}
 		}
-
-	} catch (const showhelp& ex) {
-		std::cerr << PrintHelp{} << '\n' << colors.get_fatal() << ex.what() << '\n';
-		rc = 1;
-	} catch (const std::exception& ex) {
-		std::cerr << colors.get_fatal() << ex.what() << '\n';
-		rc = 1;
-	} catch (...) {
-		std::cerr << colors.get_fatal() << "An undefined exception occurred!" << '\n';
-		rc = 1;
-	}
+		else
+			executeCommand(args, ctx, std::cout);
+	}) != 0) rc = 1;
+	// Release the backend before uninitializing COM
+	AudioAPI::setBackend(nullptr);
+#ifdef OS_WIN
 	// Uninitialize Windows API
 	CoUninitialize();
+#endif
+	// Write the trace
+	if (traceFile.has_value()) {
+		trace::Recorder::get().stop();
+		if (catchExceptions(std::cerr, [&]() {
+			std::ofstream ofs{ traceFile.value() };
+			if (!ofs)
+				throw make_exception("Couldn't open trace file '", traceFile.value(), "'!");
+			trace::Recorder::get().writeChromeTrace(ofs);
+		}) != 0) rc = 1;
+	}
 	return rc;
 }
 
 // Definitions:
-inline std::string getTargetAndValidateParams(const opt3::ArgManager& args)
+inline std::vector<std::string> getTargets(const opt3::ArgManager& args)
 {
 	auto params{ args.getv_all<opt3::Parameter>() };
-	if (params.empty()) return{};
-	// Copy & pop the first parameter from the vector
-	std::string target{ params.front() };
-	params.erase(params.begin());
-	// If there are any additional parameters, throw
-	if (!params.empty()) throw make_custom_exception<showhelp>("Unexpected Arguments:  ", str::join(params, ", "));
-	return target;
+	if (params.empty()) return{ std::string{} }; //< a blank target selects the default device
+	return{ params.begin(), params.end() };
 }
 
 inline EDataFlow getTargetDataFlow(const opt3::ArgManager& args)
@@ -417,7 +1026,38 @@ inline EDataFlow getTargetDataFlow(const opt3::ArgManager& args)
 	}
 	else return EDataFlow::eAll;
 }
-inline void handleVolumeArgs(const opt3::ArgManager& args, const vccli::Volume* controller)
+inline size_t getFuzzyLimit(const opt3::ArgManager& args)
+{
+	if (const auto& limit{ args.getv_any<opt3::Option>("fuzzy-limit") }; limit.has_value()) {
+		if (limit.value().empty() || !std::all_of(limit.value().begin(), limit.value().end(), str::stdpred::isdigit))
+			throw make_exception("Invalid Fuzzy Limit:  ", limit.value(), " ; (expected a positive integer, or 0 for no limit)!");
+		return str::stoul(limit.value());
+	}
+	else return vccli::AudioAPI::DEFAULT_FUZZY_LIMIT;
+}
+inline std::shared_ptr<vccli::AudioBackend> makeBackend(const opt3::ArgManager& args)
+{
+	$trace("makeBackend");
+	if (const auto& sim{ args.getv_any<opt3::Option>("simulate") }; sim.has_value()) {
+		// DxS[:US]
+		const auto& v{ sim.value() };
+		const auto& x{ v.find('x') }, & colon{ v.find(':') };
+		const auto& isNumber{ [](std::string const& s) { return !s.empty() && std::all_of(s.begin(), s.end(), str::stdpred::isdigit); } };
+		const std::string
+			devices{ v.substr(0, x) },
+			sessions{ x == std::string::npos ? std::string{} : v.substr(x + 1, colon == std::string::npos ? std::string::npos : colon - x - 1) },
+			latency{ colon == std::string::npos ? "0" : v.substr(colon + 1) };
+		if (!isNumber(devices) || !isNumber(sessions) || !isNumber(latency))
+			throw make_exception("Invalid Simulation Specified:  ", v, " ; (expected <DEVICES>x<SESSIONS>[:<LATENCY_US>])!");
+		return vccli::SimulatedBackend::generate(str::stoul(devices), str::stoul(sessions), std::chrono::microseconds{ str::stoul(latency) });
+	}
+#ifdef OS_WIN
+	return std::make_shared<vccli::CoreAudioBackend>();
+#else
+	throw make_exception("The Windows Core Audio API isn't available on this platform; use '--simulate' to select a simulated audio system.");
+#endif
+}
+inline void handleVolumeArgs(const opt3::ArgManager& args, const vccli::Volume* controller, std::ostream& os)
 {
 	const auto& increment{ args.getv_any<opt3::Flag, opt3::Option>('I', "increment") }, & decrement{ args.getv_any<opt3::Flag, opt3::Option>('D', "decrement") };
 	if (increment.has_value() && decrement.has_value())
@@ -427,11 +1067,11 @@ inline void handleVolumeArgs(const opt3::ArgManager& args, const vccli::Volume*
 		if (!std::all_of(value.begin(), value.end(), str::stdpred::isdigit))
 			throw make_exception("Invalid Number Specified:  ", value);
 		if (controller->getVolumeScaled() == 100.0f) {
-			if (!quiet) std::cout << "Volume is" << indent(MARGIN_WIDTH, 10ull) << colors(COLOR::WARN) << "100" << colors() << '\n';
+			if (!quiet) os << "Volume is" << indent(MARGIN_WIDTH, 10ull) << colors(COLOR::WARN) << "100" << colors() << '\n';
 		}
 		else {
 			controller->incrementVolume(str::stof(value) / 100.0f);
-			if (!quiet) std::cout << "Volume =" << indent(MARGIN_WIDTH, 9ull) << colors(COLOR::VALUE) << static_cast<int>(controller->getVolumeScaled()) << colors() << " (+" << colors(COLOR::VALUE) << value << colors() << ')' << '\n';
+			if (!quiet) os << "Volume =" << indent(MARGIN_WIDTH, 9ull) << colors(COLOR::VALUE) << static_cast<int>(controller->getVolumeScaled()) << colors() << " (+" << colors(COLOR::VALUE) << value << colors() << ')' << '\n';
 		}
 	}
 	else if (decrement.has_value()) {
@@ -439,11 +1079,11 @@ inline void handleVolumeArgs(const opt3::ArgManager& args, const vccli::Volume*
 		if (!std::all_of(value.begin(), value.end(), str::stdpred::isdigit))
 			throw make_exception("Invalid Number Specified:  ", value);
 		if (controller->getVolumeScaled() == 0.0f) {
-			if (!quiet) std::cout << "Volume is" << indent(MARGIN_WIDTH, 10ull) << colors(COLOR::WARN) << "0" << colors() << '\n';
+			if (!quiet) os << "Volume is" << indent(MARGIN_WIDTH, 10ull) << colors(COLOR::WARN) << "0" << colors() << '\n';
 		}
 		else {
 			controller->decrementVolume(str::stof(value) / 100.0f);
-			if (!quiet) std::cout << "Volume =" << indent(MARGIN_WIDTH, 9ull) << colors(COLOR::VALUE) << static_cast<int>(controller->getVolumeScaled()) << colors() << " (-" << colors(COLOR::VALUE) << value << colors() << ')' << '\n';
+			if (!quiet) os << "Volume =" << indent(MARGIN_WIDTH, 9ull) << colors(COLOR::VALUE) << static_cast<int>(controller->getVolumeScaled()) << colors() << " (-" << colors(COLOR::VALUE) << value << colors() << ')' << '\n';
 		}
 	}
 
@@ -459,22 +1099,22 @@ inline void handleVolumeArgs(const opt3::ArgManager& args, const vccli::Volume*
 			else if (tgtVolume < 0.0f)
 				tgtVolume = 0.0f;
 			if (controller->getVolumeScaled() == tgtVolume) {
-				if (!quiet) std::cout << "Volume is" << indent(MARGIN_WIDTH, 9ull) << colors(COLOR::WARN) << static_cast<int>(tgtVolume) << colors() << '\n';
+				if (!quiet) os << "Volume is" << indent(MARGIN_WIDTH, 9ull) << colors(COLOR::WARN) << static_cast<int>(tgtVolume) << colors() << '\n';
 			}
 			else {
 				controller->setVolumeScaled(tgtVolume);
-				if (!quiet) std::cout << "Volume =" << indent(MARGIN_WIDTH, 8ull) << colors(COLOR::VALUE) << static_cast<int>(tgtVolume) << colors() << '\n';
+				if (!quiet) os << "Volume =" << indent(MARGIN_WIDTH, 8ull) << colors(COLOR::VALUE) << static_cast<int>(tgtVolume) << colors() << '\n';
 			}
 		}
 		else {
 			// Get
-			if (!quiet) std::cout << "Volume:" << indent(MARGIN_WIDTH, 7ull) << colors(COLOR::VALUE);
-			std::cout << str::stringify(std::fixed, std::setprecision(0), controller->getVolume() * 100.0f);
-			if (!quiet) std::cout << colors() << '\n';
+			if (!quiet) os << "Volume:" << indent(MARGIN_WIDTH, 7ull) << colors(COLOR::VALUE);
+			os << str::stringify(std::fixed, std::setprecision(0), controller->getVolume() * 100.0f);
+			if (!quiet) os << colors() << '\n';
 		}
 	}
 }
-inline void handleMuteArgs(const opt3::ArgManager& args, const vccli::Volume* controller)
+inline void handleMuteArgs(const opt3::ArgManager& args, const vccli::Volume* controller, std::ostream& os)
 {
 	const bool
 		mute{ args.check_any<opt3::Flag, opt3::Option>('M', "mute") },
@@ -484,20 +1124,20 @@ inline void handleMuteArgs(const opt3::ArgManager& args, const vccli::Volume* co
 		throw make_exception("Conflicting Options Specified:  ", colors(COLOR::ERR), "-m", colors(), '|', colors(COLOR::ERR), "--mute", colors(), " && ", colors(COLOR::ERR), "-u", colors(), '|', colors(COLOR::ERR), "--unmute", colors());
 	else if (mute) {
 		if (controller->getMuted() == true) {
-			if (!quiet) std::cout << "Muted is" << indent(MARGIN_WIDTH, 8ull) << colors(COLOR::WARN) << "true" << colors() << '\n';
+			if (!quiet) os << "Muted is" << indent(MARGIN_WIDTH, 8ull) << colors(COLOR::WARN) << "true" << colors() << '\n';
 		}
 		else {
 			controller->mute();
-			if (!quiet) std::cout << "Muted =" << indent(MARGIN_WIDTH, 7ull) << colors(COLOR::VALUE) << "true" << colors() << '\n';
+			if (!quiet) os << "Muted =" << indent(MARGIN_WIDTH, 7ull) << colors(COLOR::VALUE) << "true" << colors() << '\n';
 		}
 	}
 	else if (unmute) {
 		if (controller->getMuted() == false) {
-			if (!quiet) std::cout << "Muted is" << indent(MARGIN_WIDTH, 8ull) << colors(COLOR::WARN) << "false" << colors() << '\n';
+			if (!quiet) os << "Muted is" << indent(MARGIN_WIDTH, 8ull) << colors(COLOR::WARN) << "false" << colors() << '\n';
 		}
 		else {
 			controller->unmute();
-			if (!quiet) std::cout << "Muted =" << indent(MARGIN_WIDTH, 7ull) << colors(COLOR::VALUE) << "false" << colors() << '\n';
+			if (!quiet) os << "Muted =" << indent(MARGIN_WIDTH, 7ull) << colors(COLOR::VALUE) << "false" << colors() << '\n';
 		}
 	}
 
@@ -508,29 +1148,29 @@ inline void handleMuteArgs(const opt3::ArgManager& args, const vccli::Volume* co
 			const auto& value{ str::trim(captured.value()) };
 			if (str::equalsAny<true>(value, "true", "1", "on")) {
 				if (controller->getMuted() == true) {
-					if (!quiet) std::cout << "Muted is" << indent(MARGIN_WIDTH, 8ull) << colors(COLOR::WARN) << "true" << colors() << '\n';
+					if (!quiet) os << "Muted is" << indent(MARGIN_WIDTH, 8ull) << colors(COLOR::WARN) << "true" << colors() << '\n';
 				}
 				else {
 					controller->mute();
-					if (!quiet) std::cout << "Muted =" << indent(MARGIN_WIDTH, 7ull) << colors(COLOR::VALUE) << "true" << colors() << '\n';
+					if (!quiet) os << "Muted =" << indent(MARGIN_WIDTH, 7ull) << colors(COLOR::VALUE) << "true" << colors() << '\n';
 				}
 			}
 			else if (str::equalsAny<true>(value, "false", "0", "off")) {
 				if (controller->getMuted() == false) {
-					if (!quiet) std::cout << "Muted is" << indent(MARGIN_WIDTH, 8ull) << colors(COLOR::WARN) << "false" << colors() << '\n';
+					if (!quiet) os << "Muted is" << indent(MARGIN_WIDTH, 8ull) << colors(COLOR::WARN) << "false" << colors() << '\n';
 				}
 				else {
 					controller->unmute();
-					if (!quiet) std::cout << "Muted =" << indent(MARGIN_WIDTH, 7ull) << colors(COLOR::VALUE) << "false" << colors() << '\n';
+					if (!quiet) os << "Muted =" << indent(MARGIN_WIDTH, 7ull) << colors(COLOR::VALUE) << "false" << colors() << '\n';
 				}
 			}
 			else throw make_exception("Invalid Argument Specified:  '", colors(COLOR::ERR), captured.value(), colors(), "';  Expected a boolean value ('", colors(COLOR::ERR), "true", colors(), "'/'", colors(COLOR::ERR), "false", colors(), "')!");
 		}
 		else {
 			// Get
-			if (!quiet) std::cout << "Is Muted:" << indent(MARGIN_WIDTH, 9ull) << colors(COLOR::VALUE);
-			std::cout << str::stringify(std::boolalpha, controller->getMuted());
-			if (!quiet) std::cout << colors() << '\n';
+			if (!quiet) os << "Is Muted:" << indent(MARGIN_WIDTH, 9ull) << colors(COLOR::VALUE);
+			os << str::stringify(std::boolalpha, controller->getMuted());
+			if (!quiet) os << colors() << '\n';
 		}
 	}
 }
\ No newline at end of file